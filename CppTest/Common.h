@@ -3,18 +3,20 @@
 
 #ifdef _DEBUG
 #define PRAGMA_OPTION PRAGMA_DISABLE_OPTIMIZATION
+const bool kPragmaOptionOptimizes = false;  // Code after PRAGMA_OPTION, DropSystem.cpp among it, runs unoptimized
 
 #else
 #define PRAGMA_OPTION
+const bool kPragmaOptionOptimizes = true;
 #endif
 
 
 const float kDropEmitChanceDefault = 0.01f;
 const float kDropEmitRadiusMinDefault = 1.5f;
 const float kDropEmitRadiusMaxDefault = 4.0f;
-const float kDropEmitRadiusExpDefault = 2.0f;
+constexpr float kDropEmitRadiusExpDefault = 2.0f;
 
 const float kDropEmitChanceStrokeEnd = 1.0f;
 const float kDropEmitRadiusMinStrokeEnd = 6.0f;
 const float kDropEmitRadiusMaxStrokeEnd = 9.0f;
-const float kDropEmitRadiusExpStrokeEnd = 0.5f;
\ No newline at end of file
+constexpr float kDropEmitRadiusExpStrokeEnd = 0.5f;
\ No newline at end of file
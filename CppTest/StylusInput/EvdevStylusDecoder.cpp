@@ -0,0 +1,58 @@
+#include "EvdevStylusDecoder.h"
+#include "Common.h"
+PRAGMA_OPTION
+
+void FEvdevStylusDecoder::Reset()
+{
+	for (FAxis& Axis : Axes)
+	{
+		Axis = FAxis();
+	}
+}
+
+void FEvdevStylusDecoder::SetAxis(uint16 AbsCode, const FEvdevAxisInfo& Info)
+{
+	if (AbsCode >= EvdevCode::AbsCount)
+	{
+		return;
+	}
+
+	FAxis Axis;
+	Axis.IsUsed = true;
+	switch (AbsCode)
+	{
+		case EvdevCode::AbsX:
+		case EvdevCode::AbsY:
+		{
+			// Value * Scale + Bias == (Value - Minimum) / (Maximum - Minimum) * Extent, device units without an extent
+			Axis.Field = AbsCode == EvdevCode::AbsX ? EEvdevStylusField::PositionX : EEvdevStylusField::PositionY;
+			const float Extent = AbsCode == EvdevCode::AbsX ? ScreenExtent.X : ScreenExtent.Y;
+			const int32 Range = Info.Maximum - Info.Minimum;
+			Axis.Scale = Range > 0 && Extent > 0.0f ? Extent / (float)Range : 1.0f;
+			Axis.Bias = -(float)Info.Minimum * Axis.Scale;
+			break;
+		}
+		case EvdevCode::AbsPressure:
+		case EvdevCode::AbsDistance:
+		{
+			// Value * Scale + Bias == (Value - Minimum) / (Maximum - Minimum)
+			Axis.Field = AbsCode == EvdevCode::AbsPressure ? EEvdevStylusField::Pressure : EEvdevStylusField::Z;
+			const int32 Range = Info.Maximum - Info.Minimum;
+			Axis.Scale = Range != 0 ? 1.0f / (float)Range : 0.0f;
+			Axis.Bias = -(float)Info.Minimum * Axis.Scale;
+			break;
+		}
+		case EvdevCode::AbsTiltX:
+		case EvdevCode::AbsTiltY:
+		{
+			// Units per radian to degrees, most drivers that don't say send degrees
+			Axis.Field = AbsCode == EvdevCode::AbsTiltX ? EEvdevStylusField::TiltX : EEvdevStylusField::TiltY;
+			Axis.Scale = Info.Resolution > 0 ? FMath::RadiansToDegrees(1.0f) / (float)Info.Resolution : 1.0f;
+			break;
+		}
+		default:
+			// Wheels, the misc axes and multitouch slots aren't part of the state
+			return;
+	}
+	Axes[AbsCode] = Axis;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IStylusState.h"
+
+/**
+ * The event types and codes of linux/input-event-codes.h a pen sends, under names that don't
+ * clash with its macros, so decoding builds and can be tested on any platform.
+ */
+namespace EvdevCode
+{
+	constexpr uint16 EvSyn = 0x00;
+	constexpr uint16 EvKey = 0x01;
+	constexpr uint16 EvAbs = 0x03;
+
+	constexpr uint16 SynReport = 0x00;
+	constexpr uint16 SynDropped = 0x03;
+
+	constexpr uint16 BtnToolPen = 0x140;
+	constexpr uint16 BtnToolRubber = 0x141;
+	constexpr uint16 BtnTouch = 0x14a;
+
+	constexpr uint16 AbsX = 0x00;
+	constexpr uint16 AbsY = 0x01;
+	constexpr uint16 AbsPressure = 0x18;
+	constexpr uint16 AbsDistance = 0x19;
+	constexpr uint16 AbsTiltX = 0x1a;
+	constexpr uint16 AbsTiltY = 0x1b;
+	constexpr uint16 AbsCount = 0x40;
+}
+
+/**
+ * One event as read from /dev/input/eventN, laid out like struct input_event of 64-bit Linux,
+ * so a device can be read into it directly and `cat /dev/input/eventN` captures can be played back.
+ */
+struct FEvdevRawEvent
+{
+	int64 Seconds;
+	int64 Microseconds;
+	uint16 Type;
+	uint16 Code;
+	int32 Value;
+};
+
+static_assert(sizeof(FEvdevRawEvent) == 24, "Laid out like struct input_event.");
+
+/**
+ * Range of an absolute axis, as in struct input_absinfo. Resolution is in units per millimeter
+ * for positions and units per radian for tilts, 0 when the device doesn't say.
+ */
+struct FEvdevAxisInfo
+{
+	int32 Minimum { 0 };
+	int32 Maximum { 0 };
+	int32 Resolution { 0 };
+};
+
+/** Fields of FEvdevStylusState an absolute axis can go to. */
+enum class EEvdevStylusField : uint8
+{
+	PositionX,
+	PositionY,
+	Z,
+	Pressure,
+	TiltX,
+	TiltY,
+	Num
+};
+
+/**
+ * Stylus state as the reports of a pen left it.
+ */
+struct FEvdevStylusState
+{
+	/** Position in device independent pixels from the top left of the screen, Z and pressure in [0, 1], tilt in degrees. */
+	float Values[(int32)EEvdevStylusField::Num] { };
+	bool IsTouching { false };
+	bool IsInverted { false };
+
+	float GetValue(EEvdevStylusField Field) const { return Values[(int32)Field]; }
+
+	FStylusState ToPublicState() const
+	{
+		return FStylusState(
+			FVector2D(GetValue(EEvdevStylusField::PositionX), GetValue(EEvdevStylusField::PositionY)),
+			GetValue(EEvdevStylusField::Z),
+			FVector2D(GetValue(EEvdevStylusField::TiltX), GetValue(EEvdevStylusField::TiltY)),
+			0.0f, GetValue(EEvdevStylusField::Pressure), 0.0f, FVector2D(0, 0), IsTouching, IsInverted);
+	}
+};
+
+/**
+ * Decodes the evdev events of a pen, a whole read() of them at a time, into FEvdevStylusState.
+ *
+ * The kernel sends a change of each axis and button as its own event and ends every report
+ * with SYN_REPORT. SetAxis compiles the range of an axis into the scale and bias that turn
+ * its values into pixels, [0, 1] or degrees, in a table indexed by the ABS code, so decoding
+ * is a lookup per event. Reports can span two reads, so the state carries over between batches.
+ *
+ * After SYN_DROPPED the kernel lost events, and everything up to the next SYN_REPORT is
+ * ignored as the kernel documentation asks. What was lost is unknown, so at that SYN_REPORT the
+ * caller gets to set the state to what the device says it is now, see IEvdevEventSource::Resync.
+ */
+class FEvdevStylusDecoder
+{
+public:
+	/** Forget every axis, their events are ignored until they are set again. */
+	void Reset();
+
+	/**
+	 * Size in device independent pixels of the screen the tablet maps to. Like RealTimeStylus,
+	 * ABS_X and ABS_Y set after it go from their minimum to their maximum across the screen,
+	 * before any is set positions are in device units.
+	 */
+	void SetScreenExtent(const FVector2D& InScreenExtent) { ScreenExtent = InScreenExtent; }
+
+	/** Decode ABS_X, ABS_Y, ABS_PRESSURE, ABS_DISTANCE and ABS_TILT_* with the given range. Other codes are ignored. */
+	void SetAxis(uint16 AbsCode, const FEvdevAxisInfo& Info);
+
+	bool HasAxis(uint16 AbsCode) const { return AbsCode < EvdevCode::AbsCount && Axes[AbsCode].IsUsed; }
+
+	/**
+	 * Decode NumEvents events in order, InOutState ends up as the last event left it.
+	 * OnReport(const FEvdevStylusState&) sees the state at every SYN_REPORT.
+	 * OnResync(FEvdevStylusState&) is called at the SYN_REPORT ending the events skipped after a
+	 * drop, before any event after it, and may decode the current state of the device into it.
+	 * Returns the number of reports.
+	 */
+	template <typename FunctorType, typename ResyncFunctorType>
+	int32 Decode(const FEvdevRawEvent* Events, int32 NumEvents, FEvdevStylusState& InOutState, FunctorType&& OnReport, ResyncFunctorType&& OnResync);
+
+	template <typename FunctorType>
+	int32 Decode(const FEvdevRawEvent* Events, int32 NumEvents, FEvdevStylusState& InOutState, FunctorType&& OnReport)
+	{
+		return Decode(Events, NumEvents, InOutState, Forward<FunctorType>(OnReport), [](FEvdevStylusState&) {});
+	}
+
+	/** Times the kernel dropped events since the decoder was created. */
+	uint32 GetNumDropped() const { return NumDropped; }
+
+private:
+	struct FAxis
+	{
+		float Scale { 0.0f };
+		float Bias { 0.0f };
+		EEvdevStylusField Field { EEvdevStylusField::Num };
+		bool IsUsed { false };
+	};
+
+	FAxis Axes[EvdevCode::AbsCount];
+	FVector2D ScreenExtent { 0.0f, 0.0f };
+	bool IsSkippingToReport { false };
+	uint32 NumDropped { 0 };
+};
+
+template <typename FunctorType, typename ResyncFunctorType>
+int32 FEvdevStylusDecoder::Decode(const FEvdevRawEvent* Events, int32 NumEvents, FEvdevStylusState& InOutState, FunctorType&& OnReport, ResyncFunctorType&& OnResync)
+{
+	int32 NumReports = 0;
+	for (const FEvdevRawEvent* Event = Events; Event != Events + NumEvents; ++Event)
+	{
+		if (Event->Type == EvdevCode::EvSyn)
+		{
+			if (Event->Code == EvdevCode::SynReport)
+			{
+				if (IsSkippingToReport)
+				{
+					IsSkippingToReport = false;
+					OnResync(InOutState);
+				}
+				else
+				{
+					OnReport(static_cast<const FEvdevStylusState&>(InOutState));
+					++NumReports;
+				}
+			}
+			else if (Event->Code == EvdevCode::SynDropped)
+			{
+				IsSkippingToReport = true;
+				++NumDropped;
+			}
+		}
+		else if (IsSkippingToReport)
+		{
+			continue;
+		}
+		else if (Event->Type == EvdevCode::EvAbs)
+		{
+			if (Event->Code < EvdevCode::AbsCount && Axes[Event->Code].IsUsed)
+			{
+				const FAxis& Axis = Axes[Event->Code];
+				InOutState.Values[(int32)Axis.Field] = (float)Event->Value * Axis.Scale + Axis.Bias;
+			}
+		}
+		else if (Event->Type == EvdevCode::EvKey)
+		{
+			if (Event->Code == EvdevCode::BtnTouch)
+			{
+				InOutState.IsTouching = Event->Value != 0;
+			}
+			else if (Event->Code == EvdevCode::BtnToolRubber)
+			{
+				InOutState.IsInverted = Event->Value != 0;
+			}
+		}
+	}
+	return NumReports;
+}
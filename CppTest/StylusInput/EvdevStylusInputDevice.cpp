@@ -0,0 +1,179 @@
+#include "EvdevStylusInputDevice.h"
+#include "Common.h"
+
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+PRAGMA_OPTION
+
+FEvdevFileEventSource::FEvdevFileEventSource(const FString& InPath)
+	: File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*InPath))
+{
+}
+
+FEvdevFileEventSource::~FEvdevFileEventSource()
+{
+	delete File;
+}
+
+void FEvdevFileEventSource::SetAxisInfo(uint16 AbsCode, const FEvdevAxisInfo& Info)
+{
+	if (AbsCode < EvdevCode::AbsCount)
+	{
+		Axes[AbsCode] = Info;
+		HasAxes[AbsCode] = true;
+	}
+}
+
+bool FEvdevFileEventSource::GetAxisInfo(uint16 AbsCode, FEvdevAxisInfo& OutInfo) const
+{
+	if (AbsCode >= EvdevCode::AbsCount || !HasAxes[AbsCode])
+	{
+		return false;
+	}
+	OutInfo = Axes[AbsCode];
+	return true;
+}
+
+int32 FEvdevFileEventSource::Read(FEvdevRawEvent* OutEvents, int32 MaxEvents)
+{
+	if (File == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	// A cut off event at the end is left out
+	const int64 NumLeft = (File->Size() - File->Tell()) / (int64)sizeof(FEvdevRawEvent);
+	const int32 NumRead = (int32)FMath::Min<int64>(NumLeft, MaxEvents);
+	if (NumRead == 0 || !File->Read(reinterpret_cast<uint8*>(OutEvents), NumRead * sizeof(FEvdevRawEvent)))
+	{
+		return INDEX_NONE;
+	}
+	return NumRead;
+}
+
+FEvdevStylusInputDevice::FEvdevStylusInputDevice(TUniquePtr<IEvdevEventSource> InSource, const FVector2D& ScreenExtent, const TCHAR* ThreadName)
+	: Source(MoveTemp(InSource))
+{
+	check(Source.IsValid());
+
+	// The reader updates the state any time, Tick checks for a new one itself
+	Dirty = true;
+
+	Decoder.SetScreenExtent(ScreenExtent);
+	static const uint16 AbsCodes[] = {
+		EvdevCode::AbsX, EvdevCode::AbsY, EvdevCode::AbsPressure, EvdevCode::AbsDistance, EvdevCode::AbsTiltX, EvdevCode::AbsTiltY
+	};
+	for (uint16 AbsCode : AbsCodes)
+	{
+		FEvdevAxisInfo Info;
+		if (Source->GetAxisInfo(AbsCode, Info))
+		{
+			Decoder.SetAxis(AbsCode, Info);
+		}
+	}
+
+	if (Decoder.HasAxis(EvdevCode::AbsX) && Decoder.HasAxis(EvdevCode::AbsY))
+	{
+		SupportedInputs.Add(EStylusInputType::Position);
+	}
+	if (Decoder.HasAxis(EvdevCode::AbsPressure))
+	{
+		SupportedInputs.Add(EStylusInputType::Pressure);
+	}
+	if (Decoder.HasAxis(EvdevCode::AbsDistance))
+	{
+		SupportedInputs.Add(EStylusInputType::Z);
+	}
+	if (Decoder.HasAxis(EvdevCode::AbsTiltX) || Decoder.HasAxis(EvdevCode::AbsTiltY))
+	{
+		SupportedInputs.Add(EStylusInputType::Tilt);
+	}
+
+	Thread = FRunnableThread::Create(this, ThreadName, 0, TPri_AboveNormal);
+}
+
+FEvdevStylusInputDevice::~FEvdevStylusInputDevice()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
+}
+
+int32 FEvdevStylusInputDevice::PopSamples(TArray<FStylusSample>& OutSamples)
+{
+	return Samples.PopAll(OutSamples);
+}
+
+void FEvdevStylusInputDevice::Tick()
+{
+	if (HasNewState.exchange(false, std::memory_order_acquire))
+	{
+		FScopeLock Lock(&LatestStateLock);
+		PreviousState = CurrentState;
+		CurrentState = LatestState.ToPublicState();
+	}
+}
+
+static FStylusSample ToSample(const FEvdevStylusState& State, double TimeSeconds)
+{
+	FStylusSample Sample;
+	Sample.TimeSeconds = TimeSeconds;
+	Sample.Position = FVector2D(State.GetValue(EEvdevStylusField::PositionX), State.GetValue(EEvdevStylusField::PositionY));
+	Sample.Pressure = State.GetValue(EEvdevStylusField::Pressure);
+	Sample.Tilt = FVector2D(State.GetValue(EEvdevStylusField::TiltX), State.GetValue(EEvdevStylusField::TiltY));
+	Sample.IsDown = State.IsTouching;
+	return Sample;
+}
+
+uint32 FEvdevStylusInputDevice::Run()
+{
+	while (!Stopping.load(std::memory_order_relaxed))
+	{
+		const int32 NumRead = Source->Read(Events, BatchSize);
+		if (NumRead == INDEX_NONE)
+		{
+			break;
+		}
+		if (NumRead == 0)
+		{
+			continue;
+		}
+
+		// Like the RealTimeStylus packets, every report of a batch is stamped when it was read
+		const double TimeSeconds = FPlatformTime::Seconds();
+		auto OnReport = [this, TimeSeconds](const FEvdevStylusState& State)
+		{
+			Samples.Push(ToSample(State, TimeSeconds));
+			ReportedState = State;
+		};
+		int32 NumBatchReports = 0;
+
+		// What the kernel dropped is unknown, so the state is set to what the device says it is now
+		auto OnResync = [this, &OnReport, &NumBatchReports](FEvdevStylusState& State)
+		{
+			const int32 NumResyncEvents = Source->Resync(ResyncEvents, BatchSize);
+			NumBatchReports += Decoder.Decode(ResyncEvents, NumResyncEvents, State, OnReport);
+		};
+		const int32 NumDecodedReports = Decoder.Decode(Events, NumRead, ReaderState, OnReport, OnResync);
+		NumBatchReports += NumDecodedReports;
+		NumEvents.fetch_add(NumRead, std::memory_order_relaxed);
+		if (NumBatchReports > 0)
+		{
+			NumReports.fetch_add(NumBatchReports, std::memory_order_relaxed);
+			FScopeLock Lock(&LatestStateLock);
+			LatestState = ReportedState;
+			HasNewState.store(true, std::memory_order_release);
+		}
+	}
+
+	Finished.store(true, std::memory_order_release);
+	return 0;
+}
+
+void FEvdevStylusInputDevice::Stop()
+{
+	Stopping.store(true, std::memory_order_relaxed);
+}
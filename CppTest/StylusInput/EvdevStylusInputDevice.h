@@ -0,0 +1,116 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/CriticalSection.h"
+
+#include "IStylusState.h"
+#include "EvdevStylusDecoder.h"
+
+#include <atomic>
+
+class FRunnableThread;
+class IFileHandle;
+
+/**
+ * Where the evdev events of a pen come from, read on the reader thread only.
+ */
+class IEvdevEventSource
+{
+public:
+	virtual ~IEvdevEventSource() {}
+
+	/** Range of an ABS axis the source sends, false for axes it doesn't have. */
+	virtual bool GetAxisInfo(uint16 AbsCode, FEvdevAxisInfo& OutInfo) const = 0;
+
+	/**
+	 * Read up to MaxEvents events into OutEvents. Waits for events a tenth of a second at most,
+	 * so the reader can be stopped. Returns how many were read, 0 when none came in time,
+	 * and INDEX_NONE when the source has ended or the device went away.
+	 */
+	virtual int32 Read(FEvdevRawEvent* OutEvents, int32 MaxEvents) = 0;
+
+	/**
+	 * After the kernel dropped events, write the state the keys and axes are in now into OutEvents,
+	 * as the events that would set it ending with a SYN_REPORT. Returns how many, 0 when the
+	 * source can't tell, like a capture.
+	 */
+	virtual int32 Resync(FEvdevRawEvent* OutEvents, int32 MaxEvents) { return 0; }
+};
+
+/**
+ * Plays back a file of FEvdevRawEvent, such as `cat /dev/input/eventN > Pen.bin`, as fast as it
+ * can be read. The captures don't have the axis ranges, they are set before the reader starts.
+ */
+class FEvdevFileEventSource : public IEvdevEventSource
+{
+public:
+	explicit FEvdevFileEventSource(const FString& InPath);
+	virtual ~FEvdevFileEventSource();
+
+	bool IsValid() const { return File != nullptr; }
+	void SetAxisInfo(uint16 AbsCode, const FEvdevAxisInfo& Info);
+
+	virtual bool GetAxisInfo(uint16 AbsCode, FEvdevAxisInfo& OutInfo) const override;
+	virtual int32 Read(FEvdevRawEvent* OutEvents, int32 MaxEvents) override;
+
+private:
+	IFileHandle* File { nullptr };
+	FEvdevAxisInfo Axes[EvdevCode::AbsCount];
+	bool HasAxes[EvdevCode::AbsCount] { };
+};
+
+/**
+ * A pen read through evdev on a reader thread of its own.
+ *
+ * The thread reads the events a batch at a time into a fixed buffer and decodes them with
+ * FEvdevStylusDecoder, every report goes to the game thread through a FStylusSampleQueue,
+ * so nothing is allocated per event. Tick takes the state of the last report. After the kernel
+ * dropped events the source resyncs the state, so a lost BTN_TOUCH release doesn't leave the
+ * pen down.
+ */
+class FEvdevStylusInputDevice : public IStylusInputDevice, public FRunnable
+{
+public:
+	/** Reads of the reader thread, a pen at 200 Hz sends about 7 events per report. */
+	static constexpr int32 BatchSize = 64;
+
+	/** ScreenExtent is the size in device independent pixels of the screen the pen maps to, see FEvdevStylusDecoder::SetScreenExtent. */
+	FEvdevStylusInputDevice(TUniquePtr<IEvdevEventSource> InSource, const FVector2D& ScreenExtent, const TCHAR* ThreadName);
+	virtual ~FEvdevStylusInputDevice();
+
+	virtual int32 PopSamples(TArray<FStylusSample>& OutSamples) override;
+	virtual void Tick() override;
+
+	/** True once the source ended, a file played back or a device unplugged. */
+	bool IsFinished() const { return Finished.load(std::memory_order_acquire); }
+
+	/** Counts of the reader thread so far. */
+	uint64 GetNumEvents() const { return NumEvents.load(std::memory_order_relaxed); }
+	uint64 GetNumReports() const { return NumReports.load(std::memory_order_relaxed); }
+	uint32 GetNumDropped() const { return Samples.GetNumDropped(); }
+
+	// FRunnable, on the reader thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	TUniquePtr<IEvdevEventSource> Source;
+	FRunnableThread* Thread { nullptr };
+
+	// Reader thread only
+	FEvdevStylusDecoder Decoder;
+	FEvdevStylusState ReaderState;		// Can be in the middle of a report
+	FEvdevStylusState ReportedState;	// At the last SYN_REPORT
+	FEvdevRawEvent Events[BatchSize];
+	FEvdevRawEvent ResyncEvents[BatchSize];
+
+	FStylusSampleQueue Samples;
+	FCriticalSection LatestStateLock;
+	FEvdevStylusState LatestState;
+	std::atomic<bool> HasNewState { false };
+	std::atomic<bool> Stopping { false };
+	std::atomic<bool> Finished { false };
+	std::atomic<uint64> NumEvents { 0 };
+	std::atomic<uint64> NumReports { 0 };
+};
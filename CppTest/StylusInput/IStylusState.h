@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Math/Vector2D.h"
+#include "StylusSampleQueue.h"
 #define STYLUSINPUT_API DLLEXPORT
 
 /**
@@ -144,6 +145,13 @@ public:
 	 */
 	const TArray<EStylusInputType>& GetSupportedInputs() const { return SupportedInputs; }
 
+	/**
+	 * Append every sample received since the last call, oldest first, and return how many.
+	 * Unlike the current state, this doesn't lose the packets that arrive between two frames.
+	 * Devices that don't queue their packets add none.
+	 */
+	virtual int32 PopSamples(TArray<FStylusSample>& OutSamples) { return 0; }
+
 	/** Update the input device. Not intended to be called externally. */ 
 	virtual void Tick() = 0;
 
@@ -157,6 +165,26 @@ protected:
 	bool Dirty : 1;
 };
 
+/** The stylus input devices of a platform, ticked by the game thread. */
+class STYLUSINPUT_API IStylusInputInterface
+{
+public:
+
+	virtual ~IStylusInputInterface() {}
+
+	/** Update the devices. */
+	virtual void Tick() = 0;
+
+	virtual int32 NumInputDevices() const = 0;
+	virtual IStylusInputDevice* GetInputDevice(int32 Index) const = 0;
+};
+
+/**
+ * Create the stylus input of the platform, RealTimeStylus on Windows and evdev on Linux.
+ * Returns null when the platform has none or no stylus could be found.
+ */
+TSharedPtr<IStylusInputInterface> CreateStylusInputInterface();
+
 /**
  * Interface to implement for classes that want to receive messages when a stylus state change occurs.
  * Will trigger once per frame.
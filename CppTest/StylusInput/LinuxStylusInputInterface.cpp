@@ -0,0 +1,229 @@
+#include "LinuxStylusInputInterface.h"
+#include "EvdevStylusInputDevice.h"
+
+#if PLATFORM_LINUX
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformApplicationMisc.h"
+#include "Framework/Application/SlateApplication.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogStylusInput, Log, All);
+
+static_assert(sizeof(input_event) == sizeof(FEvdevRawEvent), "Events are read into FEvdevRawEvent directly.");
+static_assert(EV_SYN == EvdevCode::EvSyn && EV_KEY == EvdevCode::EvKey && EV_ABS == EvdevCode::EvAbs, "Event types differ.");
+static_assert(SYN_REPORT == EvdevCode::SynReport && SYN_DROPPED == EvdevCode::SynDropped, "Sync codes differ.");
+static_assert(BTN_TOOL_PEN == EvdevCode::BtnToolPen && BTN_TOOL_RUBBER == EvdevCode::BtnToolRubber && BTN_TOUCH == EvdevCode::BtnTouch, "Key codes differ.");
+static_assert(ABS_X == EvdevCode::AbsX && ABS_Y == EvdevCode::AbsY && ABS_PRESSURE == EvdevCode::AbsPressure
+	&& ABS_DISTANCE == EvdevCode::AbsDistance && ABS_TILT_X == EvdevCode::AbsTiltX && ABS_TILT_Y == EvdevCode::AbsTiltY
+	&& ABS_CNT == EvdevCode::AbsCount, "Axis codes differ.");
+
+/** How long a read waits for events, so the reader notices it is stopped. */
+static const int32 ReadTimeoutMilliseconds = 100;
+
+static bool TestBit(const unsigned long* Bits, int32 Bit)
+{
+	const int32 BitsPerLong = sizeof(unsigned long) * 8;
+	return (Bits[Bit / BitsPerLong] >> (Bit % BitsPerLong)) & 1;
+}
+
+/**
+ * A /dev/input/eventN device, opened non-blocking and read after poll.
+ */
+class FEvdevDeviceEventSource : public IEvdevEventSource
+{
+public:
+	/** Open the device at Path, null when it can't be read or isn't a pen with pressure. */
+	static TUniquePtr<FEvdevDeviceEventSource> Open(const FString& Path)
+	{
+		const int FileDescriptor = open(TCHAR_TO_UTF8(*Path), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (FileDescriptor < 0)
+		{
+			return nullptr;
+		}
+
+		TUniquePtr<FEvdevDeviceEventSource> Source(new FEvdevDeviceEventSource(FileDescriptor));
+		unsigned long KeyBits[KEY_CNT / (sizeof(unsigned long) * 8) + 1] = { };
+		unsigned long AbsBits[ABS_CNT / (sizeof(unsigned long) * 8) + 1] = { };
+		if (ioctl(FileDescriptor, EVIOCGBIT(EV_KEY, sizeof(KeyBits)), KeyBits) < 0
+			|| ioctl(FileDescriptor, EVIOCGBIT(EV_ABS, sizeof(AbsBits)), AbsBits) < 0
+			|| !TestBit(KeyBits, BTN_TOOL_PEN) || !TestBit(AbsBits, ABS_X) || !TestBit(AbsBits, ABS_Y) || !TestBit(AbsBits, ABS_PRESSURE))
+		{
+			return nullptr;
+		}
+
+		for (int32 AbsCode = 0; AbsCode < ABS_CNT; ++AbsCode)
+		{
+			input_absinfo AbsInfo;
+			if (TestBit(AbsBits, AbsCode) && ioctl(FileDescriptor, EVIOCGABS(AbsCode), &AbsInfo) >= 0)
+			{
+				Source->Axes[AbsCode] = { AbsInfo.minimum, AbsInfo.maximum, AbsInfo.resolution };
+				Source->HasAxes[AbsCode] = true;
+			}
+		}
+
+		char Name[256] = { };
+		ioctl(FileDescriptor, EVIOCGNAME(sizeof(Name) - 1), Name);
+		UE_LOG(LogStylusInput, Log, TEXT("Found pen %s at %s."), UTF8_TO_TCHAR(Name), *Path);
+		return Source;
+	}
+
+	virtual ~FEvdevDeviceEventSource()
+	{
+		close(FileDescriptor);
+	}
+
+	virtual bool GetAxisInfo(uint16 AbsCode, FEvdevAxisInfo& OutInfo) const override
+	{
+		if (AbsCode >= EvdevCode::AbsCount || !HasAxes[AbsCode])
+		{
+			return false;
+		}
+		OutInfo = Axes[AbsCode];
+		return true;
+	}
+
+	virtual int32 Read(FEvdevRawEvent* OutEvents, int32 MaxEvents) override
+	{
+		pollfd PollDescriptor = { FileDescriptor, POLLIN, 0 };
+		const int NumReady = poll(&PollDescriptor, 1, ReadTimeoutMilliseconds);
+		if (NumReady < 0)
+		{
+			return errno == EINTR ? 0 : INDEX_NONE;
+		}
+		if (NumReady == 0)
+		{
+			return 0;
+		}
+		if (PollDescriptor.revents & (POLLERR | POLLHUP | POLLNVAL))
+		{
+			// Unplugged
+			return INDEX_NONE;
+		}
+
+		const ssize_t NumBytes = read(FileDescriptor, OutEvents, MaxEvents * sizeof(FEvdevRawEvent));
+		if (NumBytes < 0)
+		{
+			return errno == EAGAIN || errno == EINTR ? 0 : INDEX_NONE;
+		}
+		return (int32)(NumBytes / sizeof(FEvdevRawEvent));
+	}
+
+	virtual int32 Resync(FEvdevRawEvent* OutEvents, int32 MaxEvents) override
+	{
+		unsigned long KeyBits[KEY_CNT / (sizeof(unsigned long) * 8) + 1] = { };
+		if (MaxEvents < 1 || ioctl(FileDescriptor, EVIOCGKEY(sizeof(KeyBits)), KeyBits) < 0)
+		{
+			return 0;
+		}
+
+		// The last one is kept for the SYN_REPORT
+		int32 NumEvents = 0;
+		auto AddEvent = [OutEvents, MaxEvents, &NumEvents](uint16 Type, uint16 Code, int32 Value)
+		{
+			if (NumEvents < MaxEvents - 1)
+			{
+				OutEvents[NumEvents++] = { 0, 0, Type, Code, Value };
+			}
+		};
+		AddEvent(EV_KEY, BTN_TOUCH, TestBit(KeyBits, BTN_TOUCH) ? 1 : 0);
+		AddEvent(EV_KEY, BTN_TOOL_RUBBER, TestBit(KeyBits, BTN_TOOL_RUBBER) ? 1 : 0);
+		for (int32 AbsCode = 0; AbsCode < ABS_CNT; ++AbsCode)
+		{
+			input_absinfo AbsInfo;
+			if (HasAxes[AbsCode] && ioctl(FileDescriptor, EVIOCGABS(AbsCode), &AbsInfo) >= 0)
+			{
+				AddEvent(EV_ABS, AbsCode, AbsInfo.value);
+			}
+		}
+		OutEvents[NumEvents++] = { 0, 0, EV_SYN, SYN_REPORT, 0 };
+		return NumEvents;
+	}
+
+private:
+	explicit FEvdevDeviceEventSource(int InFileDescriptor) : FileDescriptor(InFileDescriptor) {}
+
+	int FileDescriptor;
+	FEvdevAxisInfo Axes[EvdevCode::AbsCount];
+	bool HasAxes[EvdevCode::AbsCount] { };
+};
+
+FLinuxStylusInputInterface::FLinuxStylusInputInterface(TArray<TUniquePtr<FEvdevStylusInputDevice>>&& InDevices)
+	: Devices(MoveTemp(InDevices))
+{
+}
+
+FLinuxStylusInputInterface::~FLinuxStylusInputInterface() = default;
+
+void FLinuxStylusInputInterface::Tick()
+{
+	// Pens plugged in later aren't picked up, the readers of unplugged ones have finished
+}
+
+int32 FLinuxStylusInputInterface::NumInputDevices() const
+{
+	return Devices.Num();
+}
+
+IStylusInputDevice* FLinuxStylusInputInterface::GetInputDevice(int32 Index) const
+{
+	IStylusInputDevice* Result = nullptr;
+	if (Index >= 0 && Index < Devices.Num())
+	{
+		Result = Devices[Index].Get();
+	}
+	return Result;
+}
+
+/**
+ * The desktop in device independent pixels, which a tablet in absolute mode maps onto.
+ * Zero without Slate, e.g. headless or before it is up, so the decoder keeps device units.
+ */
+static FVector2D GetScreenExtent()
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		return FVector2D::ZeroVector;
+	}
+
+	FDisplayMetrics DisplayMetrics;
+	FSlateApplication::Get().GetCachedDisplayMetrics(DisplayMetrics);
+	const FPlatformRect& Desktop = DisplayMetrics.VirtualDisplayRect;
+	const float DPIScale = FPlatformApplicationMisc::GetDPIScaleFactorAtPoint((float)Desktop.Left, (float)Desktop.Top);
+	return FVector2D(Desktop.Right - Desktop.Left, Desktop.Bottom - Desktop.Top) / FMath::Max(DPIScale, 1e-3f);
+}
+
+TSharedPtr<IStylusInputInterface> CreateStylusInputInterface()
+{
+	const FString InputDirectory = TEXT("/dev/input");
+	TArray<FString> DeviceNames;
+	IFileManager::Get().FindFiles(DeviceNames, *(InputDirectory / TEXT("event*")), true, false);
+	DeviceNames.Sort();
+
+	const FVector2D ScreenExtent = GetScreenExtent();
+	TArray<TUniquePtr<FEvdevStylusInputDevice>> Devices;
+	for (const FString& DeviceName : DeviceNames)
+	{
+		TUniquePtr<FEvdevDeviceEventSource> Source = FEvdevDeviceEventSource::Open(InputDirectory / DeviceName);
+		if (Source.IsValid())
+		{
+			const FString ThreadName = FString::Printf(TEXT("StylusReader%d"), Devices.Num());
+			Devices.Add(MakeUnique<FEvdevStylusInputDevice>(MoveTemp(Source), ScreenExtent, *ThreadName));
+		}
+	}
+
+	if (Devices.Num() == 0)
+	{
+		UE_LOG(LogStylusInput, Display, TEXT("No readable pen in %s, is the user in the input group?"), *InputDirectory);
+		return nullptr;
+	}
+	return MakeShared<FLinuxStylusInputInterface>(MoveTemp(Devices));
+}
+
+#endif // PLATFORM_LINUX
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include "IStylusState.h"
+
+#if PLATFORM_LINUX
+
+class FEvdevStylusInputDevice;
+
+/**
+ * The pens of /dev/input, found once when the interface is created, each read on its own thread.
+ * The user needs to be allowed to read them, usually by being in the `input` group.
+ */
+class FLinuxStylusInputInterface : public IStylusInputInterface
+{
+public:
+	FLinuxStylusInputInterface(TArray<TUniquePtr<FEvdevStylusInputDevice>>&& InDevices);
+	virtual ~FLinuxStylusInputInterface();
+
+	virtual void Tick() override;
+	virtual int32 NumInputDevices() const override;
+	virtual IStylusInputDevice* GetInputDevice(int32 Index) const override;
+
+private:
+	TArray<TUniquePtr<FEvdevStylusInputDevice>> Devices;
+};
+
+#endif // PLATFORM_LINUX
@@ -0,0 +1,93 @@
+#include "StylusPacketDecoder.h"
+#include "Common.h"
+PRAGMA_OPTION
+
+// Value * Scale + Bias == (Value - Minimum) / (Maximum - Minimum)
+static FStylusPacketDecoder::FStep MakeNormalizeStep(int32 Offset, const FPacketDescription& Description, FStylusPacketDecoder::EField Field)
+{
+	const int32 Range = Description.Maximum - Description.Minimum;
+	const float Scale = Range != 0 ? 1.0f / (float)Range : 0.0f;
+	return { Offset, Scale, -(float)Description.Minimum * Scale, Field };
+}
+
+// Value * Scale == Value / Resolution
+static FStylusPacketDecoder::FStep MakeDegreesStep(int32 Offset, const FPacketDescription& Description, FStylusPacketDecoder::EField Field)
+{
+	const float Scale = Description.Resolution != 0 ? 1.0f / Description.Resolution : 0.0f;
+	return { Offset, Scale, 0.0f, Field };
+}
+
+void FStylusPacketDecoder::Setup(const TArray<FPacketDescription>& PacketDescriptions)
+{
+	Steps.Reset();
+	PropertyCount = PacketDescriptions.Num();
+
+	for (int32 Offset = 0; Offset < PacketDescriptions.Num(); ++Offset)
+	{
+		const FPacketDescription& Description = PacketDescriptions[Offset];
+		switch (Description.Type)
+		{
+			case EWindowsPacketType::X:
+				Steps.Add({ Offset, 1.0f, 0.0f, EField::PositionX });
+				break;
+			case EWindowsPacketType::Y:
+				Steps.Add({ Offset, 1.0f, 0.0f, EField::PositionY });
+				break;
+			case EWindowsPacketType::Z:
+				Steps.Add(MakeNormalizeStep(Offset, Description, EField::Z));
+				break;
+			case EWindowsPacketType::NormalPressure:
+				Steps.Add(MakeNormalizeStep(Offset, Description, EField::NormalPressure));
+				break;
+			case EWindowsPacketType::TangentPressure:
+				Steps.Add(MakeNormalizeStep(Offset, Description, EField::TangentPressure));
+				break;
+			case EWindowsPacketType::Twist:
+				Steps.Add(MakeDegreesStep(Offset, Description, EField::Twist));
+				break;
+			case EWindowsPacketType::XTilt:
+				Steps.Add(MakeDegreesStep(Offset, Description, EField::TiltX));
+				break;
+			case EWindowsPacketType::YTilt:
+				Steps.Add(MakeDegreesStep(Offset, Description, EField::TiltY));
+				break;
+			case EWindowsPacketType::Width:
+				Steps.Add(MakeNormalizeStep(Offset, Description, EField::Width));
+				break;
+			case EWindowsPacketType::Height:
+				Steps.Add(MakeNormalizeStep(Offset, Description, EField::Height));
+				break;
+			default:
+				// Status, button pressure and the orientations aren't part of the state
+				break;
+		}
+	}
+}
+
+void FStylusPacketDecoder::ToValues(const FWindowsStylusState& State, float* OutValues)
+{
+	OutValues[(int32)EField::PositionX] = State.Position.X;
+	OutValues[(int32)EField::PositionY] = State.Position.Y;
+	OutValues[(int32)EField::Z] = State.Z;
+	OutValues[(int32)EField::NormalPressure] = State.NormalPressure;
+	OutValues[(int32)EField::TangentPressure] = State.TangentPressure;
+	OutValues[(int32)EField::Twist] = State.Twist;
+	OutValues[(int32)EField::TiltX] = State.Tilt.X;
+	OutValues[(int32)EField::TiltY] = State.Tilt.Y;
+	OutValues[(int32)EField::Width] = State.Size.X;
+	OutValues[(int32)EField::Height] = State.Size.Y;
+}
+
+void FStylusPacketDecoder::FromValues(const float* Values, FWindowsStylusState& OutState)
+{
+	OutState.Position.X = Values[(int32)EField::PositionX];
+	OutState.Position.Y = Values[(int32)EField::PositionY];
+	OutState.Z = Values[(int32)EField::Z];
+	OutState.NormalPressure = Values[(int32)EField::NormalPressure];
+	OutState.TangentPressure = Values[(int32)EField::TangentPressure];
+	OutState.Twist = Values[(int32)EField::Twist];
+	OutState.Tilt.X = Values[(int32)EField::TiltX];
+	OutState.Tilt.Y = Values[(int32)EField::TiltY];
+	OutState.Size.X = Values[(int32)EField::Width];
+	OutState.Size.Y = Values[(int32)EField::Height];
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IStylusState.h"
+
+/**
+ * Packet types as derived from IRealTimeStylus::GetPacketDescriptionData.
+ */
+enum class EWindowsPacketType
+{
+	None,
+	X,
+	Y,
+	Z,
+	Status,
+	NormalPressure,
+	TangentPressure,
+	ButtonPressure,
+	Azimuth,
+	Altitude,
+	Twist,
+	XTilt,
+	YTilt,
+	Width,
+	Height,
+};
+
+/**
+ * Stylus state for a single frame.
+ */
+struct FWindowsStylusState
+{
+	FVector2D Position;
+	float Z;
+	FVector2D Tilt;
+	float Twist;
+	float NormalPressure;
+	float TangentPressure;
+	FVector2D Size;
+	bool IsTouching : 1;
+	bool IsInverted : 1;
+
+	FWindowsStylusState() :
+		Position(0, 0), Z(0), Tilt(0, 0), Twist(0), NormalPressure(0), TangentPressure(0),
+		Size(0, 0), IsTouching(false), IsInverted(false)
+	{
+	}
+
+	FStylusState ToPublicState() const
+	{
+		return FStylusState(Position, Z, Tilt, Twist, NormalPressure, TangentPressure, Size, IsTouching, IsInverted);
+	}
+};
+
+/**
+ * Description of a packet's information, as derived from IRealTimeStylus::GetPacketDescriptionData.
+ */
+struct FPacketDescription
+{
+	EWindowsPacketType Type { EWindowsPacketType::None };
+	int32 Minimum { 0 };
+	int32 Maximum { 0 };
+	float Resolution { 0 };
+};
+
+/**
+ * Decodes RealTimeStylus packet buffers, every packet of a batch, into FWindowsStylusState.
+ *
+ * Setup compiles the packet descriptions of a tablet into a plan with one step per property
+ * that is used: where it is in the packet, the scale and bias that normalize it or turn it
+ * into degrees, and the field of the state it goes to. Decoding is then a loop over the
+ * steps per packet, without looking at the property types again. Properties a tablet
+ * doesn't send keep their value from the packets before.
+ *
+ * Plain data in and out, so it builds and can be tested on any platform.
+ */
+class FStylusPacketDecoder
+{
+public:
+	/** Fields of FWindowsStylusState a packet property can go to. */
+	enum class EField : uint8
+	{
+		PositionX,
+		PositionY,
+		Z,
+		NormalPressure,
+		TangentPressure,
+		Twist,
+		TiltX,
+		TiltY,
+		Width,
+		Height,
+		Num
+	};
+
+	struct FStep
+	{
+		int32 Offset;	// Of the property in a packet
+		float Scale;
+		float Bias;
+		EField Field;
+	};
+
+	void Setup(const TArray<FPacketDescription>& PacketDescriptions);
+
+	/** Properties per packet the plan was made for, used or not. */
+	int32 GetPropertyCount() const { return PropertyCount; }
+
+	const TArray<FStep>& GetSteps() const { return Steps; }
+
+	/**
+	 * Decode PacketCount packets of PropertyCount values each, in order. InOutState ends up
+	 * as the last packet left it, and OnPacket(const FWindowsStylusState&) sees every packet.
+	 * Returns the number of packets decoded, none if the buffer doesn't fit the plan.
+	 */
+	template <typename FunctorType>
+	int32 Decode(const int32* Packets, int32 PacketCount, int32 InPropertyCount, FWindowsStylusState& InOutState, FunctorType&& OnPacket) const;
+
+private:
+	static void ToValues(const FWindowsStylusState& State, float* OutValues);
+	static void FromValues(const float* Values, FWindowsStylusState& OutState);
+
+	TArray<FStep> Steps;
+	int32 PropertyCount { 0 };
+};
+
+template <typename FunctorType>
+int32 FStylusPacketDecoder::Decode(const int32* Packets, int32 PacketCount, int32 InPropertyCount, FWindowsStylusState& InOutState, FunctorType&& OnPacket) const
+{
+	if (PacketCount <= 0 || InPropertyCount != PropertyCount)
+	{
+		return 0;
+	}
+
+	float Values[(int32)EField::Num];
+	ToValues(InOutState, Values);
+
+	const FStep* FirstStep = Steps.GetData();
+	const FStep* LastStep = FirstStep + Steps.Num();
+	for (int32 PacketIdx = 0; PacketIdx < PacketCount; ++PacketIdx)
+	{
+		const int32* Packet = Packets + PacketIdx * PropertyCount;
+		for (const FStep* Step = FirstStep; Step != LastStep; ++Step)
+		{
+			Values[(int32)Step->Field] = (float)Packet[Step->Offset] * Step->Scale + Step->Bias;
+		}
+
+		FromValues(Values, InOutState);
+		OnPacket(static_cast<const FWindowsStylusState&>(InOutState));
+	}
+	return PacketCount;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/**
+ * One stylus packet, as it arrived between two frames.
+ */
+struct FStylusSample
+{
+	/** FPlatformTime::Seconds() when the packet arrived. */
+	double TimeSeconds { 0.0 };
+
+	/**
+	 * Position in device independent pixels relative to the window the stylus is over.
+	 * Consumers only rely on the path between samples, not on where it starts.
+	 */
+	FVector2D Position { 0.0f, 0.0f };
+
+	/** Normal pressure in [0, 1]. */
+	float Pressure { 0.0f };
+
+	/** Tilt in degrees, see FStylusState::GetTilt. */
+	FVector2D Tilt { 0.0f, 0.0f };
+
+	bool IsDown { false };
+};
+
+/**
+ * Lock-free ring buffer from exactly one producer thread to exactly one consumer thread,
+ * such as the stylus callback thread and the game thread.
+ *
+ * Neither side ever waits for the other: when the consumer falls behind and the buffer
+ * is full, Push drops the new element and counts it instead.
+ */
+template <typename ElementType, uint32 Capacity>
+class TStylusSampleQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+	TStylusSampleQueue() = default;
+	TStylusSampleQueue(const TStylusSampleQueue&) = delete;
+	TStylusSampleQueue& operator=(const TStylusSampleQueue&) = delete;
+
+	/** Producer only. Returns false and drops the element when the queue is full. */
+	bool Push(const ElementType& Element)
+	{
+		const uint32 Head = WriteIndex.load(std::memory_order_relaxed);
+		if (Head - ReadIndex.load(std::memory_order_acquire) == Capacity)
+		{
+			NumDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		Elements[Head & (Capacity - 1)] = Element;
+		WriteIndex.store(Head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Consumer only. Appends everything pushed so far, oldest first, and returns how many. */
+	int32 PopAll(TArray<ElementType>& OutElements)
+	{
+		uint32 Tail = ReadIndex.load(std::memory_order_relaxed);
+		const uint32 Head = WriteIndex.load(std::memory_order_acquire);
+		const int32 NumPopped = (int32)(Head - Tail);
+
+		OutElements.Reserve(OutElements.Num() + NumPopped);
+		for (; Tail != Head; ++Tail)
+		{
+			OutElements.Add(Elements[Tail & (Capacity - 1)]);
+		}
+		ReadIndex.store(Tail, std::memory_order_release);
+		return NumPopped;
+	}
+
+	/** Elements Push had to drop since the queue was created. */
+	uint32 GetNumDropped() const { return NumDropped.load(std::memory_order_relaxed); }
+
+	static constexpr uint32 GetCapacity() { return Capacity; }
+
+private:
+	// Running counts, wrapping around, each on its own cache line so the two threads don't share one
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> WriteIndex { 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> ReadIndex { 0 };
+	std::atomic<uint32> NumDropped { 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) ElementType Elements[Capacity];
+};
+
+/** Room for a bit over a second of a 200 Hz pen, when the game thread hitches. */
+typedef TStylusSampleQueue<FStylusSample, 256> FStylusSampleQueue;
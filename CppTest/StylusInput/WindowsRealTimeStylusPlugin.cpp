@@ -46,6 +46,8 @@ HRESULT FWindowsRealTimeStylusPlugin::StylusUp(IRealTimeStylus* InRealTimeStylus
 
 static void SetupPacketDescriptions(IRealTimeStylus* InRealTimeStylus, FTabletContextInfo& TabletContext)
 {
+	TabletContext.PacketDescriptions.Reset();
+
 	ULONG NumPacketProperties = 0;
 	PACKET_PROPERTY* PacketProperties = nullptr;
 	HRESULT hr = InRealTimeStylus->GetPacketDescriptionData(TabletContext.ID, nullptr, nullptr, &NumPacketProperties, &PacketProperties);
@@ -123,6 +125,8 @@ static void SetupPacketDescriptions(IRealTimeStylus* InRealTimeStylus, FTabletCo
 
 		::CoTaskMemFree(PacketProperties);
 	}
+
+	TabletContext.PacketDecoder.Setup(TabletContext.PacketDescriptions);
 }
 
 static void SetupTabletSupportedPackets(TComPtr<IRealTimeStylus> InRealTimeStylus, FTabletContextInfo& TabletContext)
@@ -368,20 +372,24 @@ HRESULT FWindowsRealTimeStylusPlugin::TabletRemoved(IRealTimeStylus* InRealTimeS
 	return S_OK;
 }
 
-static float Normalize(int Value, const FPacketDescription& Desc)
-{
-	return (float) (Value - Desc.Minimum) / (float) (Desc.Maximum - Desc.Minimum);
-}
+// Packet positions are in HIMETRIC, 0.01 mm, and a device independent pixel is 1/96 inch.
+static const float HimetricPerPixel = 2540.0f / 96.0f;
 
-static float ToDegrees(int Value, const FPacketDescription& Desc)
+static FStylusSample ToSample(const FWindowsStylusState& State)
 {
-	return Value / Desc.Resolution;
+	FStylusSample Sample;
+	Sample.TimeSeconds = FPlatformTime::Seconds();
+	Sample.Position = State.Position / HimetricPerPixel;
+	Sample.Pressure = State.NormalPressure;
+	Sample.Tilt = State.Tilt;
+	Sample.IsDown = State.IsTouching;
+	return Sample;
 }
 
 void FWindowsRealTimeStylusPlugin::HandlePacket(IRealTimeStylus* InRealTimeStylus, const StylusInfo* StylusInfo, ULONG PacketCount, ULONG PacketBufferLength, LONG* Packets)
 {
 	FTabletContextInfo* TabletContext = FindTabletContext(StylusInfo->tcid);
-	if (TabletContext == nullptr)
+	if (TabletContext == nullptr || PacketCount == 0)
 	{
 		return;
 	}
@@ -389,50 +397,16 @@ void FWindowsRealTimeStylusPlugin::HandlePacket(IRealTimeStylus* InRealTimeStylu
 	TabletContext->SetDirty();
 	TabletContext->WindowsState.IsInverted = StylusInfo->bIsInvertedCursor;
 
-	ULONG PropertyCount = PacketBufferLength / PacketCount;
+	static_assert(sizeof(LONG) == sizeof(int32), "Packet values are 32 bit.");
+	const int32 PropertyCount = PacketBufferLength / PacketCount;
 
-	for (ULONG i = 0; i < PropertyCount; ++i)
-	{
-		const FPacketDescription& PacketDescription = TabletContext->PacketDescriptions[i];
-
-		float Normalized = Normalize(Packets[i], PacketDescription);
-
-		switch (PacketDescription.Type)
+	// Every packet of the batch goes to the game thread, the state ends up as the last one left it
+	FStylusSampleQueue& Samples = TabletContext->Samples.Get();
+	TabletContext->PacketDecoder.Decode(reinterpret_cast<const int32*>(Packets), PacketCount, PropertyCount, TabletContext->WindowsState,
+		[&Samples](const FWindowsStylusState& State)
 		{
-			case EWindowsPacketType::X:
-				TabletContext->WindowsState.Position.X = Packets[i];
-				break;
-			case EWindowsPacketType::Y:
-				TabletContext->WindowsState.Position.Y = Packets[i];
-				break;
-			case EWindowsPacketType::Status:
-				break;
-			case EWindowsPacketType::Z:
-				TabletContext->WindowsState.Z = Normalized;
-				break;
-			case EWindowsPacketType::NormalPressure:
-				TabletContext->WindowsState.NormalPressure = Normalized;
-				break;
-			case EWindowsPacketType::TangentPressure:
-				TabletContext->WindowsState.TangentPressure = Normalized;
-				break;
-			case EWindowsPacketType::Twist:
-				TabletContext->WindowsState.Twist = ToDegrees(Packets[i], PacketDescription);
-				break;
-			case EWindowsPacketType::XTilt:
-				TabletContext->WindowsState.Tilt.X = ToDegrees(Packets[i], PacketDescription);
-				break;
-			case EWindowsPacketType::YTilt:
-				TabletContext->WindowsState.Tilt.Y = ToDegrees(Packets[i], PacketDescription);
-				break;
-			case EWindowsPacketType::Width:
-				TabletContext->WindowsState.Size.X = Normalized;
-				break;
-			case EWindowsPacketType::Height:
-				TabletContext->WindowsState.Size.Y = Normalized;
-				break;
-		}
-	}
+			Samples.Push(ToSample(State));
+		});
 }
 
 HRESULT FWindowsRealTimeStylusPlugin::Packets(IRealTimeStylus* InRealTimeStylus, const StylusInfo* StylusInfo,
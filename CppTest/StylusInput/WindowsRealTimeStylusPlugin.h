@@ -16,66 +16,7 @@
 #include "Windows/HideWindowsPlatformTypes.h"
 
 #include "IStylusState.h"
-
-/**
- * Packet types as derived from IRealTimeStylus::GetPacketDescriptionData.
- */
-enum class EWindowsPacketType
-{
-	None,
-	X,
-	Y,
-	Z,
-	Status,
-	NormalPressure,
-	TangentPressure,
-	ButtonPressure,
-	Azimuth,
-	Altitude,
-	Twist,
-	XTilt,
-	YTilt,
-	Width,
-	Height,
-};
-
-/**
- * Stylus state for a single frame.
- */
-struct FWindowsStylusState
-{
-	FVector2D Position;
-	float Z;
-	FVector2D Tilt;
-	float Twist;
-	float NormalPressure;
-	float TangentPressure;
-	FVector2D Size;
-	bool IsTouching : 1;
-	bool IsInverted : 1;
-
-	FWindowsStylusState() :
-		Position(0, 0), Z(0), Tilt(0, 0), Twist(0), NormalPressure(0), TangentPressure(0),
-		Size(0, 0), IsTouching(false), IsInverted(false)
-	{
-	}
-
-	FStylusState ToPublicState() const
-	{
-		return FStylusState(Position, Z, Tilt, Twist, NormalPressure, TangentPressure, Size, IsTouching, IsInverted);
-	}
-};
-
-/**
- * Description of a packet's information, as derived from IRealTimeStylus::GetPacketDescriptionData.
- */
-struct FPacketDescription
-{
-	EWindowsPacketType Type { EWindowsPacketType::None };
-	int32 Minimum { 0 };
-	int32 Maximum { 0 };
-	float Resolution { 0 };
-};
+#include "StylusPacketDecoder.h"
 
 struct FTabletContextInfo : public IStylusInputDevice
 {
@@ -84,12 +25,21 @@ struct FTabletContextInfo : public IStylusInputDevice
 	TABLET_CONTEXT_ID ID;
 	TArray<FPacketDescription> PacketDescriptions;
 	TArray<EWindowsPacketType> SupportedPackets;
+	FStylusPacketDecoder PacketDecoder;
 
 	FWindowsStylusState WindowsState;
 
+	/** Every packet, from the stylus thread to the game thread. Shared so the context can be moved. */
+	TSharedRef<FStylusSampleQueue, ESPMode::ThreadSafe> Samples { MakeShared<FStylusSampleQueue, ESPMode::ThreadSafe>() };
+
 	void AddSupportedInput(EStylusInputType Type) { SupportedInputs.Add(Type); }
 	void SetDirty() { Dirty = true; }
 
+	virtual int32 PopSamples(TArray<FStylusSample>& OutSamples) override
+	{
+		return Samples->PopAll(OutSamples);
+	}
+
 	virtual void Tick() override
 	{
 		PreviousState = CurrentState;
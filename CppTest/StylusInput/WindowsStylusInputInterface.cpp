@@ -176,7 +176,7 @@ FWindowsStylusInputInterfaceImpl::~FWindowsStylusInputInterfaceImpl()
 	}
 }
 
-TSharedPtr<FWindowsStylusInputInterface> CreateStylusInputInterface()
+TSharedPtr<IStylusInputInterface> CreateStylusInputInterface()
 {
 	if (!FWindowsPlatformMisc::CoInitialize()) 
 	{
@@ -9,15 +9,15 @@
 class FWindowsStylusInputInterfaceImpl;
 class SWindow;
 
-class FWindowsStylusInputInterface
+class FWindowsStylusInputInterface : public IStylusInputInterface
 {
 public:
 	FWindowsStylusInputInterface(TUniquePtr<FWindowsStylusInputInterfaceImpl> InImpl);
 	virtual ~FWindowsStylusInputInterface();
 
-	virtual void Tick();
-	virtual int NumInputDevices() const;
-	virtual IStylusInputDevice* GetInputDevice(int Index) const;
+	virtual void Tick() override;
+	virtual int32 NumInputDevices() const override;
+	virtual IStylusInputDevice* GetInputDevice(int32 Index) const override;
 
 private:
 	// pImpl to avoid including Windows headers.
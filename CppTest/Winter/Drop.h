@@ -4,7 +4,26 @@
 const float kBirthTimeNotInitialized = -2.0f;
 const float kBirthTimeOutsideOfFinger = -1.0f;   // Outside of finger tip, ready to be active
 const float kDensity = .75f;
+const float kOverlapFactor = 0.55f;
+const float kTrailDistanceMin = 20.0f;  // A moving drop leaves a trail drop every this far at least
+const float kTrailDistanceMax = 50.0f;
 
+
+inline float GetDropMass(float Radius) {
+    return Radius * Radius * kDensity;
+}
+
+inline bool AreDropsOverlapped(
+    const FVector2D& Position1, float Radius1, const FVector2D& Position2, float Radius2)
+{
+    return (Position2 - Position1).Size() <= (Radius1 + Radius2) * kOverlapFactor;
+}
+
+
+/*
+* A single drop by value. The drop system keeps its drops as columns in `DropStorage`,
+* this class describes one row of it, e.g. for emitting.
+*/
 class Drop
 {
 public:
@@ -23,17 +42,13 @@ public:
         , Stretch(Stretch)
         , Radius(Radius)
         , BirthTimeSeconds(BirthTimeSeconds)
+        , DistanceNoTrail(0.0f)
+        , NextTrailDistance(kTrailDistanceMax)     // Drawn from the drop ID when it is emitted
     {
-        ResetTrailDistance();
     };
 
-    bool AreOverlapped(Drop* Another) {
-        return (Another->Position - Position).Size() <= (Another->Radius + Radius) * 0.55;
-    }
-
-    void ResetTrailDistance() {
-        DistanceNoTrail = 0;
-        NextTrailDistance = FMath::RandRange(20.0f, 50.0f);
+    bool AreOverlapped(const Drop& Another) const {
+        return AreDropsOverlapped(Position, Radius, Another.Position, Another.Radius);
     }
 
     bool IsActive() const {
@@ -45,11 +60,10 @@ public:
     }
 
     float GetMass() const {
-        return Radius * Radius * kDensity;
+        return GetDropMass(Radius);
     }
 
     void AdjustArea(float Delta) {
         Radius = FMath::Sqrt( Radius * Radius + Delta);
     }
 };
-
@@ -0,0 +1,1734 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Winter/DropBenchmarkCommandlet.h"
+
+#include "DropSystem.h"
+#include "DropIntegration.h"
+#include "DropCurve.h"
+#include "DropSplat.h"
+#include "DropPipeline.h"
+#include "DropSnapshot.h"
+#include "Common.h"
+
+#include <HAL/FileManager.h>
+#include <HAL/MemoryBase.h>
+#include <HAL/ThreadSafeCounter64.h>
+#include <Misc/Crc.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Parse.h>
+#include <Misc/Paths.h>
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogDropBenchmark, Log, All);
+
+// Whether the timings are worth comparing: the engine and the code after PRAGMA_OPTION optimized.
+const bool kBenchmarkOptimized = kPragmaOptionOptimizes && !UE_BUILD_DEBUG;
+
+const FVector2D kBenchmarkFieldSize(2048.0f, 2048.0f);
+const int kBenchmarkMovedEvery = 10;            // One in ten drops is moving
+const int kBenchmarkBruteForceMaxDrops = 20000; // Brute force gets too slow above this
+const int kBenchmarkStrokeFrames = 600;
+const float kBenchmarkStrokeSpeed = 40.0f;      // px per frame
+const float kBenchmarkStrokeStep = 5.0f;        // px, as the brush
+const float kBenchmarkStrokeEmitChance = 0.3f;
+const float kBenchmarkFingerRadius = 5.5f;
+const int kBenchmarkIntegrationSteps = 100;
+const int kBenchmarkDrawFrames = 60;
+const float kBenchmarkDrawFrameSeconds = 1.0f / 60.0f;
+const int kBenchmarkScenarioFrames = 60;
+const int kBenchmarkStorageCompareEvery = 4096; // Operations between comparing every drop
+const int kBenchmarkStorageDeadIDs = 1024;      // Killed IDs kept to check they stay dead
+const int kBenchmarkGridStartDrops = 1000;
+const int kBenchmarkGridQueries = 200;
+const float kBenchmarkGridQuerySize = 100.0f;
+const int kBenchmarkGridMinBuckets = 1024;      // The grid keeps at least this many, and entries until they are stale
+const int kBenchmarkSleepingFrames = 300;
+const int kBenchmarkFixedStepFrames = 120;
+const float kBenchmarkFixedStepSeconds = 1.0f / 30.0f;
+const float kBenchmarkHitchSeconds = 1.0f;
+const int kBenchmarkWarmUpFrames = 120;        // Long enough for the scratch buffers to reach their size
+const float kBenchmarkMergeSpacing = 4.0f;      // px between drops of a merge storm, less than their radius
+const int kBenchmarkCapsuleStrokes = 200;
+const int kBenchmarkBudgetFrames = 120;
+const int kBenchmarkRandomNumbers = 1 << 22;
+const int kBenchmarkSessionFrames = 300;
+const int kBenchmarkSessionEmitsPerFrame = 64;
+const int kBenchmarkCurveSamples = 1 << 22;
+const float kBenchmarkCurveMaxError = 2e-4f;      // Every curve the drops use, whatever its exponent
+const int kBenchmarkBudgetMaxDrops = 20000;
+const float kBenchmarkBudgetTickMilliseconds = 2.0f;
+const float kBenchmarkCapsuleMaxLength = 200.0f; // px a finger moves in one frame at most
+const float kBenchmarkSettledSeconds = 2.0f;    // Drops stop changing shape after a second
+const int kBenchmarkDirtyKills = 8;
+const int kBenchmarkSpriteSize = 64;
+const int kBenchmarkPipelineFrames = 120;
+const int kBenchmarkSoftwareFrames = 10;
+const float kBenchmarkSplatTolerance = 1e-4f;   // Clipped quads sample the sprite at rounded UVs
+const int kBenchmarkSnapshotFrames = 120;       // Before and after the snapshot each
+const int kBenchmarkSnapshotEmitsPerFrame = 32;
+const float kBenchmarkSnapshotKillRadius = 40.0f;
+
+
+/*
+* Forwards to the allocator it wraps and counts the allocations going through it, from
+* any thread.
+*/
+class FDropBenchmarkMalloc : public FMalloc
+{
+public:
+    explicit FDropBenchmarkMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+    void* Malloc(SIZE_T Size, uint32 Alignment) override
+    {
+        Count(Size);
+        return Inner->Malloc(Size, Alignment);
+    }
+
+    void* Realloc(void* Original, SIZE_T Size, uint32 Alignment) override
+    {
+        if (Size)
+            Count(Size);
+        return Inner->Realloc(Original, Size, Alignment);
+    }
+
+    void Free(void* Original) override
+    {
+        Inner->Free(Original);
+    }
+
+    SIZE_T QuantizeSize(SIZE_T Size, uint32 Alignment) override
+    {
+        return Inner->QuantizeSize(Size, Alignment);
+    }
+
+    bool GetAllocationSize(void* Original, SIZE_T& OutSize) override
+    {
+        return Inner->GetAllocationSize(Original, OutSize);
+    }
+
+    bool IsInternallyThreadSafe() const override
+    {
+        return Inner->IsInternallyThreadSafe();
+    }
+
+    const TCHAR* GetDescriptiveName() override
+    {
+        return TEXT("DropBenchmark");
+    }
+
+    FThreadSafeCounter64 NumAllocations;
+    FThreadSafeCounter64 NumBytes;
+
+private:
+    void Count(SIZE_T Size)
+    {
+        NumAllocations.Increment();
+        NumBytes.Add(Size);
+    }
+
+    FMalloc* Inner;
+};
+
+// Counts allocations while in scope. Blocks freed afterwards still go to the same allocator.
+struct FScopedDropBenchmarkMalloc
+{
+    FScopedDropBenchmarkMalloc() : Previous(GMalloc), Counter(GMalloc)
+    {
+        GMalloc = &Counter;
+    }
+
+    ~FScopedDropBenchmarkMalloc()
+    {
+        GMalloc = Previous;
+    }
+
+    FMalloc* Previous;
+    FDropBenchmarkMalloc Counter;
+};
+
+UDropBenchmarkCommandlet::UDropBenchmarkCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 UDropBenchmarkCommandlet::Main(const FString& Params)
+{
+    FString Only;
+    FParse::Value(*Params, TEXT("only="), Only);
+    if (!Only.IsEmpty() && Only != TEXT("checks") && Only != TEXT("scenarios")) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("-only=%s is neither checks nor scenarios."), *Only);
+        return 1;
+    }
+    if (!kBenchmarkOptimized)
+        UE_LOG(LogDropBenchmark, Warning, TEXT("Built without optimization, the timings are no baseline."));
+
+    bool Succeeded = true;
+    if (Only != TEXT("scenarios"))
+        Succeeded &= RunChecks(Params);
+    if (Only != TEXT("checks"))
+        Succeeded &= RunScenarios(Params);
+    return Succeeded ? 0 : 1;
+}
+
+bool UDropBenchmarkCommandlet::RunChecks(const FString& Params)
+{
+    bool Succeeded = true;
+    Succeeded &= CheckStorageAgainstMap(1 << 18);
+    for (int NumDrops : {1000, 10000, 100000})
+        Succeeded &= BenchmarkOverlaps(NumDrops);
+    Succeeded &= BenchmarkStrokeChurn(10000);
+    Succeeded &= CheckGridChurn(100000);
+    Succeeded &= BenchmarkIntegration(100000);
+    Succeeded &= BenchmarkDrawBatching(100000);
+    Succeeded &= CheckDirtyTiles(20000);
+    Succeeded &= CheckSoftwareDraw(5000);
+
+    FString ImagePath;
+    FParse::Value(*Params, TEXT("image="), ImagePath);
+    Succeeded &= BenchmarkSoftwareDraw(10000, ImagePath);
+    Succeeded &= CheckTickAllocations(10000);
+    Succeeded &= CheckSleepThreshold(1024);
+    Succeeded &= CheckSleepingDrops(20000);
+    Succeeded &= CheckFixedStep(10000);
+    Succeeded &= CheckMergeCluster(5);
+    Succeeded &= CheckCapsuleKill(100000);
+    Succeeded &= BenchmarkDropBudget();
+    Succeeded &= BenchmarkRandom();
+    Succeeded &= CheckRandomSession(20000);
+    Succeeded &= CheckPipeline(20000);
+    Succeeded &= CheckSnapshot(100000);
+    Succeeded &= BenchmarkCurves();
+    return Succeeded;
+}
+
+bool UDropBenchmarkCommandlet::RunScenarios(const FString& Params)
+{
+    bool Succeeded = true;
+    FString ScenarioList = TEXT("static,sliding,stroke,merge");
+    FString DropsList = TEXT("1000,10000,100000");
+    FString CsvPath, FrameCsvPath;
+    int NumFrames = kBenchmarkScenarioFrames;
+    FParse::Value(*Params, TEXT("scenarios="), ScenarioList);
+    FParse::Value(*Params, TEXT("drops="), DropsList);
+    FParse::Value(*Params, TEXT("frames="), NumFrames);
+    FParse::Value(*Params, TEXT("csv="), CsvPath);
+    FParse::Value(*Params, TEXT("framecsv="), FrameCsvPath);
+
+    TArray<FString> ScenarioNames, DropCounts;
+    ScenarioList.ParseIntoArray(ScenarioNames, TEXT(","));
+    DropsList.ParseIntoArray(DropCounts, TEXT(","));
+
+    FString Csv = TEXT("scenario,drops,frames,simulate_ns_per_drop,clip_ns_per_drop,split_trail_ns_per_drop,")
+        TEXT("overlaps_ns_per_drop,tick_ns_per_drop,simulated_drops_per_frame,allocations_per_frame,")
+        TEXT("allocated_bytes_per_frame,drops_end,optimized\n");
+    FString FrameCsv = TEXT("scenario,drops,frame,drops_before,simulated,sleeping,active,moved,pairs_tested,")
+        TEXT("pairs_found,merged,splits,killed,evicted,tick_ms\n");
+    for (const FString& ScenarioName : ScenarioNames) {
+        for (const FString& DropCount : DropCounts)
+            Succeeded &= RunScenario(ScenarioName, FCString::Atoi(*DropCount), NumFrames, Csv, FrameCsv);
+    }
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Scenarios:\n%s"), *Csv);
+    if (!CsvPath.IsEmpty() && !FFileHelper::SaveStringToFile(Csv, *CsvPath)) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Could not write %s."), *CsvPath);
+        Succeeded = false;
+    }
+    if (!FrameCsvPath.IsEmpty() && !FFileHelper::SaveStringToFile(FrameCsv, *FrameCsvPath)) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Could not write %s."), *FrameCsvPath);
+        Succeeded = false;
+    }
+    return Succeeded;
+}
+
+
+static bool AreDropsEqual(const Drop& A, const Drop& B)
+{
+    return A.Position == B.Position && A.Velocity == B.Velocity && A.Stretch == B.Stretch &&
+        A.Radius == B.Radius && A.BirthTimeSeconds == B.BirthTimeSeconds &&
+        A.DistanceNoTrail == B.DistanceNoTrail && A.NextTrailDistance == B.NextTrailDistance;
+}
+
+/*
+* Plays a random sequence of emits, kills by ID, sweeps that remove while iterating, edits
+* through IDs and sleeping or waking on the storage and on a TMap of drops keyed by ID, the
+* way DropSystem kept them before the storage. Every kBenchmarkStorageCompareEvery operations
+* and at the end it fails unless both have the same drops under the same IDs, bit for bit,
+* and the recently killed IDs resolve to nothing.
+*/
+bool UDropBenchmarkCommandlet::CheckStorageAgainstMap(int NumOperations)
+{
+    DropRandomSequence Random(NumOperations);
+    DropStorage Storage;
+    TMap<int, Drop> Reference;
+    TArray<int> DeadIDs;
+    int NumCompared = 0, NumMismatches = 0;
+
+    auto Compare = [&]() {
+        NumMismatches += Storage.Num() == Reference.Num() ? 0 : 1;
+        for (const auto& Pair : Reference) {
+            int Index = Storage.IndexOf(Pair.Key);
+            NumMismatches += Index != INDEX_NONE && Storage.IDs[Index] == Pair.Key
+                && AreDropsEqual(Storage.Get(Index), Pair.Value) ? 0 : 1;
+        }
+        for (int ID : DeadIDs)
+            NumMismatches += Reference.Contains(ID) || !Storage.Contains(ID) ? 0 : 1;
+        NumCompared += Reference.Num();
+    };
+
+    for (int Operation = 0; Operation < NumOperations; ++Operation) {
+        float Choice = Random.GetUnit();
+        if (Choice < 0.45f || Storage.Num() == 0) {
+            Drop NewDrop(
+                FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+                FVector2D(Random.GetRange(-50.0f, 50.0f), Random.GetRange(0.0f, 100.0f)), FVector2D(1.0f, Random.GetUnit()),
+                Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), Random.GetRange(-2.0f, 10.0f)
+            );
+            NewDrop.DistanceNoTrail = Random.GetRange(0.0f, kTrailDistanceMin);
+            NewDrop.NextTrailDistance = Random.GetRange(kTrailDistanceMin, kTrailDistanceMax);
+            int ID = Storage.Add(NewDrop);
+            NumMismatches += Reference.Contains(ID) ? 1 : 0;
+            Reference.Add(ID, NewDrop);
+            continue;
+        }
+
+        int ID = Storage.IDs[FMath::Min((int)(Random.GetUnit() * Storage.Num()), Storage.Num() - 1)];
+        if (Choice < 0.75f) {
+            Storage.Remove(ID);
+            NumMismatches += Reference.Remove(ID) == 1 ? 0 : 1;
+            DeadIDs.Add(ID);
+            if (DeadIDs.Num() > kBenchmarkStorageDeadIDs)
+                DeadIDs.RemoveAt(0, DeadIDs.Num() - kBenchmarkStorageDeadIDs, false);
+        }
+        else if (Choice < 0.85f) {
+            int Index = Storage.IndexOf(ID);
+            if (Index < Storage.NumAwake())
+                Storage.Sleep(Index);
+            else
+                Storage.Wake(Index);
+        }
+        else if (Choice < 0.995f) {
+            // Moved and grown through its ID, as the stages edit a drop
+            FVector2D Offset(Random.GetRange(-5.0f, 5.0f), Random.GetRange(0.0f, 5.0f));
+            float Area = Random.GetRange(0.0f, 20.0f);
+            int Index = Storage.IndexOf(ID);
+            Storage.PositionX[Index] += Offset.X;
+            Storage.PositionY[Index] += Offset.Y;
+            Storage.AdjustArea(Index, Area);
+            Drop* Found = Reference.Find(ID);
+            if (Found == nullptr) {
+                ++NumMismatches;
+                continue;
+            }
+            Found->Position.X += Offset.X;
+            Found->Position.Y += Offset.Y;
+            Found->AdjustArea(Area);
+        }
+        else {
+            // Clip the drops below a line, removing while sweeping backwards
+            float ClipY = Random.GetRange(0.8f, 1.0f) * kBenchmarkFieldSize.Y;
+            for (int Index = Storage.Num() - 1; Index >= 0; --Index) {
+                if (Storage.PositionY[Index] > ClipY)
+                    Storage.RemoveAt(Index);
+            }
+            for (auto It = Reference.CreateIterator(); It; ++It) {
+                if (It.Value().Position.Y > ClipY)
+                    It.RemoveCurrent();
+            }
+        }
+
+        if (Operation % kBenchmarkStorageCompareEvery == 0)
+            Compare();
+    }
+    Compare();
+
+    if (NumMismatches > 0) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Drop storage differs from the map of drops %d times in %d operations."),
+            NumMismatches, NumOperations);
+        return false;
+    }
+    UE_LOG(LogDropBenchmark, Display, TEXT("Drop storage matches the map of drops over %d operations, %d drops compared, %d alive"),
+        NumOperations, NumCompared, Storage.Num());
+    return true;
+}
+
+static double TimeOverlaps(DropSystem& Drops, TArray<IDPair>& OutPairs)
+{
+    OutPairs.Reset();
+    double StartSeconds = FPlatformTime::Seconds();
+    Drops.FindOverlappedPairs(OutPairs);
+    return (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+}
+
+static void SortPairs(TArray<IDPair>& Pairs)
+{
+    for (auto& Pair : Pairs) {
+        if (Pair.first > Pair.second)
+            std::swap(Pair.first, Pair.second);
+    }
+    Pairs.Sort();
+}
+
+/*
+* Times the grid against the brute force overlap detection on a field of random drops,
+* and checks both find the same pairs.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkOverlaps(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f
+        );
+        if (i % kBenchmarkMovedEvery == 0)
+            Drops.m_Drops.Flags[i] = kDropFlagMoved;
+    }
+
+    TArray<IDPair> GridPairs, BruteForcePairs;
+    Drops.m_UseOverlapGrid = true;
+    double GridMilliseconds = TimeOverlaps(Drops, GridPairs);
+
+    if (NumDrops > kBenchmarkBruteForceMaxDrops) {
+        UE_LOG(LogDropBenchmark, Display, TEXT("Overlaps %6d drops: grid %8.3f ms, %d pairs"),
+            NumDrops, GridMilliseconds, GridPairs.Num());
+        return true;
+    }
+
+    Drops.m_UseOverlapGrid = false;
+    double BruteForceMilliseconds = TimeOverlaps(Drops, BruteForcePairs);
+    UE_LOG(LogDropBenchmark, Display, TEXT("Overlaps %6d drops: grid %8.3f ms, brute force %8.3f ms, %d pairs"),
+        NumDrops, GridMilliseconds, BruteForceMilliseconds, GridPairs.Num());
+
+    SortPairs(GridPairs);
+    SortPairs(BruteForcePairs);
+    if (GridPairs != BruteForcePairs) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Grid and brute force found different pairs with %d drops."), NumDrops);
+        return false;
+    }
+    return true;
+}
+
+/*
+* Drags a finger in zigzags through a field of drops, emitting and killing drops along
+* the way like AGM_Winter::OnMouseMove, and reports how often the drop pool had to grow.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkStrokeChurn(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxDefault), 0.0f
+        );
+    }
+
+    DropPoolStats StatsBefore = Drops.GetPoolStats();
+    FVector2D FingerPos(0.0f, 0.0f);
+    FVector2D Direction(1.0f, 0.25f);
+    int NumEmitted = 0;
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int Frame = 0; Frame < kBenchmarkStrokeFrames; ++Frame) {
+        for (float Moved = 0.0f; Moved < kBenchmarkStrokeSpeed; Moved += kBenchmarkStrokeStep) {
+            FingerPos += Direction * kBenchmarkStrokeStep;
+            if (FingerPos.X < 0.0f || FingerPos.X > kBenchmarkFieldSize.X)
+                Direction.X = -Direction.X;
+            if (FingerPos.Y < 0.0f || FingerPos.Y > kBenchmarkFieldSize.Y)
+                Direction.Y = -Direction.Y;
+
+            if (Random.GetUnit() < kBenchmarkStrokeEmitChance) {
+                Drops.Emit(
+                    FingerPos + FVector2D(Random.GetRange(-10.0f, 10.0f), Random.GetRange(-10.0f, 10.0f)),
+                    FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+                    Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxDefault), 0.0f
+                );
+                NumEmitted++;
+            }
+            Drops.Kill(FingerPos, kBenchmarkFingerRadius);
+        }
+    }
+    double Milliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+
+    DropPoolStats StatsAfter = Drops.GetPoolStats();
+    int NumGrowths = StatsAfter.NumGrowths - StatsBefore.NumGrowths;
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Stroke churn %d frames: %.3f ms, %d emitted, %d recycled, %d live, %d peak, %d pool growths (%.4f per frame)"),
+        kBenchmarkStrokeFrames, Milliseconds, NumEmitted,
+        StatsAfter.NumRecycled - StatsBefore.NumRecycled, StatsAfter.NumLive, StatsAfter.NumPeak,
+        NumGrowths, (float)NumGrowths / kBenchmarkStrokeFrames);
+    return true;
+}
+
+/*
+* Grows the drops a hundredfold, then kills them back down and churns them, inserting into
+* the grid the way DropSystem does. Fails if the entries, stale ones included, are more than twice
+* the live drops plus kBenchmarkGridMinBuckets, if there are more drops than buckets, or if a
+* box query misses a drop in the box or visits one twice.
+*/
+bool UDropBenchmarkCommandlet::CheckGridChurn(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropStorage Drops;
+    DropGrid Grid;
+    auto EmitRandomDrop = [&]() {
+        Drop NewDrop(FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize, FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxDefault), 0.0f);
+        Grid.Insert(Drops, Drops.IndexOf(Drops.Add(NewDrop)));
+    };
+    for (int i = 0; i < kBenchmarkGridStartDrops; ++i)
+        EmitRandomDrop();
+    Grid.Build(Drops);
+
+    int MaxEntriesOver = 0, MaxDropsPerBucket = 0;
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int i = 0; i < 2 * NumDrops; ++i) {
+        // Killing two for every one emitted shrinks the drops back, one for one churns them
+        int NumKills = i < NumDrops ? 0 : Drops.Num() > kBenchmarkGridStartDrops ? 2 : 1;
+        for (int Kill = 0; Kill < NumKills; ++Kill)
+            Drops.RemoveAt(FMath::Min((int)(Random.GetUnit() * Drops.Num()), Drops.Num() - 1));
+        EmitRandomDrop();
+        // A drop bigger than the cells invalidates the grid, DropSystem builds it before the next query
+        if (!Grid.IsValid())
+            Grid.Build(Drops);
+        MaxEntriesOver = FMath::Max(MaxEntriesOver, Grid.GetNumEntries() - 2 * Drops.Num());
+        MaxDropsPerBucket = FMath::Max(MaxDropsPerBucket, FMath::DivideAndRoundUp(Drops.Num(), Grid.GetNumBuckets()));
+    }
+    double Milliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+
+    TArray<int> VisitCounts;
+    int NumMissed = 0, NumTwice = 0;
+    for (int Query = 0; Query < kBenchmarkGridQueries; ++Query) {
+        FVector2D Min = FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize;
+        FVector2D Max = Min + FVector2D(kBenchmarkGridQuerySize, kBenchmarkGridQuerySize);
+        VisitCounts.SetNumZeroed(Drops.Num());
+        Grid.ForEachInBox(Drops, Min, Max, [&](int Index) { VisitCounts[Index]++; });
+        for (int i = 0; i < Drops.Num(); ++i) {
+            bool IsInBox = Drops.PositionX[i] >= Min.X && Drops.PositionX[i] <= Max.X
+                && Drops.PositionY[i] >= Min.Y && Drops.PositionY[i] <= Max.Y;
+            NumMissed += IsInBox && VisitCounts[i] == 0 ? 1 : 0;
+            NumTwice += VisitCounts[i] > 1 ? 1 : 0;
+        }
+    }
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Grid churn %d drops: %.3f ms, %d entries for %d drops in %d buckets, at most %d entries over twice the drops"),
+        NumDrops, Milliseconds, Grid.GetNumEntries(), Drops.Num(), Grid.GetNumBuckets(), MaxEntriesOver);
+    if (MaxEntriesOver > kBenchmarkGridMinBuckets || MaxDropsPerBucket > 1 || NumMissed > 0 || NumTwice > 0) {
+        UE_LOG(LogDropBenchmark, Error,
+            TEXT("Grid kept %d entries over twice the drops, %d drops per bucket, missed %d drops and visited %d twice."),
+            MaxEntriesOver, MaxDropsPerBucket, NumMissed, NumTwice);
+        return false;
+    }
+    return true;
+}
+
+static bool IsNearlyEqualRelative(float A, float B, float Tolerance)
+{
+    return FMath::Abs(A - B) <= Tolerance * FMath::Max(1.0f, FMath::Max(FMath::Abs(A), FMath::Abs(B)));
+}
+
+static bool AreColumnsNearlyEqual(const TArray<float>& A, const TArray<float>& B, float Tolerance)
+{
+    for (int i = 0; i < A.Num(); ++i) {
+        if (!IsNearlyEqualRelative(A[i], B[i], Tolerance))
+            return false;
+    }
+    return true;
+}
+
+/*
+* Times the scalar and SIMD integration kernels, and checks they agree after one step.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkIntegration(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropStorage Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Add(Drop(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0f, Random.GetUnit() < 0.5f ? 0.0f : Random.GetRange(0.0f, 20.0f)),
+            FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f
+        ));
+    }
+
+    DropIntegrationParams Params;
+    Params.DeltaSeconds = 1.0f / 60.0f;
+    Params.Gravity = 10.0f;
+    Params.StaticFriction = 450.0f;
+    Params.DynamicFriction = 430.0f;
+    Params.VelocityScale = 20.0f;
+    Params.RandomCounter = 0;
+
+    DropStorage ScalarDrops = Drops;
+    DropStorage SimdDrops = Drops;
+    IntegrateDropsScalar(ScalarDrops, 0, NumDrops, Params);
+    IntegrateDropsSimd(SimdDrops, 0, NumDrops, Params);
+    bool Agreed = AreColumnsNearlyEqual(ScalarDrops.PositionX, SimdDrops.PositionX, kDropIntegrationTolerance) &&
+        AreColumnsNearlyEqual(ScalarDrops.PositionY, SimdDrops.PositionY, kDropIntegrationTolerance) &&
+        AreColumnsNearlyEqual(ScalarDrops.VelocityY, SimdDrops.VelocityY, kDropIntegrationTolerance) &&
+        AreColumnsNearlyEqual(ScalarDrops.Radius, SimdDrops.Radius, kDropIntegrationTolerance) &&
+        AreColumnsNearlyEqual(ScalarDrops.DistanceNoTrail, SimdDrops.DistanceNoTrail, kDropIntegrationTolerance);
+
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int Step = 0; Step < kBenchmarkIntegrationSteps; ++Step) {
+        Params.RandomCounter = Step;
+        IntegrateDropsScalar(ScalarDrops, 0, NumDrops, Params);
+    }
+    double ScalarMilliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / kBenchmarkIntegrationSteps;
+
+    StartSeconds = FPlatformTime::Seconds();
+    for (int Step = 0; Step < kBenchmarkIntegrationSteps; ++Step) {
+        Params.RandomCounter = Step;
+        IntegrateDropsSimd(SimdDrops, 0, NumDrops, Params);
+    }
+    double SimdMilliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / kBenchmarkIntegrationSteps;
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Integration %d drops: scalar %.3f ms, SIMD %.3f ms per step"),
+        NumDrops, ScalarMilliseconds, SimdMilliseconds);
+    if (!Agreed) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Scalar and SIMD integration differ by more than %g."), kDropIntegrationTolerance);
+        return false;
+    }
+    return true;
+}
+
+/*
+* Times building the batched draw of a field of active drops, and reports how many canvas
+* items a frame takes with per drop tiles and with the triangle list.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkDrawBatching(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0, 0.0), FVector2D(Random.GetRange(0.8f, 1.2f), Random.GetRange(0.8f, 1.2f)),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f
+        );
+    }
+
+    TArray<DropQuad> Quads;
+    TArray<FCanvasUVTri> Triangles;
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int Frame = 0; Frame < kBenchmarkDrawFrames; ++Frame) {
+        Drops.GatherDropQuads(Frame * kBenchmarkDrawFrameSeconds, 1.0f, Quads);
+        DropSystem::BuildTriangles(Quads, Triangles);
+    }
+    double Milliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / kBenchmarkDrawFrames;
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Draw %d drops: %.3f ms to batch %d triangles, %d canvas items per frame as tiles, 1 batched"),
+        NumDrops, Milliseconds, Triangles.Num(), Quads.Num());
+    if (Triangles.Num() != Quads.Num() * 2) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Batched draw built %d triangles for %d quads."), Triangles.Num(), Quads.Num());
+        return false;
+    }
+    return true;
+}
+
+static void EmitScenarioDrops(DropSystem& Drops, const FString& ScenarioName, int NumDrops, DropRandomSequence& Random)
+{
+    bool IsSliding = ScenarioName == TEXT("sliding");
+    bool IsMerge = ScenarioName == TEXT("merge");
+
+    // A merge storm packs the drops into a square where every drop overlaps its neighbours
+    FVector2D FieldSize = IsMerge ?
+        FVector2D(FMath::Sqrt((float)NumDrops) * kBenchmarkMergeSpacing) : kBenchmarkFieldSize;
+    float RadiusMin = IsSliding || IsMerge ? kDropEmitRadiusMinStrokeEnd : kDropEmitRadiusMinDefault;
+    float RadiusMax = IsSliding || IsMerge ? kDropEmitRadiusMaxStrokeEnd : kDropEmitRadiusMaxDefault;
+
+    for (int i = 0; i < NumDrops; ++i) {
+        FVector2D Velocity(0.0f, IsSliding || IsMerge ? Random.GetRange(5.0f, 20.0f) : 0.0f);
+        Drops.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * FieldSize,
+            Velocity, FVector2D(0.0, 0.0),
+            Random.GetRange(RadiusMin, RadiusMax), 0.0f
+        );
+    }
+}
+
+/*
+* Ticks one scenario for `NumFrames` frames and appends a line with the cost of each
+* stage of DropSystem::Tick per drop, and the allocations per frame, to `OutCsv`.
+* Appends a line with the counters of every frame to `OutFrameCsv`.
+*   static  - drops too small to slide
+*   sliding - big drops sliding down
+*   stroke  - a finger dragged through static drops, emitting and killing like AGM_Winter
+*   merge   - sliding drops packed so tight that they all merge
+*/
+bool UDropBenchmarkCommandlet::RunScenario(
+    const FString& ScenarioName, int NumDrops, int NumFrames, FString& OutCsv, FString& OutFrameCsv
+)
+{
+    bool IsStroke = ScenarioName == TEXT("stroke");
+    if (ScenarioName != TEXT("static") && ScenarioName != TEXT("sliding") &&
+        !IsStroke && ScenarioName != TEXT("merge")) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Unknown scenario %s."), *ScenarioName);
+        return false;
+    }
+
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    Drops.m_Drops.Reserve(NumDrops);
+    EmitScenarioDrops(Drops, ScenarioName, NumDrops, Random);
+
+    FVector2D FingerPos(0.0f, 0.0f);
+    FVector2D Direction(1.0f, 0.25f);
+    DropTickStats Total;
+    TArray<DropTickStats> FrameStats;
+    FrameStats.Reserve(NumFrames);     // Outside of the counted allocations
+    int64 NumAllocations, NumBytes;
+    {
+        FScopedDropBenchmarkMalloc CountedMalloc;
+        for (int Frame = 0; Frame < NumFrames; ++Frame) {
+            if (IsStroke) {
+                for (float Moved = 0.0f; Moved < kBenchmarkStrokeSpeed; Moved += kBenchmarkStrokeStep) {
+                    FingerPos += Direction * kBenchmarkStrokeStep;
+                    if (FingerPos.X < 0.0f || FingerPos.X > kBenchmarkFieldSize.X)
+                        Direction.X = -Direction.X;
+                    if (FingerPos.Y < 0.0f || FingerPos.Y > kBenchmarkFieldSize.Y)
+                        Direction.Y = -Direction.Y;
+
+                    if (Random.GetUnit() < kBenchmarkStrokeEmitChance) {
+                        Drops.Emit(
+                            FingerPos, FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+                            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxDefault),
+                            kBirthTimeNotInitialized
+                        );
+                    }
+                    Drops.Kill(FingerPos, kBenchmarkFingerRadius);
+                }
+                Drops.MarkDropsOutsideFinger(FingerPos, kBenchmarkFingerRadius * 2.0f);
+            }
+
+            Drops.Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+            DropTickStats Stats = Drops.GetTickStats();
+            FrameStats.Add(Stats);
+            Total.NumDrops += Stats.NumDrops;
+            Total.NumSimulated += Stats.NumSimulated;
+            Total.SimulateSeconds += Stats.SimulateSeconds;
+            Total.ClipSeconds += Stats.ClipSeconds;
+            Total.SplitTrailSeconds += Stats.SplitTrailSeconds;
+            Total.OverlapSeconds += Stats.OverlapSeconds;
+        }
+        NumAllocations = CountedMalloc.Counter.NumAllocations.GetValue();
+        NumBytes = CountedMalloc.Counter.NumBytes.GetValue();
+    }
+
+    double NanosecondsPerDrop = 1e9 / FMath::Max(Total.NumDrops, 1);
+    double TickSeconds = Total.SimulateSeconds + Total.ClipSeconds + Total.SplitTrailSeconds + Total.OverlapSeconds;
+    OutCsv += FString::Printf(TEXT("%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%d,%d\n"),
+        *ScenarioName, NumDrops, NumFrames,
+        Total.SimulateSeconds * NanosecondsPerDrop, Total.ClipSeconds * NanosecondsPerDrop,
+        Total.SplitTrailSeconds * NanosecondsPerDrop, Total.OverlapSeconds * NanosecondsPerDrop,
+        TickSeconds * NanosecondsPerDrop, (double)Total.NumSimulated / FMath::Max(NumFrames, 1),
+        (double)NumAllocations / FMath::Max(NumFrames, 1), (double)NumBytes / FMath::Max(NumFrames, 1),
+        Drops.m_Drops.Num(), kBenchmarkOptimized ? 1 : 0);
+
+    for (int Frame = 0; Frame < FrameStats.Num(); ++Frame) {
+        const DropTickStats& Stats = FrameStats[Frame];
+        double TickMilliseconds =
+            (Stats.SimulateSeconds + Stats.ClipSeconds + Stats.SplitTrailSeconds + Stats.OverlapSeconds +
+            Stats.EvictSeconds) * 1000.0;
+        OutFrameCsv += FString::Printf(TEXT("%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.4f\n"),
+            *ScenarioName, NumDrops, Frame, Stats.NumDrops, Stats.NumSimulated, Stats.NumSleeping,
+            Stats.NumActive, Stats.NumMoved, Stats.NumPairsTested, Stats.NumPairsFound, Stats.NumMerged,
+            Stats.NumSplits, Stats.NumKilled, Stats.NumEvicted, TickMilliseconds);
+    }
+    return true;
+}
+
+/*
+* Ticks a field with sliding, merging and splitting drops until the scratch buffers have
+* grown, then checks further ticks do not touch the heap. Runs on the game thread only,
+* ParallelFor allocates its own task data.
+*/
+bool UDropBenchmarkCommandlet::CheckTickAllocations(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    Drops.m_NumWorkerThreads = 1;
+    Drops.m_Drops.Reserve(NumDrops * 2);
+    EmitScenarioDrops(Drops, TEXT("static"), NumDrops, Random);
+    EmitScenarioDrops(Drops, TEXT("sliding"), NumDrops / kBenchmarkMovedEvery, Random);
+
+    for (int Frame = 0; Frame < kBenchmarkWarmUpFrames; ++Frame)
+        Drops.Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+
+    int64 NumAllocations;
+    {
+        FScopedDropBenchmarkMalloc CountedMalloc;
+        for (int Frame = 0; Frame < kBenchmarkScenarioFrames; ++Frame)
+            Drops.Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+        NumAllocations = CountedMalloc.Counter.NumAllocations.GetValue();
+    }
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Tick allocations %d drops: %lld in %d frames"),
+        Drops.m_Drops.Num(), NumAllocations, kBenchmarkScenarioFrames);
+    if (NumAllocations) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("A steady tick allocated %lld times."), NumAllocations);
+        return false;
+    }
+    return true;
+}
+
+static void EmitSleepingCheckDrops(DropSystem& Drops, int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    Drops.m_NumWorkerThreads = 1;
+    EmitScenarioDrops(Drops, TEXT("static"), NumDrops, Random);
+    EmitScenarioDrops(Drops, TEXT("sliding"), NumDrops / kBenchmarkMovedEvery, Random);
+    for (int i = 0; i < Drops.m_Drops.Num(); ++i)
+        Drops.m_Drops.ResetTrailDistance(i, 0);
+}
+
+static bool AreDropsEqual(const DropStorage& A, int IndexA, const DropStorage& B, int IndexB)
+{
+    return A.PositionX[IndexA] == B.PositionX[IndexB] && A.PositionY[IndexA] == B.PositionY[IndexB] &&
+        A.VelocityX[IndexA] == B.VelocityX[IndexB] && A.VelocityY[IndexA] == B.VelocityY[IndexB] &&
+        A.Radius[IndexA] == B.Radius[IndexB] && A.BirthTimeSeconds[IndexA] == B.BirthTimeSeconds[IndexB] &&
+        A.DistanceNoTrail[IndexA] == B.DistanceNoTrail[IndexB] &&
+        A.NextTrailDistance[IndexA] == B.NextTrailDistance[IndexB];
+}
+
+/*
+* Drops at rest with radii a few float steps around the one where weight overcomes static
+* friction. Both integration paths have to move exactly the drops the sleep test keeps awake.
+*/
+bool UDropBenchmarkCommandlet::CheckSleepThreshold(int NumDrops)
+{
+    DropSystem Defaults;
+    DropIntegrationParams Params;
+    Params.DeltaSeconds = kBenchmarkDrawFrameSeconds;
+    Params.StaticFriction = Defaults.m_StaticFriction;
+    Params.DynamicFriction = Defaults.m_DynamicFriction;
+    Params.VelocityScale = Defaults.m_VelocityScale;
+    Params.RandomCounter = 0;
+
+    // The default gravity, and some whose weight factor doesn't round like the mass does
+    bool Succeeded = true;
+    for (float Gravity : {Defaults.m_Gravity, 9.81f, 13.7f, 3.3f}) {
+        Params.Gravity = Gravity;
+        float ThresholdRadius = FMath::Sqrt(Params.StaticFriction / (kDensity * Gravity));
+        DropStorage Drops;
+        for (int i = 0; i < NumDrops; ++i) {
+            float Radius = ThresholdRadius * (1.0f + (i - NumDrops / 2) * 3e-8f);
+            Drops.Add(Drop(FVector2D(0.0f, 0.0f), FVector2D(0.0f, 0.0f), FVector2D(0.0f, 0.0f), Radius, 0.0f));
+        }
+
+        for (bool UseSimdIntegration : {false, true}) {
+            DropStorage Integrated = Drops;
+            if (UseSimdIntegration)
+                IntegrateDropsSimd(Integrated, 0, NumDrops, Params);
+            else
+                IntegrateDropsScalar(Integrated, 0, NumDrops, Params);
+
+            int NumDifferent = 0;
+            for (int i = 0; i < NumDrops; ++i) {
+                bool IsAwake = GetDropDownwardForce(Drops.Radius[i], Gravity, Params.StaticFriction) > 0;
+                NumDifferent += (Integrated.VelocityY[i] > 0) != IsAwake ? 1 : 0;
+            }
+            if (NumDifferent) {
+                UE_LOG(LogDropBenchmark, Error,
+                    TEXT("%d drops at the sleep threshold of gravity %g moved unlike the sleep test, %s."),
+                    NumDifferent, Gravity, UseSimdIntegration ? TEXT("SIMD") : TEXT("scalar"));
+                Succeeded = false;
+            }
+        }
+    }
+
+    if (Succeeded) {
+        UE_LOG(LogDropBenchmark, Display, TEXT("Sleep threshold %d drops: both integrations move what the sleep test wakes"),
+            NumDrops);
+    }
+    return Succeeded;
+}
+
+/*
+* Ticks the same field with and without sleeping drops, a finger dragged through it, and
+* checks both end with exactly the same drops. Sleeping moves rows around, so this runs
+* with the scalar and the SIMD integration, which both have to give a drop the same
+* result in any row.
+*/
+bool UDropBenchmarkCommandlet::CheckSleepingDrops(int NumDrops)
+{
+    bool Succeeded = true;
+    for (bool UseSimdIntegration : {false, true})
+        Succeeded &= CheckSleepingDrops(NumDrops, UseSimdIntegration);
+    return Succeeded;
+}
+
+bool UDropBenchmarkCommandlet::CheckSleepingDrops(int NumDrops, bool UseSimdIntegration)
+{
+    DropSystem Awake, Sleeping;
+    Awake.m_UseSleeping = false;
+    EmitSleepingCheckDrops(Awake, NumDrops);
+    EmitSleepingCheckDrops(Sleeping, NumDrops);
+    Awake.m_UseSimdIntegration = UseSimdIntegration;
+    Sleeping.m_UseSimdIntegration = UseSimdIntegration;
+
+    int NumSimulatedAwake = 0, NumSimulatedSleeping = 0;
+    FVector2D FingerPos(0.0f, 0.0f);
+    FVector2D Direction(1.0f, 0.25f);
+    for (int Frame = 0; Frame < kBenchmarkSleepingFrames; ++Frame) {
+        FingerPos += Direction * kBenchmarkStrokeSpeed;
+        if (FingerPos.X < 0.0f || FingerPos.X > kBenchmarkFieldSize.X)
+            Direction.X = -Direction.X;
+        if (FingerPos.Y < 0.0f || FingerPos.Y > kBenchmarkFieldSize.Y)
+            Direction.Y = -Direction.Y;
+
+        for (DropSystem* Drops : {&Awake, &Sleeping}) {
+            int ID = Drops->Emit(
+                FingerPos, FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+                kDropEmitRadiusMaxDefault, kBirthTimeNotInitialized
+            );
+            Drops->m_Drops.ResetTrailDistance(Drops->m_Drops.IndexOf(ID), Frame);
+            Drops->Kill(FingerPos, kBenchmarkFingerRadius);
+            Drops->MarkDropsOutsideFinger(FingerPos, kBenchmarkFingerRadius * 2.0f);
+            Drops->Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+        }
+        NumSimulatedAwake += Awake.GetTickStats().NumSimulated;
+        NumSimulatedSleeping += Sleeping.GetTickStats().NumSimulated;
+    }
+
+    int NumDifferent = FMath::Abs(Awake.m_Drops.Num() - Sleeping.m_Drops.Num());
+    for (int i = 0; i < Awake.m_Drops.Num(); ++i) {
+        int Other = Sleeping.m_Drops.IndexOf(Awake.m_Drops.IDs[i]);
+        if (Other == INDEX_NONE || !AreDropsEqual(Awake.m_Drops, i, Sleeping.m_Drops, Other))
+            NumDifferent++;
+    }
+
+    const TCHAR* Integration = UseSimdIntegration ? TEXT("SIMD") : TEXT("scalar");
+    UE_LOG(LogDropBenchmark, Display, TEXT("Sleeping %d drops, %s: %d simulated per frame, %d without sleeping"),
+        NumDrops, Integration, NumSimulatedSleeping / kBenchmarkSleepingFrames, NumSimulatedAwake / kBenchmarkSleepingFrames);
+    if (NumDifferent) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("%d drops differ with sleeping drops, %s."), NumDifferent, Integration);
+        return false;
+    }
+    return true;
+}
+
+/*
+* Advances a field with fixed steps through frames of random length, and checks it ends
+* exactly like ticking the same number of steps directly, and that a hitch runs no more
+* than the sub-step cap.
+*/
+bool UDropBenchmarkCommandlet::CheckFixedStep(int NumDrops)
+{
+    DropSystem Advanced, Ticked;
+    EmitSleepingCheckDrops(Advanced, NumDrops);
+    EmitSleepingCheckDrops(Ticked, NumDrops);
+    Advanced.m_FixedStepSeconds = kBenchmarkFixedStepSeconds;
+
+    DropRandomSequence Random(NumDrops);
+    int NumSteps = 0;
+    for (int Frame = 0; Frame < kBenchmarkFixedStepFrames; ++Frame)
+        NumSteps += Advanced.Advance(Random.GetRange(0.005f, 0.05f), kBenchmarkFieldSize);
+    for (int Step = 0; Step < NumSteps; ++Step)
+        Ticked.Tick(kBenchmarkFixedStepSeconds, kBenchmarkFieldSize);
+
+    int NumDifferent = FMath::Abs(Advanced.m_Drops.Num() - Ticked.m_Drops.Num());
+    for (int i = 0; i < Advanced.m_Drops.Num(); ++i) {
+        int Other = Ticked.m_Drops.IndexOf(Advanced.m_Drops.IDs[i]);
+        if (Other == INDEX_NONE || !AreDropsEqual(Advanced.m_Drops, i, Ticked.m_Drops, Other))
+            NumDifferent++;
+    }
+    int NumHitchSteps = Advanced.Advance(kBenchmarkHitchSeconds, kBenchmarkFieldSize);
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Fixed step %d drops: %d steps in %d frames, %d steps after a %.1f s hitch"),
+        NumDrops, NumSteps, kBenchmarkFixedStepFrames, NumHitchSteps, kBenchmarkHitchSeconds);
+    if (NumDifferent) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("%d drops differ between fixed steps and ticks."), NumDifferent);
+        return false;
+    }
+    if (NumHitchSteps > Advanced.m_MaxSubSteps) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("A hitch ran %d steps, the cap is %d."), NumHitchSteps, Advanced.m_MaxSubSteps);
+        return false;
+    }
+    return true;
+}
+
+/*
+* Ticks once with a chain of touching drops sliding down, and checks the whole chain
+* merged into a single drop.
+*/
+bool UDropBenchmarkCommandlet::CheckMergeCluster(int NumDrops)
+{
+    const float Radius = 4.0f;
+    DropSystem Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Emit(
+            FVector2D(100.0f + i * Radius, 100.0f), FVector2D(0.0f, 10.0f), FVector2D(0.0, 0.0),
+            Radius + i * 0.1f, 0.0f
+        );
+    }
+    Drops.Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Merge cluster of %d drops: %d left after one tick"),
+        NumDrops, Drops.m_Drops.Num());
+    if (Drops.m_Drops.Num() != 1) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("A cluster of %d drops did not merge in one tick."), NumDrops);
+        return false;
+    }
+    return true;
+}
+
+/*
+* Kills along random finger moves once with a circle per brush step, like OnMouseMove
+* did, and once with a single capsule stepped the same way. Both have to kill exactly
+* the same drops.
+*/
+bool UDropBenchmarkCommandlet::CheckCapsuleKill(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropSystem Field;
+    for (int i = 0; i < NumDrops; ++i) {
+        Field.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0, 0.0), FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxDefault), 0.0f
+        );
+    }
+
+    // Build the grid once so every copy below starts from it
+    Field.Kill(-kBenchmarkFieldSize, 0.0f);
+
+    int NumSteppedKills = 0, NumCapsuleKills = 0;
+    double SteppedSeconds = 0.0, CapsuleSeconds = 0.0;
+    for (int Stroke = 0; Stroke < kBenchmarkCapsuleStrokes; ++Stroke) {
+        FVector2D Start = FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize;
+        FVector2D Diff = FVector2D(Random.GetRange(-1.0f, 1.0f), Random.GetRange(-1.0f, 1.0f))
+            * kBenchmarkCapsuleMaxLength;
+        int NSteps = FMath::Max(1, FMath::RoundToInt(Diff.Size() / kBenchmarkStrokeStep));
+        // The first stamp is a step into the move and the last a step past it
+        FVector2D First = Start + Diff / NSteps;
+        FVector2D Last = Start + Diff / NSteps * (NSteps + 1);
+
+        DropSystem Stepped = Field;
+        double StartSeconds = FPlatformTime::Seconds();
+        for (int i = 0; i <= NSteps; ++i)
+            Stepped.Kill(FMath::Lerp(First, Last, (float)i / NSteps), kBenchmarkFingerRadius);
+        SteppedSeconds += FPlatformTime::Seconds() - StartSeconds;
+
+        DropSystem Capsule = Field;
+        StartSeconds = FPlatformTime::Seconds();
+        Capsule.Kill(First, Last, kBenchmarkFingerRadius, kBenchmarkFingerRadius, NSteps);
+        CapsuleSeconds += FPlatformTime::Seconds() - StartSeconds;
+
+        for (int i = 0; i < Field.m_Drops.Num(); ++i) {
+            int ID = Field.m_Drops.IDs[i];
+            if (Capsule.m_Drops.Contains(ID) != Stepped.m_Drops.Contains(ID)) {
+                UE_LOG(LogDropBenchmark, Error, TEXT("Capsule kill %s drop %d in stroke %d unlike the steps."),
+                    Capsule.m_Drops.Contains(ID) ? TEXT("missed") : TEXT("killed"), ID, Stroke);
+                return false;
+            }
+        }
+        NumSteppedKills += Field.m_Drops.Num() - Stepped.m_Drops.Num();
+        NumCapsuleKills += Field.m_Drops.Num() - Capsule.m_Drops.Num();
+    }
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Capsule kill %d strokes through %d drops: stepped %.3f ms %d killed, capsule %.3f ms %d killed"),
+        kBenchmarkCapsuleStrokes, NumDrops, SteppedSeconds * 1000.0, NumSteppedKills,
+        CapsuleSeconds * 1000.0, NumCapsuleKills);
+    return true;
+}
+
+// Area of the quads inside the rectangle.
+static double GetCoveredArea(const TArray<DropQuad>& Quads, const FVector2D& Min, const FVector2D& Max)
+{
+    double Area = 0.0;
+    for (const DropQuad& Quad : Quads) {
+        FVector2D QuadMax = Quad.Position + Quad.Size;
+        double Width = FMath::Min(QuadMax.X, Max.X) - FMath::Max(Quad.Position.X, Min.X);
+        double Height = FMath::Min(QuadMax.Y, Max.Y) - FMath::Max(Quad.Position.Y, Min.Y);
+        if (Width > 0.0 && Height > 0.0)
+            Area += Width * Height;
+    }
+    return Area;
+}
+
+/*
+* Settled drops redraw nothing after the first frame, a few kills only the tiles around
+* them, and what the dirty draw puts in those tiles covers what the full draw would.
+*/
+bool UDropBenchmarkCommandlet::CheckDirtyTiles(int NumDrops)
+{
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0, 0.0), FVector2D(Random.GetRange(0.8f, 1.2f), Random.GetRange(0.8f, 1.2f)),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f
+        );
+    }
+
+    TArray<DropQuad> Clears, Quads, FullQuads;
+    Drops.GatherDirtyQuads(kBenchmarkSettledSeconds, 1.0f, kBenchmarkFieldSize, Clears, Quads);
+    int NumTiles = Clears.Num();
+    int NumFirstQuads = Quads.Num();
+
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int Frame = 0; Frame < kBenchmarkDrawFrames; ++Frame) {
+        Drops.GatherDirtyQuads(kBenchmarkSettledSeconds, 1.0f, kBenchmarkFieldSize, Clears, Quads);
+        if (Clears.Num() || Quads.Num()) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Settled drops dirtied %d tiles with %d quads in frame %d."),
+                Clears.Num(), Quads.Num(), Frame);
+            return false;
+        }
+    }
+    double QuietMilliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / kBenchmarkDrawFrames;
+
+    StartSeconds = FPlatformTime::Seconds();
+    for (int Frame = 0; Frame < kBenchmarkDrawFrames; ++Frame)
+        Drops.GatherDropQuads(kBenchmarkSettledSeconds, 1.0f, FullQuads);
+    double FullMilliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / kBenchmarkDrawFrames;
+
+    for (int i = 0; i < kBenchmarkDirtyKills; ++i)
+        Drops.Kill(FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize, kBenchmarkFingerRadius);
+    Drops.GatherDirtyQuads(kBenchmarkSettledSeconds, 1.0f, kBenchmarkFieldSize, Clears, Quads);
+    Drops.GatherDropQuads(kBenchmarkSettledSeconds, 1.0f, FullQuads);
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Dirty tiles %d drops: first frame %d tiles %d quads, quiet frame %.3f ms against %.3f ms full, ")
+        TEXT("%d kills %d tiles %d quads"),
+        NumDrops, NumTiles, NumFirstQuads, QuietMilliseconds, FullMilliseconds,
+        kBenchmarkDirtyKills, Clears.Num(), Quads.Num());
+    if (NumFirstQuads < FullQuads.Num() || Clears.Num() == 0 || Clears.Num() > NumTiles / 10) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Kills dirtied %d of %d tiles."), Clears.Num(), NumTiles);
+        return false;
+    }
+
+    for (const DropQuad& Clear : Clears) {
+        FVector2D Max = Clear.Position + Clear.Size;
+        double DirtyArea = GetCoveredArea(Quads, Clear.Position, Max);
+        double FullArea = GetCoveredArea(FullQuads, Clear.Position, Max);
+        if (FMath::Abs(DirtyArea - FullArea) > 0.01 * Clear.Size.X * Clear.Size.Y) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Dirty tile at (%.0f, %.0f) covers %.1f px, the full draw %.1f px."),
+                Clear.Position.X, Clear.Position.Y, DirtyArea, FullArea);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Largest difference of any channel of any pixel.
+static float GetMaxDifference(const DropImage& A, const DropImage& B)
+{
+    float MaxDifference = 0.0f;
+    for (int i = 0; i < A.Pixels.Num(); ++i) {
+        const FLinearColor& PixelA = A.Pixels[i];
+        const FLinearColor& PixelB = B.Pixels[i];
+        MaxDifference = FMath::Max(MaxDifference, FMath::Max(
+            FMath::Max(FMath::Abs(PixelA.R - PixelB.R), FMath::Abs(PixelA.G - PixelB.G)),
+            FMath::Max(FMath::Abs(PixelA.B - PixelB.B), FMath::Abs(PixelA.A - PixelB.A))
+        ));
+    }
+    return MaxDifference;
+}
+
+/*
+* An opaque quad on whole pixels covers exactly them, and an image kept up to date with
+* the dirty tiles matches the image drawn from scratch, after emits and after kills.
+*/
+bool UDropBenchmarkCommandlet::CheckSoftwareDraw(int NumDrops)
+{
+    DropImage Sprite, Target;
+    Sprite.Init(4, 4, FLinearColor::White);
+    Target.Init(32, 32, FLinearColor::Transparent);
+    TArray<DropQuad> Quads;
+    DropQuad& Quad = Quads.AddDefaulted_GetRef();
+    Quad.Position = FVector2D(10.0f, 10.0f);
+    Quad.Size = FVector2D(10.0f, 10.0f);
+    TArray<DropSplatColumn> Columns;
+    SplatDropQuads(Quads, Sprite, Target, Columns);
+
+    float Coverage = 0.0f;
+    for (const FLinearColor& Pixel : Target.Pixels)
+        Coverage += Pixel.A;
+    if (Coverage != 100.0f || Target.Pixels[10 * 32 + 10].A != 1.0f || Target.Pixels[20 * 32 + 20].A != 0.0f) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("An opaque 10x10 quad covered %.2f pixels."), Coverage);
+        return false;
+    }
+
+    const int Size = 1024;
+    MakeRoundDropSprite(kBenchmarkSpriteSize, Sprite);
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    DropImage Incremental, Full, MovedDrops;
+    Incremental.Init(Size, Size, FLinearColor::Transparent);
+    Full.Init(Size, Size, FLinearColor::Transparent);
+    MovedDrops.Init(Size, Size, FLinearColor::Transparent);
+
+    TArray<DropQuad> Clears;
+    for (int Frame = 0; Frame < 3; ++Frame) {
+        if (Frame < 2) {
+            for (int i = 0; i < NumDrops / 2; ++i) {
+                Drops.Emit(
+                    FVector2D(Random.GetUnit(), Random.GetUnit()) * Size,
+                    FVector2D(0.0, 0.0), FVector2D(Random.GetRange(0.8f, 1.2f), Random.GetRange(0.8f, 1.2f)),
+                    Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f
+                );
+            }
+        }
+        else {
+            for (int i = 0; i < kBenchmarkDirtyKills; ++i)
+                Drops.Kill(FVector2D(Random.GetUnit(), Random.GetUnit()) * Size, kBenchmarkFingerRadius * 4.0f);
+        }
+
+        Drops.GatherDirtyQuads(Drops.GetTimeSeconds(), 1.0f, FVector2D(Size, Size), Clears, Quads);
+        for (const DropQuad& Clear : Clears)
+            Incremental.ClearRect(Clear.Position, Clear.Position + Clear.Size, FLinearColor::Transparent);
+        SplatDropQuads(Quads, Sprite, Incremental, Columns);
+
+        Drops.DrawSoftware(Full, MovedDrops, Sprite, 1.0f);
+        float MaxDifference = GetMaxDifference(Incremental, Full);
+        if (MaxDifference > kBenchmarkSplatTolerance) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Dirty tiles drew frame %d off by %g from the full draw."),
+                Frame, MaxDifference);
+            return false;
+        }
+    }
+
+    // The same drops again, through scratch the first draw grew
+    int64 NumDrawAllocations;
+    {
+        FScopedDropBenchmarkMalloc CountedMalloc;
+        Drops.DrawSoftware(Full, MovedDrops, Sprite, 1.0f);
+        NumDrawAllocations = CountedMalloc.Counter.NumAllocations.GetValue();
+    }
+    if (NumDrawAllocations) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("A steady software draw allocated %lld times."), NumDrawAllocations);
+        return false;
+    }
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Software draw %d drops: dirty tiles match the full draw, %d tiles redrawn after %d kills"),
+        Drops.m_Drops.Num(), Clears.Num(), kBenchmarkDirtyKills);
+    return true;
+}
+
+/*
+* Splats a field of drops on the CPU like a headless frame export would, and writes the
+* last frame as a bitmap to `ImagePath` if there is one.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkSoftwareDraw(int NumDrops, const FString& ImagePath)
+{
+    const int Size = (int)kBenchmarkFieldSize.X;
+    DropRandomSequence Random(NumDrops);
+    DropSystem Drops;
+    for (int i = 0; i < NumDrops; ++i) {
+        Drops.Emit(
+            FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+            FVector2D(0.0, 0.0), FVector2D(Random.GetRange(0.8f, 1.2f), Random.GetRange(0.8f, 1.2f)),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f
+        );
+    }
+
+    DropImage Sprite, Image, MovedDrops;
+    MakeRoundDropSprite(kBenchmarkSpriteSize, Sprite);
+    Image.Init(Size, Size, FLinearColor::Transparent);
+    MovedDrops.Init(Size, Size, FLinearColor::Transparent);
+
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int Frame = 0; Frame < kBenchmarkSoftwareFrames; ++Frame)
+        Drops.DrawSoftware(Image, MovedDrops, Sprite, 1.0f);
+    double Milliseconds = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / kBenchmarkSoftwareFrames;
+
+    TArray<DropQuad> Quads;
+    double NumPixels = 0.0;
+    Drops.GatherDropQuads(Drops.GetTimeSeconds(), 1.0f, Quads);
+    for (const DropQuad& Quad : Quads)
+        NumPixels += Quad.Size.X * Quad.Size.Y;
+    Drops.GatherTrailQuads(Drops.GetTimeSeconds(), 1.0f, Quads);
+    for (const DropQuad& Quad : Quads)
+        NumPixels += Quad.Size.X * Quad.Size.Y;
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Software draw %d drops into %dx%d: %.3f ms per frame, %d quads, %.1f Mpixels splatted per second"),
+        NumDrops, Size, Size, Milliseconds, Drops.GetDrawStats().NumQuads, NumPixels / (Milliseconds * 1000.0));
+
+    if (!ImagePath.IsEmpty()) {
+        TArray<FColor> Colors;
+        Image.ToColors(Colors);
+        if (!FFileHelper::CreateBitmap(*ImagePath, Size, Size, Colors.GetData(), nullptr, &IFileManager::Get(), nullptr, true)) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Could not write %s."), *ImagePath);
+            return false;
+        }
+    }
+    return true;
+}
+
+template<class ElementType>
+static uint32 HashColumn(const TArray<ElementType>& Column, uint32 Hash)
+{
+    return FCrc::MemCrc32(Column.GetData(), Column.Num() * sizeof(ElementType), Hash);
+}
+
+// Of every row and the time, equal when two systems hold the same drops bit for bit.
+static uint32 HashDrops(const DropSystem& Drops)
+{
+    const DropStorage& Storage = Drops.m_Drops;
+    float TimeSeconds = Drops.GetTimeSeconds();
+    uint32 Hash = FCrc::MemCrc32(&TimeSeconds, sizeof(TimeSeconds));
+    Hash = HashColumn(Storage.IDs, Hash);
+    Hash = HashColumn(Storage.PositionX, Hash);
+    Hash = HashColumn(Storage.PositionY, Hash);
+    Hash = HashColumn(Storage.VelocityX, Hash);
+    Hash = HashColumn(Storage.VelocityY, Hash);
+    Hash = HashColumn(Storage.Radius, Hash);
+    Hash = HashColumn(Storage.BirthTimeSeconds, Hash);
+    Hash = HashColumn(Storage.DistanceNoTrail, Hash);
+    Hash = HashColumn(Storage.NextTrailDistance, Hash);
+    return HashColumn(Storage.Flags, Hash);
+}
+
+/*
+* Plays a stroke through sliding drops the way AGM_Winter does, edits first and then a
+* frame, and gathers what Draw would draw. Returns the game thread time of the frame and
+* the hash of the drops drawn.
+*/
+static double PlayPipelineFrame(
+    DropPipeline& Pipeline, DropRandomSequence& Random, TArray<DropQuad>& Quads, uint32& OutDrawnHash
+)
+{
+    double StartSeconds = FPlatformTime::Seconds();
+    FVector2D FingerPos = FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize;
+    FVector2D FingerEnd = FingerPos + FVector2D(kBenchmarkStrokeSpeed, 0.0f);
+    for (int i = 0; i < kBenchmarkSessionEmitsPerFrame; ++i) {
+        FVector2D Offset(Random.GetRange(-20.0f, 20.0f), Random.GetRange(-20.0f, 20.0f));
+        Pipeline.Emit(
+            FingerPos + Offset, FVector2D(0.0f, 0.0f), FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxDefault), kBirthTimeNotInitialized
+        );
+    }
+    // A big drop born now, like a right click
+    Pipeline.Emit(
+        FingerEnd, FVector2D(0.0f, 0.0f), FVector2D(0.0, 0.0), kDropEmitRadiusMaxStrokeEnd, Pipeline.GetTimeSeconds()
+    );
+    const FVector2D FingerPath[] = { FingerPos - FVector2D(kBenchmarkStrokeSpeed, 0.0f), FingerPos };
+    Pipeline.MarkDropsOutsideFinger(TArrayView<const FVector2D>(FingerPath, 2), kBenchmarkFingerRadius * 2.0f);
+    Pipeline.Kill(FingerPos, FingerEnd, kBenchmarkFingerRadius, kBenchmarkFingerRadius);
+
+    Pipeline.Advance(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+    const DropSystem& Drawn = Pipeline.GetDrawnDrops();
+    Drawn.GatherDropQuads(Drawn.GetTimeSeconds(), 1.0f, Quads);
+    double Seconds = FPlatformTime::Seconds() - StartSeconds;
+    OutDrawnHash = HashDrops(Drawn);
+    return Seconds;
+}
+
+/*
+* Plays the same frames serially and pipelined. The pipelined run has to draw frame N
+* exactly as the serial run drew frame N - 1, and should leave the game thread with the
+* snapshot copy instead of the tick. Queueing the edits of a frame must not allocate.
+*/
+bool UDropBenchmarkCommandlet::CheckPipeline(int NumDrops)
+{
+    const uint32 Seed = 4321;
+    TArray<uint32> SerialHashes;
+    TArray<DropQuad> Quads;
+    double SerialSeconds = 0.0, PipelinedSeconds = 0.0, WaitSeconds = 0.0;
+    {
+        DropPipeline Serial;
+        DropRandomSequence Random(Seed);
+        EmitScenarioDrops(Serial.m_Simulation, TEXT("sliding"), NumDrops, Random);
+        SerialHashes.Add(HashDrops(Serial.m_Simulation));
+        for (int Frame = 0; Frame < kBenchmarkPipelineFrames; ++Frame) {
+            uint32 Hash;
+            SerialSeconds += PlayPipelineFrame(Serial, Random, Quads, Hash);
+            SerialHashes.Add(Hash);
+        }
+    }
+
+    DropPipeline Pipelined;
+    DropRandomSequence Random(Seed);
+    EmitScenarioDrops(Pipelined.m_Simulation, TEXT("sliding"), NumDrops, Random);
+    Pipelined.SetPipelined(true);
+    for (int Frame = 0; Frame < kBenchmarkPipelineFrames; ++Frame) {
+        uint32 Hash;
+        PipelinedSeconds += PlayPipelineFrame(Pipelined, Random, Quads, Hash);
+        WaitSeconds += Pipelined.GetLastWaitSeconds();
+        if (Hash != SerialHashes[Frame]) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Pipelined frame %d drew other drops than serial frame %d."),
+                Frame, Frame - 1);
+            return false;
+        }
+    }
+    Pipelined.Sync();
+
+    // Queueing the edits of a stroke frame reuses what the same edits a frame before allocated
+    FVector2D FingerPos = kBenchmarkFieldSize * 0.5f;
+    const FVector2D FingerPath[] = { FingerPos - FVector2D(kBenchmarkStrokeSpeed, 0.0f), FingerPos };
+    auto QueueStrokeFrame = [&]() {
+        Pipelined.MarkDropsOutsideFinger(TArrayView<const FVector2D>(FingerPath, 2), kBenchmarkFingerRadius * 2.0f);
+        Pipelined.MarkDropsOutsideFinger(FingerPos, kBenchmarkFingerRadius * 2.0f);
+        Pipelined.Kill(FingerPath[0], FingerPath[1], kBenchmarkFingerRadius, kBenchmarkFingerRadius);
+    };
+    QueueStrokeFrame();
+    Pipelined.Advance(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+    Pipelined.Sync();
+    int64 NumQueueAllocations;
+    {
+        FScopedDropBenchmarkMalloc CountedMalloc;
+        QueueStrokeFrame();
+        NumQueueAllocations = CountedMalloc.Counter.NumAllocations.GetValue();
+    }
+    if (NumQueueAllocations) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Queueing a stroke frame allocated %lld times."), NumQueueAllocations);
+        return false;
+    }
+
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Pipeline %d frames from %d drops: game thread %.3f ms serial, %.3f ms pipelined of which %.3f ms waiting, ")
+        TEXT("%d drops at the end"),
+        kBenchmarkPipelineFrames, NumDrops, SerialSeconds * 1000.0 / kBenchmarkPipelineFrames,
+        PipelinedSeconds * 1000.0 / kBenchmarkPipelineFrames, WaitSeconds * 1000.0 / kBenchmarkPipelineFrames,
+        Pipelined.m_Simulation.m_Drops.Num());
+    return true;
+}
+
+// A frame of a glass in use: drops emitted, a finger wiping some away, a fixed step frame.
+static void PlaySnapshotFrame(DropSystem& Drops, DropRandomSequence& Random)
+{
+    for (int i = 0; i < kBenchmarkSnapshotEmitsPerFrame; ++i) {
+        FVector2D Position = FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize;
+        Drops.Emit(Position, FVector2D(0.0f, Random.GetRange(0.0f, 20.0f)), FVector2D(0.0, 0.0),
+            Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd), 0.0f);
+    }
+    Drops.Kill(FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize, kBenchmarkSnapshotKillRadius);
+    Drops.Advance(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+}
+
+/*
+* Snapshots a glass in use, with killed slots, sleeping drops and fixed step time left
+* over, loads it into a fresh system, and checks both go on to tick the same drops. Then
+* checks that cut off and newer snapshots, and ones whose columns or handles are broken,
+* don't load and leave the drops alone.
+*/
+bool UDropBenchmarkCommandlet::CheckSnapshot(int NumDrops)
+{
+    DropSystem Original;
+    Original.m_FixedStepSeconds = kBenchmarkFixedStepSeconds;
+    Original.m_Gravity *= 1.5f;
+    DropRandomSequence Random(NumDrops);
+    EmitScenarioDrops(Original, TEXT("static"), NumDrops, Random);
+    for (int Frame = 0; Frame < kBenchmarkSnapshotFrames; ++Frame)
+        PlaySnapshotFrame(Original, Random);
+
+    FString Path = FPaths::CreateTempFilename(*FPaths::ProjectSavedDir(), TEXT("DropSnapshot"), TEXT(".bin"));
+    double StartSeconds = FPlatformTime::Seconds();
+    bool Saved = DropSnapshot::Save(Original, Path);
+    double SaveSeconds = FPlatformTime::Seconds() - StartSeconds;
+    int64 SnapshotBytes = IFileManager::Get().FileSize(*Path);
+
+    DropSystem Loaded;
+    StartSeconds = FPlatformTime::Seconds();
+    bool Succeeded = Saved && DropSnapshot::Load(Path, Loaded);
+    double LoadSeconds = FPlatformTime::Seconds() - StartSeconds;
+    if (!Succeeded)
+        UE_LOG(LogDropBenchmark, Error, TEXT("Could not save and load the snapshot %s."), *Path);
+
+    Succeeded &= HashDrops(Loaded) == HashDrops(Original);
+    DropRandomSequence OriginalRandom(NumDrops + 1), LoadedRandom(NumDrops + 1);
+    for (int Frame = 0; Succeeded && Frame < kBenchmarkSnapshotFrames; ++Frame) {
+        PlaySnapshotFrame(Original, OriginalRandom);
+        PlaySnapshotFrame(Loaded, LoadedRandom);
+        Succeeded = HashDrops(Loaded) == HashDrops(Original);
+        if (!Succeeded)
+            UE_LOG(LogDropBenchmark, Error, TEXT("Loaded snapshot ticked frame %d unlike the saved drops."), Frame);
+    }
+    DropPoolStats OriginalStats = Original.GetPoolStats(), LoadedStats = Loaded.GetPoolStats();
+    if (Succeeded && (LoadedStats.NumPeak != OriginalStats.NumPeak || LoadedStats.NumRecycled != OriginalStats.NumRecycled
+        || LoadedStats.NumGrowths != OriginalStats.NumGrowths)) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Loaded snapshot pooled its drops unlike the saved drops."));
+        Succeeded = false;
+    }
+
+    TArray<uint8> Data;
+    if (Succeeded && FFileHelper::LoadFileToArray(Data, *Path)) {
+        uint32 Hash = HashDrops(Loaded);
+        TArray<uint8> Cut(Data.GetData(), Data.Num() - 1);
+        if (DropSnapshot::Read(Cut.GetData(), Cut.Num(), Loaded) || HashDrops(Loaded) != Hash) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Snapshot loaded with its last byte cut off."));
+            Succeeded = false;
+        }
+
+        reinterpret_cast<DropSnapshotHeader*>(Data.GetData())->Version = kDropSnapshotVersion + 1;
+        if (DropSnapshot::Read(Data.GetData(), Data.Num(), Loaded) || HashDrops(Loaded) != Hash) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Snapshot of version %u loaded."), kDropSnapshotVersion + 1);
+            Succeeded = false;
+        }
+        reinterpret_cast<DropSnapshotHeader*>(Data.GetData())->Version = kDropSnapshotVersion;
+
+        // Handles that don't resolve: a row under another slot, a slot past the rows, a slot freed twice
+        const DropSnapshotHeader& Header = *reinterpret_cast<const DropSnapshotHeader*>(Data.GetData());
+        auto CheckBrokenSlots = [&](const TCHAR* What, EDropSnapshotColumn Column, int Index, auto GetValue) {
+            TArray<uint8> Broken = Data;
+            int* Values = reinterpret_cast<int*>(Broken.GetData() + Header.Columns[(int)Column].Offset);
+            Values[Index] = GetValue(Values);
+            if (DropSnapshot::Read(Broken.GetData(), Broken.Num(), Loaded) || HashDrops(Loaded) != Hash) {
+                UE_LOG(LogDropBenchmark, Error, TEXT("Snapshot with %s loaded."), What);
+                Succeeded = false;
+            }
+        };
+        int FreeSlot = *reinterpret_cast<const int*>(Data.GetData() + Header.Columns[(int)EDropSnapshotColumn::FreeSlots].Offset);
+        CheckBrokenSlots(TEXT("a drop in the slot of another"), EDropSnapshotColumn::IDs, 0,
+            [](const int* IDs) { return IDs[0] ^ 1; });
+        CheckBrokenSlots(TEXT("a free slot past the drops"), EDropSnapshotColumn::SlotIndices, FreeSlot,
+            [&](const int*) { return Header.NumDrops; });
+        CheckBrokenSlots(TEXT("a slot freed twice"), EDropSnapshotColumn::FreeSlots, 1,
+            [](const int* FreeSlots) { return FreeSlots[0]; });
+
+        // A column offset so big that its end wraps around to inside the file
+        TArray<uint8> Wrapped = Data;
+        DropSnapshotHeader* WrappedHeader = reinterpret_cast<DropSnapshotHeader*>(Wrapped.GetData());
+        WrappedHeader->Columns[(int)EDropSnapshotColumn::PositionX].Offset = ~(uint64)(kDropSnapshotAlignment - 1);
+        if (DropSnapshot::Read(Wrapped.GetData(), Wrapped.Num(), Loaded) || HashDrops(Loaded) != Hash) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Snapshot with a column past the end of the file loaded."));
+            Succeeded = false;
+        }
+
+        // Room for more drops than there can be slots, which would reserve gigabytes
+        TArray<uint8> Oversized = Data;
+        reinterpret_cast<DropSnapshotHeader*>(Oversized.GetData())->Capacity = MAX_int32;
+        if (DropSnapshot::Read(Oversized.GetData(), Oversized.Num(), Loaded) || HashDrops(Loaded) != Hash) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Snapshot with a capacity of %d drops loaded."), MAX_int32);
+            Succeeded = false;
+        }
+    }
+    IFileManager::Get().Delete(*Path);
+
+    if (Succeeded) {
+        UE_LOG(LogDropBenchmark, Display,
+            TEXT("Snapshot %d drops: %lld bytes, saved in %.3f ms, loaded in %.3f ms, %d frames ticked the same after"),
+            Original.m_Drops.Num(), (long long)SnapshotBytes, SaveSeconds * 1000.0, LoadSeconds * 1000.0,
+            kBenchmarkSnapshotFrames);
+    }
+    return Succeeded;
+}
+
+/*
+* Ticks the emitting budget scenario once per emission rate, returns the tick time of the
+* last quarter of the frames and the drops left at the end.
+*/
+static double TickEmittingDrops(DropSystem& Drops, int DropsPerFrame, int& OutNumDrops)
+{
+    DropRandomSequence Random(DropsPerFrame);
+    double TickSeconds = 0.0;
+    for (int Frame = 0; Frame < kBenchmarkBudgetFrames; ++Frame) {
+        for (int i = 0; i < DropsPerFrame; ++i) {
+            float Radius = Random.GetRange(kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd);
+            Drops.Emit(
+                FVector2D(Random.GetUnit(), Random.GetUnit()) * kBenchmarkFieldSize,
+                FVector2D(0.0f, Radius > kDropEmitRadiusMinStrokeEnd ? Random.GetRange(5.0f, 20.0f) : 0.0f),
+                FVector2D(0.0, 0.0), Radius, 0.0f
+            );
+        }
+
+        double StartSeconds = FPlatformTime::Seconds();
+        Drops.Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+        if (Frame >= kBenchmarkBudgetFrames * 3 / 4)
+            TickSeconds += FPlatformTime::Seconds() - StartSeconds;
+    }
+    OutNumDrops = Drops.m_Drops.Num();
+    return TickSeconds * 1000.0 / (kBenchmarkBudgetFrames - kBenchmarkBudgetFrames * 3 / 4);
+}
+
+/*
+* Degradation curve of the drop budget: emits ever more drops per frame, without a budget,
+* with `m_MaxDrops` and with `m_TargetTickMilliseconds`. Without one the tick time climbs
+* with the emission rate, with one it levels off. Fails if `m_MaxDrops` is exceeded.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkDropBudget()
+{
+    FString Curve = TEXT("drops_per_frame,unbudgeted_ms,unbudgeted_drops,max_drops_ms,max_drops_drops,")
+        TEXT("target_ms_ms,target_ms_drops\n");
+    for (int DropsPerFrame : {100, 300, 1000, 3000, 10000}) {
+        int NumUnbudgeted, NumMaxDrops, NumTargetMs;
+        DropSystem Unbudgeted;
+        double UnbudgetedMs = TickEmittingDrops(Unbudgeted, DropsPerFrame, NumUnbudgeted);
+
+        DropSystem MaxDrops;
+        MaxDrops.m_MaxDrops = kBenchmarkBudgetMaxDrops;
+        double MaxDropsMs = TickEmittingDrops(MaxDrops, DropsPerFrame, NumMaxDrops);
+
+        DropSystem TargetMs;
+        TargetMs.m_TargetTickMilliseconds = kBenchmarkBudgetTickMilliseconds;
+        double TargetMsMs = TickEmittingDrops(TargetMs, DropsPerFrame, NumTargetMs);
+
+        Curve += FString::Printf(TEXT("%d,%.3f,%d,%.3f,%d,%.3f,%d\n"), DropsPerFrame,
+            UnbudgetedMs, NumUnbudgeted, MaxDropsMs, NumMaxDrops, TargetMsMs, NumTargetMs);
+        if (NumMaxDrops > kBenchmarkBudgetMaxDrops) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("%d drops left with a budget of %d."),
+                NumMaxDrops, kBenchmarkBudgetMaxDrops);
+            return false;
+        }
+    }
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Drop budget of %d drops or %.1f ms per tick:\n%s"),
+        kBenchmarkBudgetMaxDrops, kBenchmarkBudgetTickMilliseconds, *Curve);
+    return true;
+}
+
+/*
+* Draws the same amount of numbers with the shared FMath::RandRange the drops used before,
+* one at a time from a DropRandomSequence, and in one DropRandomSequence::FillRange batch.
+* The batch has to give the numbers of the single draws.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkRandom()
+{
+    TArray<float> Numbers, Batch;
+    Numbers.SetNumUninitialized(kBenchmarkRandomNumbers);
+    Batch.SetNumUninitialized(kBenchmarkRandomNumbers);
+
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int i = 0; i < kBenchmarkRandomNumbers; ++i)
+        Numbers[i] = FMath::RandRange(20.0f, 50.0f);
+    double SharedSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+    DropRandomSequence Single(kDropRandomDefaultSeed);
+    StartSeconds = FPlatformTime::Seconds();
+    for (int i = 0; i < kBenchmarkRandomNumbers; ++i)
+        Numbers[i] = Single.GetRange(20.0f, 50.0f);
+    double SingleSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+    DropRandomSequence Batched(kDropRandomDefaultSeed);
+    StartSeconds = FPlatformTime::Seconds();
+    Batched.FillRange(Batch.GetData(), kBenchmarkRandomNumbers, 20.0f, 50.0f);
+    double BatchSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+    double NanosecondsPerNumber = 1e9 / kBenchmarkRandomNumbers;
+    UE_LOG(LogDropBenchmark, Display,
+        TEXT("Random %d numbers: FMath::RandRange %.2f ns, sequence %.2f ns, batch %.2f ns per number"),
+        kBenchmarkRandomNumbers, SharedSeconds * NanosecondsPerNumber, SingleSeconds * NanosecondsPerNumber,
+        BatchSeconds * NanosecondsPerNumber);
+    if (Numbers != Batch) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("A batch of random numbers differs from drawing them one by one."));
+        return false;
+    }
+    return true;
+}
+
+// A finger stroke through a field of sliding drops, every input drawn from `Seed`.
+static void PlayRandomSession(DropSystem& Drops, uint32 Seed, int NumDrops)
+{
+    Drops.m_RandomSeed = Seed;
+    DropRandomSequence Random(Seed);
+    EmitScenarioDrops(Drops, TEXT("sliding"), NumDrops, Random);
+
+    float Radii[kBenchmarkSessionEmitsPerFrame];
+    for (int Frame = 0; Frame < kBenchmarkSessionFrames; ++Frame) {
+        FVector2D FingerPos(Random.GetUnit() * kBenchmarkFieldSize.X, Random.GetUnit() * kBenchmarkFieldSize.Y);
+        Random.FillRange(Radii, kBenchmarkSessionEmitsPerFrame, kDropEmitRadiusMinDefault, kDropEmitRadiusMaxStrokeEnd);
+        for (float Radius : Radii) {
+            FVector2D Offset(Random.GetRange(-20.0f, 20.0f), Random.GetRange(-20.0f, 20.0f));
+            Drops.Emit(FingerPos + Offset, FVector2D(0.0f, 0.0f), FVector2D(0.0, 0.0), Radius, kBirthTimeNotInitialized);
+        }
+        Drops.MarkDropsOutsideFinger(FingerPos, kBenchmarkFingerRadius * 2.0f);
+        Drops.Kill(FingerPos, FingerPos + FVector2D(kBenchmarkStrokeSpeed, 0.0f), kBenchmarkFingerRadius, kBenchmarkFingerRadius);
+        Drops.Tick(kBenchmarkDrawFrameSeconds, kBenchmarkFieldSize);
+    }
+}
+
+/*
+* Plays the same session twice with one seed, once on the game thread only and once on
+* every worker, and once more with another seed. The same seed has to leave the same drops
+* in the same rows, the other seed must not.
+*/
+bool UDropBenchmarkCommandlet::CheckRandomSession(int NumDrops)
+{
+    const uint32 Seed = 1234;
+    DropSystem First, Second, Other;
+    First.m_NumWorkerThreads = 1;
+    Second.m_NumWorkerThreads = 0;
+    Second.m_MinBatchSize = 256;
+    PlayRandomSession(First, Seed, NumDrops);
+    PlayRandomSession(Second, Seed, NumDrops);
+    PlayRandomSession(Other, Seed + 1, NumDrops);
+
+    bool IsSame = First.m_Drops.Num() == Second.m_Drops.Num();
+    for (int i = 0; IsSame && i < First.m_Drops.Num(); ++i)
+        IsSame = First.m_Drops.IDs[i] == Second.m_Drops.IDs[i] && AreDropsEqual(First.m_Drops, i, Second.m_Drops, i);
+
+    bool IsOtherSame = First.m_Drops.Num() == Other.m_Drops.Num();
+    for (int i = 0; IsOtherSame && i < First.m_Drops.Num(); ++i)
+        IsOtherSame = AreDropsEqual(First.m_Drops, i, Other.m_Drops, i);
+
+    UE_LOG(LogDropBenchmark, Display, TEXT("Random session %d frames: %d drops with seed %u, %d with seed %u"),
+        kBenchmarkSessionFrames, First.m_Drops.Num(), Seed, Other.m_Drops.Num(), Seed + 1);
+    if (!IsSame) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("The same seed played a different session."));
+        return false;
+    }
+    if (IsOtherSame) {
+        UE_LOG(LogDropBenchmark, Error, TEXT("Another seed played the same session."));
+        return false;
+    }
+    return true;
+}
+
+/*
+* Checks the pow curves the drops use against FMath::Pow at evenly spaced points, within
+* GetDropPowCurveMaxError and within kBenchmarkCurveMaxError for all of them, and times
+* both on the same random inputs.
+*/
+bool UDropBenchmarkCommandlet::BenchmarkCurves()
+{
+    struct CurveCase
+    {
+        float Exponent;
+        DropCurve<> Curve;
+    };
+    static constexpr CurveCase Cases[] = {
+        {10.0f, MakeDropPowCurve(10.0)},
+        {2.0f, MakeDropPowCurve(2.0)},
+        {0.7f, MakeDropPowCurve(0.7)},
+        {0.5f, MakeDropPowCurve(0.5)},
+    };
+
+    TArray<float> Inputs;
+    Inputs.SetNumUninitialized(kBenchmarkCurveSamples);
+    DropRandomSequence Random(kBenchmarkCurveSamples);
+    Random.FillRange(Inputs.GetData(), kBenchmarkCurveSamples, 0.0f, 1.0f);
+
+    bool Succeeded = true;
+    for (const CurveCase& Case : Cases) {
+        float MaxError = 0.0f;
+        for (int i = 0; i <= kBenchmarkCurveSamples; ++i) {
+            float X = (float)i / kBenchmarkCurveSamples;
+            MaxError = FMath::Max(MaxError, FMath::Abs(Case.Curve.Evaluate(X) - FMath::Pow(X, Case.Exponent)));
+        }
+
+        float Sum = 0.0f;
+        double StartSeconds = FPlatformTime::Seconds();
+        for (float X : Inputs)
+            Sum += FMath::Pow(X, Case.Exponent);
+        double PowSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+        StartSeconds = FPlatformTime::Seconds();
+        for (float X : Inputs)
+            Sum += Case.Curve.Evaluate(X);
+        double CurveSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+        float Bound = GetDropPowCurveMaxError(Case.Exponent);
+        double NanosecondsPerSample = 1e9 / kBenchmarkCurveSamples;
+        UE_LOG(LogDropBenchmark, Display,
+            TEXT("Curve x^%.1f: error %.2e of %.2e, FMath::Pow %.2f ns, curve %.2f ns per sample (sum %.0f)"),
+            Case.Exponent, MaxError, Bound, PowSeconds * NanosecondsPerSample, CurveSeconds * NanosecondsPerSample, Sum);
+        if (MaxError > Bound || Bound > kBenchmarkCurveMaxError) {
+            UE_LOG(LogDropBenchmark, Error, TEXT("Curve x^%.1f is off by %g, bound %g, more than %g allowed."),
+                Case.Exponent, MaxError, Bound, kBenchmarkCurveMaxError);
+            Succeeded = false;
+        }
+    }
+    return Succeeded;
+}
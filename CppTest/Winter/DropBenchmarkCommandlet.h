@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "DropBenchmarkCommandlet.generated.h"
+
+/**
+ * Benchmarks the drop simulation without a window or render targets.
+ * Run with `UE4Editor-Cmd CppTest.uproject -run=DropBenchmark -nullrhi`.
+ *
+ * After the checks, runs the scenarios given by
+ * `-scenarios=static,sliding,stroke,merge -drops=1000,10000,100000 -frames=60`
+ * and prints one CSV line per scenario and drop count, also written to `-csv=<path>`.
+ * `-framecsv=<path>` writes the drop counters of every scenario frame, one line each.
+ * The `optimized` column is 0 when the drop code was built without optimization, such
+ * timings are no baseline.
+ * `-only=checks` or `-only=scenarios` runs just one of them, e.g. to time the scenarios alone.
+ */
+UCLASS()
+class CPPTEST_API UDropBenchmarkCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    UDropBenchmarkCommandlet();
+
+    int32 Main(const FString& Params) override;
+
+private:
+    bool RunChecks(const FString& Params);
+    bool RunScenarios(const FString& Params);
+    bool CheckStorageAgainstMap(int NumOperations);
+    bool BenchmarkOverlaps(int NumDrops);
+    bool BenchmarkStrokeChurn(int NumDrops);
+    bool CheckGridChurn(int NumDrops);
+    bool BenchmarkIntegration(int NumDrops);
+    bool BenchmarkDrawBatching(int NumDrops);
+    bool CheckDirtyTiles(int NumDrops);
+    bool CheckSoftwareDraw(int NumDrops);
+    bool BenchmarkSoftwareDraw(int NumDrops, const FString& ImagePath);
+    bool CheckTickAllocations(int NumDrops);
+    bool CheckSleepThreshold(int NumDrops);
+    bool CheckSleepingDrops(int NumDrops);
+    bool CheckSleepingDrops(int NumDrops, bool UseSimdIntegration);
+    bool CheckFixedStep(int NumDrops);
+    bool CheckMergeCluster(int NumDrops);
+    bool CheckCapsuleKill(int NumDrops);
+    bool BenchmarkDropBudget();
+    bool BenchmarkRandom();
+    bool CheckRandomSession(int NumDrops);
+    bool CheckPipeline(int NumDrops);
+    bool CheckSnapshot(int NumDrops);
+    bool BenchmarkCurves();
+    bool RunScenario(
+        const FString& ScenarioName, int NumDrops, int NumFrames, FString& OutCsv, FString& OutFrameCsv
+    );
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <CoreMinimal.h>
+
+
+/*
+* Response curves of the drops as lookup tables built at compile time, evaluated with a
+* clamp, a load of two neighbours and a lerp instead of FMath::Pow.
+*
+* A pow curve x^p with p < 1 is steep at 0, evenly spaced samples would be off by
+* 1.6e-2 for x^0.5. So it is sampled at x = u^(2^R), with R the fewest square roots
+* that make q = p * 2^R at least 1, and evaluated at u = R square roots of x. The table
+* then holds u^q, which is flat at 0. Error bound of u^q, q >= 1, with N segments of h = 1 / N:
+*   max(h^q * (t - t^q), q * (q - 1) / 8 * max(h^q, h^2)) with t = q^(1 / (1 - q)),
+* the first segment and the curvature of the others. GetDropPowCurveMaxError gives it,
+* plus the float rounding of the table. For the 256 segments used, x^10 is off by
+* 1.7e-4 at most, x^0.7 by 5.3e-5, x^0.5 only by rounding.
+*/
+
+const int kDropCurveSegments = 256;
+const int kDropCurveMaxRoots = 4;   // Down to x^(1/16)
+
+namespace DropCurvePrivate
+{
+    // Natural logarithm of 0 < X <= 1, from log(M * 2^K) = 2 * atanh((M - 1) / (M + 1)) + K * log(2).
+    constexpr double Log(double X)
+    {
+        int Exponent = 0;
+        while (X < 0.5) {
+            X *= 2.0;
+            Exponent--;
+        }
+        double S = (X - 1.0) / (X + 1.0);
+        double SSquared = S * S;
+        double Term = S;
+        double Sum = 0.0;
+        for (int n = 1; n < 40; n += 2) {
+            Sum += Term / n;
+            Term *= SSquared;
+        }
+        return 2.0 * Sum + Exponent * 0.69314718055994530942;
+    }
+
+    // exp(Y) = exp(Y / 2^K)^(2^K), with a Taylor series for the small argument.
+    constexpr double Exp(double Y)
+    {
+        int NumHalvings = 0;
+        while (Y < -0.5 || Y > 0.5) {
+            Y *= 0.5;
+            NumHalvings++;
+        }
+        double Term = 1.0;
+        double Sum = 1.0;
+        for (int n = 1; n < 18; ++n) {
+            Term *= Y / n;
+            Sum += Term;
+        }
+        for (int i = 0; i < NumHalvings; ++i)
+            Sum *= Sum;
+        return Sum;
+    }
+
+    constexpr double Pow(double X, double Exponent)
+    {
+        return X <= 0.0 ? 0.0 : Exp(Exponent * Log(X));
+    }
+}
+
+// Square roots MakeDropPowCurve takes of the input, so the table holds a power of at least 1.
+constexpr int GetDropPowCurveRoots(double Exponent)
+{
+    int NumRoots = 0;
+    while (Exponent > 0.0 && Exponent < 1.0 && NumRoots < kDropCurveMaxRoots) {
+        Exponent *= 2.0;
+        NumRoots++;
+    }
+    return NumRoots;
+}
+
+/*
+* A curve on [0, 1] sampled at `NumSegments + 1` points evenly spaced after `NumRoots`
+* square roots of the input. Inputs outside of [0, 1] are clamped.
+*/
+template<int NumSegments = kDropCurveSegments>
+struct DropCurve
+{
+    float Values[NumSegments + 1];
+    int NumRoots;
+
+    FORCEINLINE float Evaluate(float X) const
+    {
+        float Unit = FMath::Clamp(X, 0.0f, 1.0f);
+        for (int i = 0; i < NumRoots; ++i)
+            Unit = FMath::Sqrt(Unit);
+        float Position = Unit * NumSegments;
+        int Segment = FMath::Min((int)Position, NumSegments - 1);
+        return FMath::Lerp(Values[Segment], Values[Segment + 1], Position - Segment);
+    }
+
+    /*
+    * Random number in [Min, Max] distributed by the curve. A curve that increases from 0
+    * to 1 is the inverse of a cumulative distribution, so evaluating it at a uniform `Unit`
+    * samples that distribution. E.g. x^p favours Min for p > 1 and Max for p < 1.
+    */
+    FORCEINLINE float Sample(float Unit, float Min, float Max) const
+    {
+        return Min + (Max - Min) * Evaluate(Unit);
+    }
+};
+
+// x^Exponent, for constexpr tables: `constexpr auto kCurve = MakeDropPowCurve(0.7);`
+template<int NumSegments = kDropCurveSegments>
+constexpr DropCurve<NumSegments> MakeDropPowCurve(double Exponent)
+{
+    DropCurve<NumSegments> Curve{};
+    Curve.NumRoots = GetDropPowCurveRoots(Exponent);
+    double TableExponent = Exponent * (1 << Curve.NumRoots);
+    for (int i = 0; i <= NumSegments; ++i)
+        Curve.Values[i] = (float)DropCurvePrivate::Pow((double)i / NumSegments, TableExponent);
+    return Curve;
+}
+
+// Largest difference between MakeDropPowCurve(Exponent) and FMath::Pow on [0, 1].
+inline float GetDropPowCurveMaxError(double Exponent, int NumSegments = kDropCurveSegments)
+{
+    const float Rounding = 1e-6f;   // Float table values, square roots and interpolation
+    const float Q = (float)Exponent * (1 << GetDropPowCurveRoots(Exponent));
+    const float H = 1.0f / NumSegments;
+    float FirstSegment = 0.0f;
+    if (Q != 1.0f) {
+        float T = FMath::Pow(Q, 1.0f / (1.0f - Q));
+        FirstSegment = FMath::Pow(H, Q) * FMath::Abs(T - FMath::Pow(T, Q));
+    }
+    float Curvature = Q * (Q - 1.0f) / 8.0f * FMath::Max(FMath::Pow(H, Q), H * H);
+    return FMath::Max(FirstSegment, Curvature) + Rounding;
+}
@@ -0,0 +1,56 @@
+#include "DropGrid.h"
+#include "Common.h"
+
+
+const float kMinCellSize = 1.0f;
+const int kMinBuckets = 1024;
+
+
+void DropGrid::Build(const DropStorage& Drops)
+{
+    m_MaxRadius = 0.0f;
+    for (int i = 0; i < Drops.Num(); ++i)
+        m_MaxRadius = FMath::Max(m_MaxRadius, Drops.Radius[i]);
+
+    // Overlapping drops are at most one cell apart
+    m_InvCellSize = 1.0f / FMath::Max(2.0f * m_MaxRadius * kOverlapFactor, kMinCellSize);
+
+    int NumBuckets = FMath::RoundUpToPowerOfTwo(FMath::Max(Drops.Num() * 2, kMinBuckets));
+    m_BucketMask = NumBuckets - 1;
+    m_BucketHeads.SetNumUninitialized(NumBuckets, false);
+    for (int i = 0; i < NumBuckets; ++i)
+        m_BucketHeads[i] = INDEX_NONE;
+
+    m_EntryNext.Reset();
+    m_EntryIDs.Reset();
+    for (int i = 0; i < Drops.Num(); ++i)
+        AddEntry(Drops.IDs[i], Drops.PositionX[i], Drops.PositionY[i]);
+
+    m_Valid = true;
+}
+
+void DropGrid::Insert(const DropStorage& Drops, int Index)
+{
+    if (!m_Valid)
+        return;
+
+    // Bigger than what the cells are sized for, queries could miss its overlaps
+    if (Drops.Radius[Index] > m_MaxRadius) {
+        Invalidate();
+        return;
+    }
+
+    // The drop is in the storage already, building adds it
+    if (m_EntryIDs.Num() >= FMath::Max(2 * Drops.Num(), kMinBuckets) || Drops.Num() > m_BucketHeads.Num()) {
+        Build(Drops);
+        return;
+    }
+    AddEntry(Drops.IDs[Index], Drops.PositionX[Index], Drops.PositionY[Index]);
+}
+
+void DropGrid::AddEntry(int ID, float X, float Y)
+{
+    int Bucket = GetBucket(GetCell(X), GetCell(Y));
+    m_EntryNext.Add(m_BucketHeads[Bucket]);
+    m_BucketHeads[Bucket] = m_EntryIDs.Add(ID);
+}
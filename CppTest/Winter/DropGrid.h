@@ -0,0 +1,101 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include "DropStorage.h"
+
+
+/*
+* Spatial hash grid over the drops, for overlap and finger queries.
+*
+* Cells are sized from the biggest drop, so two drops can only overlap if they are in
+* neighbouring cells. Cells are hashed into a power of two number of buckets, each bucket
+* a linked list of drop IDs. Entries are never removed, a killed drop's ID simply stops
+* resolving, so killing keeps the grid valid. Moving or growing drops does not:
+* `Invalidate` it and `Build` it again before the next query.
+*
+* So that emitting and killing without ticking can't pile up stale entries or overfill the
+* buckets, `Insert` builds the grid again once the entries are twice the drops or the drops
+* outnumber the buckets. At least half as many drops were emitted or killed since the last
+* build as it visits, so it stays O(1) per drop on average.
+*/
+class DropGrid
+{
+public:
+    void Build(const DropStorage& Drops);
+    void Insert(const DropStorage& Drops, int Index);
+    void Invalidate() { m_Valid = false; }
+
+    bool IsValid() const { return m_Valid; }
+    float GetMaxRadius() const { return m_MaxRadius; }
+    int GetNumEntries() const { return m_EntryIDs.Num(); }     // Stale ones too
+    int GetNumBuckets() const { return m_BucketHeads.Num(); }
+
+    /*
+    * Calls `Visitor(Index)` once for every drop whose position is in a cell touched by the box.
+    * The visitor must not add or remove drops.
+    */
+    template<class FuncType>
+    void ForEachInBox(
+        const DropStorage& Drops, const FVector2D& Min, const FVector2D& Max, FuncType Visitor
+    ) const;
+
+private:
+    int GetCell(float Coordinate) const {
+        return FMath::FloorToInt(Coordinate * m_InvCellSize);
+    }
+
+    int GetBucket(int CellX, int CellY) const {
+        return ((uint32)CellX * 73856093u ^ (uint32)CellY * 19349663u) & m_BucketMask;
+    }
+
+    void AddEntry(int ID, float X, float Y);
+
+    TArray<int> m_BucketHeads;  // Bucket -> first entry, INDEX_NONE when empty
+    TArray<int> m_EntryNext;
+    TArray<int> m_EntryIDs;
+    float m_MaxRadius = 0.0f;
+    float m_InvCellSize = 1.0f;
+    uint32 m_BucketMask = 0;
+    bool m_Valid = false;
+};
+
+
+template<class FuncType>
+void DropGrid::ForEachInBox(
+    const DropStorage& Drops, const FVector2D& Min, const FVector2D& Max, FuncType Visitor
+) const
+{
+    check(m_Valid);
+    int MinX = GetCell(Min.X), MinY = GetCell(Min.Y);
+    int MaxX = GetCell(Max.X), MaxY = GetCell(Max.Y);
+
+    // Sweeping all drops is cheaper than visiting more cells than there are buckets
+    if ((int64)(MaxX - MinX + 1) * (MaxY - MinY + 1) > m_BucketHeads.Num()) {
+        int CellX, CellY;
+        for (int i = 0; i < Drops.Num(); ++i) {
+            CellX = GetCell(Drops.PositionX[i]);
+            CellY = GetCell(Drops.PositionY[i]);
+            if (CellX >= MinX && CellX <= MaxX && CellY >= MinY && CellY <= MaxY)
+                Visitor(i);
+        }
+        return;
+    }
+
+    int Index;
+    for (int CellY = MinY; CellY <= MaxY; ++CellY) {
+        for (int CellX = MinX; CellX <= MaxX; ++CellX) {
+            int Entry = m_BucketHeads[GetBucket(CellX, CellY)];
+            for (; Entry != INDEX_NONE; Entry = m_EntryNext[Entry]) {
+                Index = Drops.IndexOf(m_EntryIDs[Entry]);
+                if (Index == INDEX_NONE)
+                    continue;
+
+                // Skip drops of other cells sharing the bucket
+                if (GetCell(Drops.PositionX[Index]) != CellX ||
+                    GetCell(Drops.PositionY[Index]) != CellY)
+                    continue;
+                Visitor(Index);
+            }
+        }
+    }
+}
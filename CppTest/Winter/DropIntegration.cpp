@@ -0,0 +1,159 @@
+#include "DropIntegration.h"
+#include "DropRandom.h"
+#include "Common.h"
+
+
+const float kAreaIncreaseFactorMin = 0.015f;    // Bigger value increase the growing speed of marching drops.
+const float kAreaIncreaseFactorMax = 0.35f;
+const float kAreaIncreaseFactorExp = 6.0f;      // Hardcoded as three squares in both paths
+const float kSqrtInputMin = 1e-30f;             // Keeps the reciprocal square root finite
+
+
+void IntegrateDropsScalar(DropStorage& Drops, int Begin, int End, const DropIntegrationParams& Params)
+{
+    float ForceDownward;
+    float Friction;
+    float AreaGrowed;
+    float MarchedDistance;
+    float Random;
+    FVector2D MoveVector;
+    for (int i = Begin; i < End; ++i)
+    {
+        // Calc Force
+        Friction = Drops.VelocityY[i] > 0 ? Params.DynamicFriction : Params.StaticFriction;
+        ForceDownward = GetDropDownwardForce(Drops.Radius[i], Params.Gravity, Friction);
+
+        // Calc Velocity
+        Drops.VelocityY[i] += ForceDownward * Params.DeltaSeconds;
+        Drops.VelocityY[i] = FMath::Max(Drops.VelocityY[i], 0.0f);
+
+        // Calc Position
+        MoveVector = Drops.GetVelocity(i) * Params.DeltaSeconds * Params.VelocityScale;
+        Drops.PositionX[i] += MoveVector.X;
+        Drops.PositionY[i] += MoveVector.Y;
+        Drops.DistanceNoTrail[i] += (MarchedDistance = MoveVector.Size());
+
+        // Increase Radius while marching downward
+        // Random^6 as three squares like the SIMD path, exact and cheaper than a DropCurve
+        Random = DropRandomUnit(Drops.IDs[i], Params.RandomCounter);
+        Random *= Random;
+        AreaGrowed = MarchedDistance * FMath::GetMappedRangeValueUnclamped(
+            FVector2D(0.0f, 1.0f), FVector2D(kAreaIncreaseFactorMin, kAreaIncreaseFactorMax),
+            Random * Random * Random
+        );
+        Drops.AdjustArea(i, AreaGrowed);
+    }
+}
+
+// sqrt(x) as x / sqrt(x), which is 0 rather than NaN for x == 0.
+static FORCEINLINE VectorRegister VectorSqrtNonNegative(const VectorRegister& Value)
+{
+    return VectorMultiply(
+        Value, VectorReciprocalSqrtAccurate(VectorMax(Value, VectorSetFloat1(kSqrtInputMin)))
+    );
+}
+
+// Columns of the last drops of a range, fewer than four, padded to a whole vector.
+struct DropIntegrationTail
+{
+    float Radius[4] = {};
+    float VelocityX[4] = {};
+    float VelocityY[4] = {};
+    float PositionX[4] = {};
+    float PositionY[4] = {};
+    float DistanceNoTrail[4] = {};
+    int IDs[4] = {};
+};
+
+void IntegrateDropsSimd(DropStorage& Drops, int Begin, int End, const DropIntegrationParams& Params)
+{
+    checkSlow(kAreaIncreaseFactorExp == 6.0f);
+
+    const VectorRegister Zero = VectorZero();
+    const VectorRegister DeltaSeconds = VectorSetFloat1(Params.DeltaSeconds);
+    const VectorRegister MoveFactor = VectorSetFloat1(Params.DeltaSeconds * Params.VelocityScale);
+    const VectorRegister Gravity = VectorSetFloat1(Params.Gravity);
+    const VectorRegister StaticFriction = VectorSetFloat1(Params.StaticFriction);
+    const VectorRegister DynamicFriction = VectorSetFloat1(Params.DynamicFriction);
+    const VectorRegister AreaFactorMin = VectorSetFloat1(kAreaIncreaseFactorMin);
+    const VectorRegister AreaFactorRange = VectorSetFloat1(kAreaIncreaseFactorMax - kAreaIncreaseFactorMin);
+
+    auto IntegrateFour = [&](
+        float* RadiusColumn, float* VelocityXColumn, float* VelocityYColumn, float* PositionXColumn,
+        float* PositionYColumn, float* DistanceNoTrailColumn, const int* IDColumn
+    ) {
+        VectorRegister Radius, RadiusSquared, VelocityX, VelocityY, Friction, ForceDownward;
+        VectorRegister MoveX, MoveY, MarchedDistance, Random, RandomSquared, AreaGrowed;
+        Radius = VectorLoad(RadiusColumn);
+        VelocityX = VectorLoad(VelocityXColumn);
+        VelocityY = VectorLoad(VelocityYColumn);
+
+        // Calc Force, friction picked without branching
+        RadiusSquared = VectorMultiply(Radius, Radius);
+        Friction = VectorSelect(VectorCompareGT(VelocityY, Zero), DynamicFriction, StaticFriction);
+        ForceDownward = VectorGetDropDownwardForce(Radius, Gravity, Friction);
+
+        // Calc Velocity
+        VelocityY = VectorMax(VectorMultiplyAdd(ForceDownward, DeltaSeconds, VelocityY), Zero);
+        VectorStore(VelocityY, VelocityYColumn);
+
+        // Calc Position
+        MoveX = VectorMultiply(VelocityX, MoveFactor);
+        MoveY = VectorMultiply(VelocityY, MoveFactor);
+        VectorStore(VectorAdd(VectorLoad(PositionXColumn), MoveX), PositionXColumn);
+        VectorStore(VectorAdd(VectorLoad(PositionYColumn), MoveY), PositionYColumn);
+        MarchedDistance = VectorSqrtNonNegative(
+            VectorMultiplyAdd(MoveX, MoveX, VectorMultiply(MoveY, MoveY))
+        );
+        VectorStore(VectorAdd(VectorLoad(DistanceNoTrailColumn), MarchedDistance), DistanceNoTrailColumn);
+
+        // Increase Radius while marching downward, Random^6
+        Random = VectorDropRandomUnit(VectorIntLoad(IDColumn), Params.RandomCounter);
+        RandomSquared = VectorMultiply(Random, Random);
+        Random = VectorMultiply(VectorMultiply(RandomSquared, RandomSquared), RandomSquared);
+        AreaGrowed = VectorMultiply(MarchedDistance, VectorMultiplyAdd(Random, AreaFactorRange, AreaFactorMin));
+        // Resting lanes keep their radius bit exact, as the scalar sqrt(r * r) does
+        Radius = VectorSelect(
+            VectorCompareGT(AreaGrowed, Zero),
+            VectorSqrtNonNegative(VectorAdd(RadiusSquared, AreaGrowed)), Radius
+        );
+        VectorStore(Radius, RadiusColumn);
+    };
+
+    int i = Begin;
+    for (; i + 4 <= End; i += 4)
+    {
+        IntegrateFour(
+            &Drops.Radius[i], &Drops.VelocityX[i], &Drops.VelocityY[i], &Drops.PositionX[i],
+            &Drops.PositionY[i], &Drops.DistanceNoTrail[i], &Drops.IDs[i]
+        );
+    }
+    if (i == End)
+        return;
+
+    // The tail goes through the same lanes instead of the scalar path, so a drop integrates
+    // bit for bit the same whichever row sleeping, waking or batching moved it to
+    DropIntegrationTail Tail;
+    int NumTail = End - i;
+    for (int Lane = 0; Lane < NumTail; ++Lane)
+    {
+        Tail.Radius[Lane] = Drops.Radius[i + Lane];
+        Tail.VelocityX[Lane] = Drops.VelocityX[i + Lane];
+        Tail.VelocityY[Lane] = Drops.VelocityY[i + Lane];
+        Tail.PositionX[Lane] = Drops.PositionX[i + Lane];
+        Tail.PositionY[Lane] = Drops.PositionY[i + Lane];
+        Tail.DistanceNoTrail[Lane] = Drops.DistanceNoTrail[i + Lane];
+        Tail.IDs[Lane] = Drops.IDs[i + Lane];
+    }
+    IntegrateFour(
+        Tail.Radius, Tail.VelocityX, Tail.VelocityY, Tail.PositionX, Tail.PositionY, Tail.DistanceNoTrail, Tail.IDs
+    );
+    for (int Lane = 0; Lane < NumTail; ++Lane)
+    {
+        Drops.Radius[i + Lane] = Tail.Radius[Lane];
+        Drops.VelocityY[i + Lane] = Tail.VelocityY[Lane];
+        Drops.PositionX[i + Lane] = Tail.PositionX[Lane];
+        Drops.PositionY[i + Lane] = Tail.PositionY[Lane];
+        Drops.DistanceNoTrail[i + Lane] = Tail.DistanceNoTrail[Lane];
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include "DropStorage.h"
+
+
+struct DropIntegrationParams
+{
+    float DeltaSeconds;
+    float Gravity;
+    float StaticFriction;
+    float DynamicFriction;
+    float VelocityScale;
+    uint32 RandomCounter;   // Changes every step, so drops grow differently each step
+};
+
+/*
+* Force pulling a drop down, its weight minus friction, as both integration paths compute it.
+* A drop at rest starts to move when this is above 0 with the static friction, so the sleep
+* test uses it too and never freezes a drop the next step would move.
+*/
+FORCEINLINE float GetDropDownwardForce(float Radius, float Gravity, float Friction)
+{
+    return Radius * Radius * (kDensity * Gravity) - Friction;
+}
+
+FORCEINLINE VectorRegister VectorGetDropDownwardForce(
+    const VectorRegister& Radius, const VectorRegister& Gravity, const VectorRegister& Friction
+)
+{
+    return VectorSubtract(
+        VectorMultiply(VectorMultiply(Radius, Radius), VectorMultiply(VectorSetFloat1(kDensity), Gravity)), Friction
+    );
+}
+
+/*
+* Integrates velocity, position, trail distance and growth of drops [Begin, End).
+* The scalar version is the reference, the SIMD version integrates four drops at a time
+* with the engine's vector registers (SSE, NEON, or a scalar fallback) and agrees with
+* it within `kDropIntegrationTolerance`. Each path gives a drop the same result whatever
+* its row, the SIMD one pads the last drops of the range to four.
+*/
+void IntegrateDropsScalar(DropStorage& Drops, int Begin, int End, const DropIntegrationParams& Params);
+void IntegrateDropsSimd(DropStorage& Drops, int Begin, int End, const DropIntegrationParams& Params);
+
+// Relative error between the two paths after one step, from the reciprocal square roots.
+const float kDropIntegrationTolerance = 1e-5f;
@@ -0,0 +1,127 @@
+#include "DropPipeline.h"
+#include "DropStats.h"
+#include "Common.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Pipeline - Wait"), STAT_DropPipelineWait, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Pipeline - Snapshot"), STAT_DropPipelineSnapshot, STATGROUP_Drops);
+
+
+DropPipeline::~DropPipeline()
+{
+    Sync();
+}
+
+void DropPipeline::Kill(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius, int NumSteps)
+{
+    Enqueue(DropCommand(EDropCommand::Kill, Start, End, StartRadius, EndRadius, NumSteps));
+}
+
+// The path is copied into m_CommandPaths when queued, so queueing doesn't allocate once it has grown.
+void DropPipeline::MarkDropsOutsideFinger(TArrayView<const FVector2D> Path, float Radius)
+{
+    if (!m_Pipelined) {
+        m_Simulation.MarkDropsOutsideFinger(Path, Radius);
+        return;
+    }
+    m_Commands.Add(DropCommand(EDropCommand::MarkOutsideFinger, m_CommandPaths.Num(), Path.Num(), Radius));
+    m_CommandPaths.Append(Path.GetData(), Path.Num());
+}
+
+/*
+* Serial: ticks the simulation. Pipelined: takes the snapshot of the simulation started last
+* frame, then hands it this frame's edits and starts the next one on a worker.
+*/
+void DropPipeline::Advance(float DeltaSeconds, const FVector2D& ClipSize)
+{
+    if (!m_Pipelined) {
+        m_Simulation.Advance(DeltaSeconds, ClipSize);
+        return;
+    }
+
+    Sync();
+    {
+        DROP_SCOPE(DropPipelineSnapshot);
+        m_Snapshot.CopyDrawState(m_Simulation);
+    }
+    for (const DropCommand& Command : m_Commands)
+        Apply(Command);
+    m_Commands.Reset();
+    m_CommandPaths.Reset();
+
+    m_PendingSteps = Async(EAsyncExecution::TaskGraph, [this, DeltaSeconds, ClipSize]() {
+        return m_Simulation.Advance(DeltaSeconds, ClipSize);
+    });
+}
+
+// Waits for the simulation running on the worker, if there is one.
+void DropPipeline::Sync()
+{
+    m_LastWaitSeconds = 0.0;
+    if (!m_PendingSteps.IsValid())
+        return;
+
+    DROP_SCOPE(DropPipelineWait);
+    double StartSeconds = FPlatformTime::Seconds();
+    m_PendingSteps.Wait();
+    m_PendingSteps = TFuture<int>();
+    m_LastWaitSeconds = FPlatformTime::Seconds() - StartSeconds;
+}
+
+void DropPipeline::Draw(UTextureRenderTarget2D* RT_Drops,
+    UTextureRenderTarget2D* RT_MovedDrops, UTexture* T_Raindrop,
+    float ViewPortRatio
+)
+{
+    DropSystem& Drawn = m_Pipelined ? m_Snapshot : m_Simulation;
+    Drawn.Draw(RT_Drops, RT_MovedDrops, T_Raindrop, ViewPortRatio);
+}
+
+/*
+* Switching takes effect right away: turning it on snapshots the drops as they are, turning
+* it off waits for the simulation and hands it the edits still queued.
+*/
+void DropPipeline::SetPipelined(bool Pipelined)
+{
+    if (Pipelined == m_Pipelined)
+        return;
+
+    Sync();
+    if (Pipelined) {
+        m_Snapshot.CopyDrawState(m_Simulation);
+        m_Snapshot.InvalidateDrawnDrops();
+    }
+    else {
+        for (const DropCommand& Command : m_Commands)
+            Apply(Command);
+        m_Commands.Reset();
+        m_CommandPaths.Reset();
+        m_Simulation.InvalidateDrawnDrops();
+    }
+    m_Pipelined = Pipelined;
+}
+
+void DropPipeline::Enqueue(const DropCommand& Command)
+{
+    if (m_Pipelined)
+        m_Commands.Add(Command);
+    else
+        Apply(Command);
+}
+
+void DropPipeline::Apply(const DropCommand& Command)
+{
+    switch (Command.Type) {
+    case EDropCommand::Emit:
+        m_Simulation.Emit(Command.NewDrop);
+        break;
+    case EDropCommand::Kill:
+        m_Simulation.Kill(Command.Start, Command.End, Command.StartRadius, Command.EndRadius, Command.NumSteps);
+        break;
+    case EDropCommand::MarkOutsideFinger:
+        m_Simulation.MarkDropsOutsideFinger(
+            TArrayView<const FVector2D>(m_CommandPaths.GetData() + Command.PathStart, Command.PathNum), Command.StartRadius
+        );
+        break;
+    }
+}
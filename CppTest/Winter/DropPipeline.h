@@ -0,0 +1,107 @@
+#pragma once
+#include <CoreMinimal.h>
+#include <Async/Async.h>
+
+#include "DropSystem.h"
+
+
+enum class EDropCommand : uint8
+{
+    Emit,
+    Kill,
+    MarkOutsideFinger,
+};
+
+// An edit of the drops from input, kept until the simulation can take it.
+struct DropCommand
+{
+    EDropCommand Type;
+    Drop NewDrop;               // Emit
+    FVector2D Start;            // Kill, a capsule
+    FVector2D End;
+    float StartRadius;          // And the radius of MarkOutsideFinger
+    float EndRadius;
+    int NumSteps;               // Kill, 0 for the whole capsule
+    int PathStart;              // MarkOutsideFinger, the path the finger swept in DropPipeline::m_CommandPaths
+    int PathNum;
+
+    explicit DropCommand(const Drop& InNewDrop)
+        : Type(EDropCommand::Emit), NewDrop(InNewDrop)
+        , Start(FVector2D::ZeroVector), End(FVector2D::ZeroVector), StartRadius(0.0f), EndRadius(0.0f), NumSteps(0)
+        , PathStart(0), PathNum(0)
+    {
+    }
+
+    DropCommand(EDropCommand InType, const FVector2D& InStart, const FVector2D& InEnd, float InStartRadius, float InEndRadius, int InNumSteps)
+        : Type(InType), NewDrop(InStart, FVector2D::ZeroVector, FVector2D::ZeroVector)
+        , Start(InStart), End(InEnd), StartRadius(InStartRadius), EndRadius(InEndRadius), NumSteps(InNumSteps)
+        , PathStart(0), PathNum(0)
+    {
+    }
+
+    DropCommand(EDropCommand InType, int InPathStart, int InPathNum, float InRadius)
+        : Type(InType), NewDrop(FVector2D::ZeroVector, FVector2D::ZeroVector, FVector2D::ZeroVector)
+        , Start(FVector2D::ZeroVector), End(FVector2D::ZeroVector), StartRadius(InRadius), EndRadius(InRadius), NumSteps(0)
+        , PathStart(InPathStart), PathNum(InPathNum)
+    {
+    }
+};
+
+/*
+* Runs the drop simulation a frame ahead on a worker thread, while the game thread draws
+* the frame before from a snapshot.
+*
+* Every frame `Advance` waits for the simulation started last frame, copies its drops into
+* the snapshot, applies the edits queued since, and starts simulating the next frame.
+* Draw and GetTimeSeconds read the snapshot, so the screen is exactly one frame behind.
+* The simulation sees the same edits at the same points either way, so a pipelined run
+* is the serial run delayed by a frame, drop for drop.
+*
+* Without pipelining every call goes straight to the simulation, as if there was no
+* pipeline. `m_Simulation` may only be touched after `Sync`, e.g. to change its settings.
+*/
+class DropPipeline
+{
+public:
+    ~DropPipeline();
+
+    template<class... Types> void Emit(Types... Args);
+    void Kill(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius, int NumSteps = 0);
+    void MarkDropsOutsideFinger(TArrayView<const FVector2D> Path, float Radius);
+    void MarkDropsOutsideFinger(const FVector2D& Center, float Radius) {
+        MarkDropsOutsideFinger(TArrayView<const FVector2D>(&Center, 1), Radius);
+    }
+
+    void Advance(float DeltaSeconds, const FVector2D& ClipSize);
+    void Sync();
+    void Draw(UTextureRenderTarget2D* RT_Drops,
+        UTextureRenderTarget2D* RT_MovedDrops, UTexture* T_Raindrop,
+        float ViewPortRatio
+    );
+
+    void SetPipelined(bool Pipelined);
+    bool IsPipelined() const { return m_Pipelined; }
+    const DropSystem& GetDrawnDrops() const { return m_Pipelined ? m_Snapshot : m_Simulation; }
+    float GetTimeSeconds() const { return GetDrawnDrops().GetTimeSeconds(); }
+    double GetLastWaitSeconds() const { return m_LastWaitSeconds; }     // Game thread blocked in the last Sync
+
+    DropSystem m_Simulation;
+
+private:
+    void Apply(const DropCommand& Command);
+    void Enqueue(const DropCommand& Command);
+
+    DropSystem m_Snapshot;
+    TArray<DropCommand> m_Commands;     // In the order they came in
+    TArray<FVector2D> m_CommandPaths;   // Points of the queued commands' paths, reused every frame
+    TFuture<int> m_PendingSteps;        // Ticks of the simulation running on the worker
+    bool m_Pipelined = false;
+    double m_LastWaitSeconds = 0.0;
+};
+
+
+template<class... Types>
+void DropPipeline::Emit(Types... Args)
+{
+    Enqueue(DropCommand(Drop(Args...)));
+}
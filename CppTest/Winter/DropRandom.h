@@ -0,0 +1,138 @@
+#pragma once
+#include <CoreMinimal.h>
+
+
+/*
+* Counter based random numbers: a number only depends on its key (e.g. a drop ID) and a
+* counter (e.g. the frame), not on how many numbers were drawn before. So drops can be
+* processed in any order, or four at a time, and still draw the same numbers.
+* Every random number in Winter/ comes from here, so a seed and the inputs replay a session.
+*/
+
+const uint32 kDropRandomDefaultSeed = 0;
+
+// Integer hash with good avalanche, see https://nullprogram.com/blog/2018/07/31/
+inline uint32 HashDropRandom(uint32 Value)
+{
+    Value ^= Value >> 16;
+    Value *= 0x7feb352du;
+    Value ^= Value >> 15;
+    Value *= 0x846ca68bu;
+    Value ^= Value >> 16;
+    return Value;
+}
+
+inline uint32 HashDropRandomCounter(uint32 Counter)
+{
+    return HashDropRandom(Counter + 0x9e3779b9u);   // Offset, so key 0 and counter 0 is not 0
+}
+
+inline uint32 HashDropRandom(uint32 Key, uint32 Counter)
+{
+    return HashDropRandom(Key ^ HashDropRandomCounter(Counter));
+}
+
+// Uniform in [0, 1), with the 24 bits a float can hold.
+inline float DropRandomUnit(uint32 Key, uint32 Counter)
+{
+    return (HashDropRandom(Key, Counter) >> 8) * (1.0f / 16777216.0f);
+}
+
+inline float DropRandomRange(uint32 Key, uint32 Counter, float Min, float Max)
+{
+    return Min + (Max - Min) * DropRandomUnit(Key, Counter);
+}
+
+// Independent streams of numbers for the same drop and step.
+enum class EDropRandomStream : uint32
+{
+    Growth,
+    TrailDistance,
+    TrailRadius,
+    TrailOffset,
+    EmitDistance,   // Trail distance of an emitted drop
+    Emit,           // DropRandomSequence of the emitter, not keyed by drops
+    Num
+};
+
+// Seed 0 hashes to 0, so it leaves the counters as they are.
+inline uint32 GetDropRandomCounter(uint32 Seed, uint32 Step, EDropRandomStream Stream)
+{
+    return (Step * (uint32)EDropRandomStream::Num + (uint32)Stream) ^ HashDropRandom(Seed);
+}
+
+// Same as HashDropRandom for four keys, `HashedCounter` is HashDropRandomCounter(Counter).
+FORCEINLINE VectorRegisterInt VectorHashDropRandom(const VectorRegisterInt& Keys, uint32 HashedCounter)
+{
+    const int32 Counter = (int32)HashedCounter;
+    const int32 Multiplier1 = (int32)0x7feb352du;
+    const int32 Multiplier2 = (int32)0x846ca68bu;
+
+    VectorRegisterInt Value = VectorIntXor(Keys, MakeVectorRegisterInt(Counter, Counter, Counter, Counter));
+    Value = VectorIntXor(Value, VectorShiftRightImmLogical(Value, 16));
+    Value = VectorIntMultiply(Value, MakeVectorRegisterInt(Multiplier1, Multiplier1, Multiplier1, Multiplier1));
+    Value = VectorIntXor(Value, VectorShiftRightImmLogical(Value, 15));
+    Value = VectorIntMultiply(Value, MakeVectorRegisterInt(Multiplier2, Multiplier2, Multiplier2, Multiplier2));
+    Value = VectorIntXor(Value, VectorShiftRightImmLogical(Value, 16));
+    return Value;
+}
+
+// Same as DropRandomUnit for four keys.
+FORCEINLINE VectorRegister VectorDropRandomUnit(const VectorRegisterInt& Keys, uint32 Counter)
+{
+    VectorRegisterInt Hashed = VectorHashDropRandom(Keys, HashDropRandomCounter(Counter));
+    return VectorMultiply(
+        VectorIntToFloat(VectorShiftRightImmLogical(Hashed, 8)),
+        VectorSetFloat1(1.0f / 16777216.0f)
+    );
+}
+
+
+/*
+* Random numbers that belong to no drop, e.g. whether the brush emits one. Number `i` of
+* the sequence is DropRandomUnit(i, Counter), so a batch is four keys at a time, and the
+* seed and position are all it takes to replay it.
+*/
+class DropRandomSequence
+{
+public:
+    explicit DropRandomSequence(uint32 Seed = kDropRandomDefaultSeed, EDropRandomStream Stream = EDropRandomStream::Emit)
+        : m_Counter(GetDropRandomCounter(Seed, 0, Stream))
+        , m_Position(0)
+    {
+    }
+
+    float GetUnit() {
+        return DropRandomUnit(m_Position++, m_Counter);
+    }
+
+    float GetRange(float Min, float Max) {
+        return Min + (Max - Min) * GetUnit();
+    }
+
+    // Same numbers as `Num` calls of GetRange, in order.
+    void FillRange(float* Out, int Num, float Min, float Max) {
+        const VectorRegister VectorMin = VectorSetFloat1(Min);
+        const VectorRegister VectorScale = VectorSetFloat1(Max - Min);
+        const VectorRegisterInt Four = MakeVectorRegisterInt(4, 4, 4, 4);
+        VectorRegisterInt Keys = MakeVectorRegisterInt(
+            (int32)m_Position, (int32)(m_Position + 1), (int32)(m_Position + 2), (int32)(m_Position + 3)
+        );
+
+        int i = 0;
+        for (; i + 4 <= Num; i += 4) {
+            VectorStore(VectorMultiplyAdd(VectorDropRandomUnit(Keys, m_Counter), VectorScale, VectorMin), &Out[i]);
+            Keys = VectorIntAdd(Keys, Four);
+        }
+        m_Position += i;
+        for (; i < Num; ++i)
+            Out[i] = GetRange(Min, Max);
+    }
+
+    uint32 GetPosition() const { return m_Position; }
+    void SetPosition(uint32 Position) { m_Position = Position; }
+
+private:
+    uint32 m_Counter;
+    uint32 m_Position;  // Numbers drawn so far
+};
@@ -0,0 +1,258 @@
+#include "DropSnapshot.h"
+#include "Common.h"
+
+#include <HAL/PlatformFileManager.h>
+#include <Async/MappedFileHandle.h>
+#include <Misc/FileHelper.h>
+
+
+PRAGMA_OPTION
+
+static_assert(PLATFORM_LITTLE_ENDIAN, "Snapshots are written as the columns are in memory");
+
+
+// Columns of `Storage` in file order, as (EDropSnapshotColumn, TArray&).
+template<class StorageType, class FuncType>
+void DropSnapshot::ForEachColumn(StorageType& Storage, FuncType Visitor)
+{
+    Visitor(EDropSnapshotColumn::IDs, Storage.IDs);
+    Visitor(EDropSnapshotColumn::PositionX, Storage.PositionX);
+    Visitor(EDropSnapshotColumn::PositionY, Storage.PositionY);
+    Visitor(EDropSnapshotColumn::PrevPositionX, Storage.PrevPositionX);
+    Visitor(EDropSnapshotColumn::PrevPositionY, Storage.PrevPositionY);
+    Visitor(EDropSnapshotColumn::VelocityX, Storage.VelocityX);
+    Visitor(EDropSnapshotColumn::VelocityY, Storage.VelocityY);
+    Visitor(EDropSnapshotColumn::Stretch, Storage.Stretch);
+    Visitor(EDropSnapshotColumn::Radius, Storage.Radius);
+    Visitor(EDropSnapshotColumn::BirthTimeSeconds, Storage.BirthTimeSeconds);
+    Visitor(EDropSnapshotColumn::DistanceNoTrail, Storage.DistanceNoTrail);
+    Visitor(EDropSnapshotColumn::NextTrailDistance, Storage.NextTrailDistance);
+    Visitor(EDropSnapshotColumn::Flags, Storage.Flags);
+    Visitor(EDropSnapshotColumn::SlotIndices, Storage.m_SlotIndices);
+    Visitor(EDropSnapshotColumn::SlotGenerations, Storage.m_SlotGenerations);
+    Visitor(EDropSnapshotColumn::FreeSlots, Storage.m_FreeSlots);
+}
+
+int64 DropSnapshot::GetColumnNum(EDropSnapshotColumn Column, const DropSnapshotHeader& Header)
+{
+    switch (Column) {
+    case EDropSnapshotColumn::SlotIndices:
+    case EDropSnapshotColumn::SlotGenerations:
+        return Header.NumSlots;
+    case EDropSnapshotColumn::FreeSlots:
+        return Header.NumFreeSlots;
+    default:
+        return Header.NumDrops;
+    }
+}
+
+/*
+* Whether the IDs, slots and free list of the snapshot in `Data` fit together like
+* DropStorage keeps them, so no handle resolves to a row it isn't in. The columns are
+* aligned in the file and the file is mapped or allocated aligned, so they are read in place.
+*/
+bool DropSnapshot::AreSlotsValid(const uint8* Data, const DropSnapshotHeader& Header)
+{
+    auto GetColumn = [&](EDropSnapshotColumn Column) {
+        return reinterpret_cast<const int*>(Data + Header.Columns[(int)Column].Offset);
+    };
+    const int* IDs = GetColumn(EDropSnapshotColumn::IDs);
+    const int* SlotIndices = GetColumn(EDropSnapshotColumn::SlotIndices);
+    const int* SlotGenerations = GetColumn(EDropSnapshotColumn::SlotGenerations);
+    const int* FreeSlots = GetColumn(EDropSnapshotColumn::FreeSlots);
+
+    for (int Slot = 0; Slot < Header.NumSlots; ++Slot) {
+        int Index = SlotIndices[Slot];
+        if ((Index != INDEX_NONE && (Index < 0 || Index >= Header.NumDrops)) ||
+            SlotGenerations[Slot] < 0 || SlotGenerations[Slot] > kDropGenerationMask)
+            return false;
+    }
+
+    // With every row's slot leading back to it, the used slots are exactly the rows
+    for (int Index = 0; Index < Header.NumDrops; ++Index) {
+        int ID = IDs[Index];
+        int Slot = GetDropSlot(ID);
+        if (ID < 0 || Slot >= Header.NumSlots || SlotIndices[Slot] != Index ||
+            (ID >> kDropSlotBits) != SlotGenerations[Slot])
+            return false;
+    }
+
+    // As many free slots as unused ones, each unused and listed once, in a min heap
+    TArray<uint8> IsListed;
+    IsListed.SetNumZeroed(Header.NumSlots);
+    for (int i = 0; i < Header.NumFreeSlots; ++i) {
+        int Slot = FreeSlots[i];
+        if (Slot < 0 || Slot >= Header.NumSlots || SlotIndices[Slot] != INDEX_NONE || IsListed[Slot] ||
+            (i > 0 && FreeSlots[(i - 1) / 2] > Slot))
+            return false;
+        IsListed[Slot] = 1;
+    }
+    return true;
+}
+
+void DropSnapshot::Write(const DropSystem& Drops, TArray<uint8>& OutData)
+{
+    const DropStorage& Storage = Drops.m_Drops;
+
+    DropSnapshotHeader Header;
+    FMemory::Memzero(Header);
+    Header.Magic = kDropSnapshotMagic;
+    Header.Version = kDropSnapshotVersion;
+    Header.HeaderSize = sizeof(DropSnapshotHeader);
+    Header.NumColumns = (uint32)EDropSnapshotColumn::Num;
+
+    Header.NumDrops = Storage.Num();
+    Header.NumAwake = Storage.m_NumAwake;
+    Header.NumSlots = Storage.NumSlots();
+    Header.NumFreeSlots = Storage.m_FreeSlots.Num();
+    Header.NumPeak = Storage.m_NumPeak;
+    Header.NumRecycled = Storage.m_NumRecycled;
+    Header.NumGrowths = Storage.m_NumGrowths;
+    Header.Capacity = Storage.IDs.Max();
+
+    Header.RadiusRenderFactor = Drops.m_RadiusRenderFactor;
+    Header.Gravity = Drops.m_Gravity;
+    Header.StaticFriction = Drops.m_StaticFriction;
+    Header.DynamicFriction = Drops.m_DynamicFriction;
+    Header.VelocityScale = Drops.m_VelocityScale;
+    Header.SplitTrailVelocityThreshold = Drops.m_SplitTrailVelocityThreshold;
+    Header.UseSleeping = Drops.m_UseSleeping ? 1 : 0;
+    Header.FixedStepSeconds = Drops.m_FixedStepSeconds;
+    Header.MaxSubSteps = Drops.m_MaxSubSteps;
+    Header.MaxDrops = Drops.m_MaxDrops;
+    Header.TargetTickMilliseconds = Drops.m_TargetTickMilliseconds;
+
+    Header.RandomSeed = Drops.m_RandomSeed;
+    Header.RandomCounter = Drops.m_RandomCounter;
+    Header.TimeSeconds = Drops.m_TimeSeconds;
+    Header.LastDeltaSeconds = Drops.m_LastDeltaSeconds;
+    Header.StepAccumulatorSeconds = Drops.m_StepAccumulatorSeconds;
+    Header.InterpolationAlpha = Drops.m_InterpolationAlpha;
+    Header.NumKilled = Drops.m_NumKilled;
+    Header.TimeBudgetDrops = Drops.m_TimeBudgetDrops;
+    Header.SleepGravity = Drops.m_SleepGravity;
+    Header.SleepStaticFriction = Drops.m_SleepStaticFriction;
+    Header.SleepClipSizeX = Drops.m_SleepClipSize.X;
+    Header.SleepClipSizeY = Drops.m_SleepClipSize.Y;
+
+    uint64 Offset = Align(sizeof(DropSnapshotHeader), kDropSnapshotAlignment);
+    ForEachColumn(Storage, [&](EDropSnapshotColumn Column, const auto& Array) {
+        DropSnapshotColumn& Entry = Header.Columns[(int)Column];
+        Entry.Offset = Offset;
+        Entry.Size = (uint64)Array.Num() * Array.GetTypeSize();
+        Offset = Align(Offset + Entry.Size, kDropSnapshotAlignment);
+    });
+    Header.FileSize = Offset;
+
+    // Zeroed, so the padding between the columns is the same in every file
+    OutData.Reset();
+    OutData.SetNumZeroed((int32)Header.FileSize);
+    FMemory::Memcpy(OutData.GetData(), &Header, sizeof(Header));
+    ForEachColumn(Storage, [&](EDropSnapshotColumn Column, const auto& Array) {
+        const DropSnapshotColumn& Entry = Header.Columns[(int)Column];
+        FMemory::Memcpy(OutData.GetData() + Entry.Offset, Array.GetData(), Entry.Size);
+    });
+}
+
+/*
+* Replaces the drops, tuning and time of `OutDrops` with the snapshot in `Data`. How
+* it simulates and draws, threads, SIMD, grid and batching, stays as it is. False and
+* nothing changed when `Data` isn't a whole snapshot of this version or its handles
+* don't resolve.
+*/
+bool DropSnapshot::Read(const uint8* Data, int64 Size, DropSystem& OutDrops)
+{
+    if (Size < (int64)sizeof(DropSnapshotHeader))
+        return false;
+
+    DropSnapshotHeader Header;
+    FMemory::Memcpy(&Header, Data, sizeof(Header));
+    if (Header.Magic != kDropSnapshotMagic || Header.Version != kDropSnapshotVersion ||
+        Header.HeaderSize != sizeof(DropSnapshotHeader) || Header.NumColumns != (uint32)EDropSnapshotColumn::Num ||
+        Header.FileSize != (uint64)Size)
+        return false;
+
+    if (Header.NumDrops < 0 || Header.NumSlots < Header.NumDrops || Header.NumSlots > kDropSlotMask + 1 ||
+        Header.NumAwake < 0 || Header.NumAwake > Header.NumDrops ||
+        Header.NumFreeSlots != Header.NumSlots - Header.NumDrops ||
+        Header.Capacity < Header.NumSlots || Header.Capacity > kDropSlotMask + 1)
+        return false;
+
+    bool IsValid = true;
+    ForEachColumn(OutDrops.m_Drops, [&](EDropSnapshotColumn Column, auto& Array) {
+        const DropSnapshotColumn& Entry = Header.Columns[(int)Column];
+        IsValid &= Entry.Size == (uint64)GetColumnNum(Column, Header) * Array.GetTypeSize() &&
+            Entry.Offset % kDropSnapshotAlignment == 0 &&
+            Entry.Offset >= sizeof(DropSnapshotHeader) &&
+            Entry.Offset <= Header.FileSize && Entry.Size <= Header.FileSize - Entry.Offset;
+    });
+    if (!IsValid || !AreSlotsValid(Data, Header))
+        return false;
+
+    DropStorage& Storage = OutDrops.m_Drops;
+    Storage.Reserve(Header.Capacity);
+    ForEachColumn(Storage, [&](EDropSnapshotColumn Column, auto& Array) {
+        const DropSnapshotColumn& Entry = Header.Columns[(int)Column];
+        Array.SetNumUninitialized(GetColumnNum(Column, Header), false);
+        FMemory::Memcpy(Array.GetData(), Data + Entry.Offset, Entry.Size);
+    });
+    Storage.m_NumAwake = Header.NumAwake;
+    Storage.m_NumPeak = Header.NumPeak;
+    Storage.m_NumRecycled = Header.NumRecycled;
+    Storage.m_NumGrowths = Header.NumGrowths;
+
+    OutDrops.m_RadiusRenderFactor = Header.RadiusRenderFactor;
+    OutDrops.m_Gravity = Header.Gravity;
+    OutDrops.m_StaticFriction = Header.StaticFriction;
+    OutDrops.m_DynamicFriction = Header.DynamicFriction;
+    OutDrops.m_VelocityScale = Header.VelocityScale;
+    OutDrops.m_SplitTrailVelocityThreshold = Header.SplitTrailVelocityThreshold;
+    OutDrops.m_UseSleeping = Header.UseSleeping != 0;
+    OutDrops.m_FixedStepSeconds = Header.FixedStepSeconds;
+    OutDrops.m_MaxSubSteps = Header.MaxSubSteps;
+    OutDrops.m_MaxDrops = Header.MaxDrops;
+    OutDrops.m_TargetTickMilliseconds = Header.TargetTickMilliseconds;
+
+    OutDrops.m_RandomSeed = Header.RandomSeed;
+    OutDrops.m_RandomCounter = Header.RandomCounter;
+    OutDrops.m_TimeSeconds = Header.TimeSeconds;
+    OutDrops.m_LastDeltaSeconds = Header.LastDeltaSeconds;
+    OutDrops.m_StepAccumulatorSeconds = Header.StepAccumulatorSeconds;
+    OutDrops.m_InterpolationAlpha = Header.InterpolationAlpha;
+    OutDrops.m_NumKilled = Header.NumKilled;
+    OutDrops.m_TimeBudgetDrops = Header.TimeBudgetDrops;
+    OutDrops.m_SleepGravity = Header.SleepGravity;
+    OutDrops.m_SleepStaticFriction = Header.SleepStaticFriction;
+    OutDrops.m_SleepClipSize = FVector2D(Header.SleepClipSizeX, Header.SleepClipSizeY);
+
+    // Everything derived from the old drops
+    OutDrops.m_Grid.Invalidate();
+    OutDrops.InvalidateDrawnDrops();
+    OutDrops.m_NumPairsTested = 0;
+    OutDrops.m_DrawStats = DropDrawStats();
+    OutDrops.m_TickStats = DropTickStats();
+    return true;
+}
+
+bool DropSnapshot::Save(const DropSystem& Drops, const FString& Path)
+{
+    TArray<uint8> Data;
+    Write(Drops, Data);
+    return FFileHelper::SaveArrayToFile(Data, *Path);
+}
+
+// Maps the file where the platform can, so the columns are copied straight from the page cache.
+bool DropSnapshot::Load(const FString& Path, DropSystem& OutDrops)
+{
+    TUniquePtr<IMappedFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+    if (File.IsValid()) {
+        TUniquePtr<IMappedFileRegion> Region(File->MapRegion(0, File->GetFileSize()));
+        if (Region.IsValid())
+            return Read(Region->GetMappedPtr(), Region->GetMappedSize(), OutDrops);
+    }
+
+    TArray<uint8> Data;
+    if (!FFileHelper::LoadFileToArray(Data, *Path))
+        return false;
+    return Read(Data.GetData(), Data.Num(), OutDrops);
+}
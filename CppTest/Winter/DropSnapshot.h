@@ -0,0 +1,115 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include "DropSystem.h"
+
+
+const uint32 kDropSnapshotMagic = 0x504E5344;   // "DSNP"
+const uint32 kDropSnapshotVersion = 1;
+const int kDropSnapshotAlignment = 64;          // Of every column in the file
+
+enum class EDropSnapshotColumn : uint32
+{
+    IDs,
+    PositionX,
+    PositionY,
+    PrevPositionX,
+    PrevPositionY,
+    VelocityX,
+    VelocityY,
+    Stretch,
+    Radius,
+    BirthTimeSeconds,
+    DistanceNoTrail,
+    NextTrailDistance,
+    Flags,
+    SlotIndices,
+    SlotGenerations,
+    FreeSlots,
+    Num
+};
+
+// Where a column is in the file, in bytes from its start.
+struct DropSnapshotColumn
+{
+    uint64 Offset;
+    uint64 Size;
+};
+
+/*
+* Start of a snapshot file, followed by the columns of DropStorage as they are in memory,
+* each aligned to kDropSnapshotAlignment. Little endian, fixed size types only, so a file
+* can be mapped and its columns copied as they are.
+*/
+struct DropSnapshotHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    uint32 HeaderSize;      // sizeof(DropSnapshotHeader), changes with the version
+    uint32 NumColumns;
+    uint64 FileSize;
+
+    // Storage
+    int32 NumDrops;
+    int32 NumAwake;
+    int32 NumSlots;
+    int32 NumFreeSlots;
+    int32 NumPeak;
+    int32 NumRecycled;
+    int32 NumGrowths;
+    int32 Capacity;         // Drops the columns had room for, so they grow when they did
+
+    // Tuning, what the drops do. How they are simulated and drawn is up to the loader.
+    float RadiusRenderFactor;
+    float Gravity;
+    float StaticFriction;
+    float DynamicFriction;
+    float VelocityScale;
+    float SplitTrailVelocityThreshold;
+    uint32 UseSleeping;
+    float FixedStepSeconds;
+    int32 MaxSubSteps;
+    int32 MaxDrops;
+    float TargetTickMilliseconds;
+
+    // Random numbers and time
+    uint32 RandomSeed;
+    uint32 RandomCounter;
+    float TimeSeconds;
+    float LastDeltaSeconds;
+    float StepAccumulatorSeconds;
+    float InterpolationAlpha;
+    int32 NumKilled;
+    float TimeBudgetDrops;
+    float SleepGravity;
+    float SleepStaticFriction;
+    float SleepClipSizeX;
+    float SleepClipSizeY;
+
+    DropSnapshotColumn Columns[(int)EDropSnapshotColumn::Num];
+};
+
+/*
+* Saves and loads the whole state of a DropSystem: the drops and their slots, the tuning,
+* the random counter and the time. Ticking a loaded system gives the same drops as
+* ticking the saved one.
+*
+* Loading maps the file and copies each column in one go, so a glass of 100k drops loads
+* in a few milliseconds. Before that, the file is checked for its layout and for handles
+* that resolve: every ID leads back to its row and every free slot is listed once. The
+* values of the drops are taken as they are, a file changed by hand loads what it says.
+*/
+class DropSnapshot
+{
+public:
+    static void Write(const DropSystem& Drops, TArray<uint8>& OutData);
+    static bool Read(const uint8* Data, int64 Size, DropSystem& OutDrops);
+
+    static bool Save(const DropSystem& Drops, const FString& Path);
+    static bool Load(const FString& Path, DropSystem& OutDrops);
+
+private:
+    template<class StorageType, class FuncType> static void ForEachColumn(StorageType& Storage, FuncType Visitor);
+    static int64 GetColumnNum(EDropSnapshotColumn Column, const DropSnapshotHeader& Header);
+    static bool AreSlotsValid(const uint8* Data, const DropSnapshotHeader& Header);
+};
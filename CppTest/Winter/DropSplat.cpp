@@ -0,0 +1,147 @@
+#include "DropSplat.h"
+#include "Common.h"
+
+#include <Engine/Texture.h>
+
+
+const float kRoundSpriteRim = 0.15f;   // Of the radius, where the alpha of the round sprite fades out
+
+
+void DropImage::Init(int InWidth, int InHeight, const FLinearColor& Color)
+{
+    Width = InWidth;
+    Height = InHeight;
+    Pixels.SetNumUninitialized(Width * Height, false);
+    Clear(Color);
+}
+
+void DropImage::Clear(const FLinearColor& Color)
+{
+    for (FLinearColor& Pixel : Pixels)
+        Pixel = Color;
+}
+
+// Pixels whose centre is inside the rectangle, like an opaque quad would cover them.
+void DropImage::ClearRect(const FVector2D& Min, const FVector2D& Max, const FLinearColor& Color)
+{
+    int X0 = FMath::Max(FMath::CeilToInt(Min.X - 0.5f), 0);
+    int Y0 = FMath::Max(FMath::CeilToInt(Min.Y - 0.5f), 0);
+    int X1 = FMath::Min(FMath::CeilToInt(Max.X - 0.5f), Width);
+    int Y1 = FMath::Min(FMath::CeilToInt(Max.Y - 0.5f), Height);
+    for (int Y = Y0; Y < Y1; ++Y) {
+        for (int X = X0; X < X1; ++X)
+            Pixels[Y * Width + X] = Color;
+    }
+}
+
+void DropImage::ToColors(TArray<FColor>& OutColors) const
+{
+    OutColors.SetNumUninitialized(Pixels.Num(), false);
+    for (int i = 0; i < Pixels.Num(); ++i)
+        OutColors[i] = Pixels[i].ToFColor(true);
+}
+
+static FORCEINLINE VectorRegister VectorLerp(const VectorRegister& A, const VectorRegister& B, const VectorRegister& Alpha)
+{
+    return VectorMultiplyAdd(VectorSubtract(B, A), Alpha, A);
+}
+
+static void SplatDropQuad(
+    const DropQuad& Quad, const DropImage& Sprite, DropImage& Target, TArray<DropSplatColumn>& Columns
+)
+{
+    // Pixels whose centre is inside the quad, as the rasterizer covers them
+    FVector2D Max = Quad.Position + Quad.Size;
+    int X0 = FMath::Max(FMath::CeilToInt(Quad.Position.X - 0.5f), 0);
+    int Y0 = FMath::Max(FMath::CeilToInt(Quad.Position.Y - 0.5f), 0);
+    int X1 = FMath::Min(FMath::CeilToInt(Max.X - 0.5f), Target.Width);
+    int Y1 = FMath::Min(FMath::CeilToInt(Max.Y - 0.5f), Target.Height);
+    if (X0 >= X1 || Y0 >= Y1)
+        return;
+
+    // Texel coordinates of the pixel centres, with texel centres at .5 like the sampler
+    FVector2D SpriteSize((float)Sprite.Width, (float)Sprite.Height);
+    FVector2D TexelsPerPixel = (Quad.UVMax - Quad.UVMin) / Quad.Size * SpriteSize;
+    FVector2D FirstTexel = Quad.UVMin * SpriteSize - FVector2D(0.5f, 0.5f)
+        + (FVector2D(X0 + 0.5f, Y0 + 0.5f) - Quad.Position) * TexelsPerPixel;
+    float MaxTexelX = Sprite.Width - 1.0f;
+    float MaxTexelY = Sprite.Height - 1.0f;
+
+    Columns.SetNumUninitialized(X1 - X0, false);
+    for (int X = X0; X < X1; ++X) {
+        float TexelX = FMath::Clamp(FirstTexel.X + (X - X0) * TexelsPerPixel.X, 0.0f, MaxTexelX);
+        DropSplatColumn& Column = Columns[X - X0];
+        Column.Column = (int)TexelX;
+        Column.NextColumn = FMath::Min(Column.Column + 1, Sprite.Width - 1);
+        Column.Fraction = TexelX - Column.Column;
+    }
+
+    const VectorRegister One = VectorOne();
+    const FLinearColor* SpritePixels = Sprite.Pixels.GetData();
+    for (int Y = Y0; Y < Y1; ++Y) {
+        float TexelY = FMath::Clamp(FirstTexel.Y + (Y - Y0) * TexelsPerPixel.Y, 0.0f, MaxTexelY);
+        int Row = (int)TexelY;
+        const FLinearColor* Upper = SpritePixels + Row * Sprite.Width;
+        const FLinearColor* Lower = SpritePixels + FMath::Min(Row + 1, Sprite.Height - 1) * Sprite.Width;
+        const VectorRegister FractionY = VectorSetFloat1(TexelY - Row);
+        FLinearColor* Dest = Target.Pixels.GetData() + Y * Target.Width + X0;
+
+        for (int i = 0; i < Columns.Num(); ++i) {
+            const DropSplatColumn& Column = Columns[i];
+            const VectorRegister FractionX = VectorLoadFloat1(&Column.Fraction);
+            VectorRegister Source = VectorLerp(
+                VectorLerp(VectorLoad(&Upper[Column.Column]), VectorLoad(&Upper[Column.NextColumn]), FractionX),
+                VectorLerp(VectorLoad(&Lower[Column.Column]), VectorLoad(&Lower[Column.NextColumn]), FractionX),
+                FractionY
+            );
+            VectorRegister Transmittance = VectorSubtract(One, VectorReplicate(Source, 3));
+            VectorStore(VectorMultiplyAdd(VectorLoad(&Dest[i]), Transmittance, Source), &Dest[i]);
+        }
+    }
+}
+
+// In order, so overlapping drops stack like they do on the canvas.
+void SplatDropQuads(
+    const TArray<DropQuad>& Quads, const DropImage& Sprite, DropImage& Target, TArray<DropSplatColumn>& Columns
+)
+{
+    if (Sprite.Width == 0 || Sprite.Height == 0)
+        return;
+    for (const DropQuad& Quad : Quads)
+        SplatDropQuad(Quad, Sprite, Target, Columns);
+}
+
+bool ReadDropSprite(UTexture* Texture, DropImage& OutSprite)
+{
+#if WITH_EDITORONLY_DATA
+    if (!Texture || !Texture->Source.IsValid() || Texture->Source.GetFormat() != TSF_BGRA8)
+        return false;
+
+    TArray64<uint8> Data;
+    if (!Texture->Source.GetMipData(Data, 0))
+        return false;
+
+    OutSprite.Init(Texture->Source.GetSizeX(), Texture->Source.GetSizeY(), FLinearColor::Transparent);
+    const FColor* Colors = reinterpret_cast<const FColor*>(Data.GetData());
+    for (int i = 0; i < OutSprite.Pixels.Num(); ++i) {
+        // What the sampler returns, decoded from sRGB if the texture is
+        OutSprite.Pixels[i] = Texture->SRGB ? FLinearColor(Colors[i]) : Colors[i].ReinterpretAsLinear();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MakeRoundDropSprite(int Size, DropImage& OutSprite)
+{
+    OutSprite.Init(Size, Size, FLinearColor::Transparent);
+    float Radius = Size * 0.5f;
+    for (int Y = 0; Y < Size; ++Y) {
+        for (int X = 0; X < Size; ++X) {
+            float Distance = FVector2D::Distance(FVector2D(X + 0.5f, Y + 0.5f), FVector2D(Radius, Radius)) / Radius;
+            float Alpha = FMath::Clamp((1.0f - Distance) / kRoundSpriteRim, 0.0f, 1.0f);
+            OutSprite.Pixels[Y * Size + X] = FLinearColor(Alpha, Alpha, Alpha, Alpha);  // Premultiplied white
+        }
+    }
+}
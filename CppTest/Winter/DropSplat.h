@@ -0,0 +1,37 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include "DropSystem.h"
+
+
+/*
+* Software renderer of the drops, for machines without a GPU: golden images, offline frame
+* export, or one texture upload instead of canvas calls.
+*
+* It splats the same `DropQuad`s DropSystem::Draw gathers, with the same blending as the
+* canvas: the sprite is sampled bilinearly at the pixel centres with clamped addressing,
+* and composited with SE_BLEND_AlphaComposite, Dest = Src + Dest * (1 - Src.A).
+* One pixel is one vector register, so sampling and blending are four lanes wide.
+*/
+struct DropImage
+{
+    int Width = 0;
+    int Height = 0;
+    TArray<FLinearColor> Pixels;    // Row major, linear like a float render target
+
+    void Init(int InWidth, int InHeight, const FLinearColor& Color);
+    void Clear(const FLinearColor& Color);
+    void ClearRect(const FVector2D& Min, const FVector2D& Max, const FLinearColor& Color);
+    void ToColors(TArray<FColor>& OutColors) const;     // sRGB, for upload or export
+};
+
+// `Columns` is scratch, kept by the caller so a steady draw does not allocate.
+void SplatDropQuads(
+    const TArray<DropQuad>& Quads, const DropImage& Sprite, DropImage& Target, TArray<DropSplatColumn>& Columns
+);
+
+// Copies mip 0 of an uncompressed BGRA8 texture, false when its source is not available.
+bool ReadDropSprite(UTexture* Texture, DropImage& OutSprite);
+
+// Round sprite with a soft rim, a stand-in for T_Raindrop where its source is not available.
+void MakeRoundDropSprite(int Size, DropImage& OutSprite);
@@ -0,0 +1,31 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include <Stats/Stats.h>
+#include <ProfilingDebugging/CpuProfilerTrace.h>
+#include <ProfilingDebugging/CsvProfiler.h>
+
+
+/*
+* Everything the drops count and time goes into `stat Drops`, into the `Drops` category
+* of the CSV profiler, and, for the scopes, into the CPU track of Unreal Insights.
+* On a build agent, `-nullrhi -csvCaptureFrames=<N>` writes one CSV row per frame to
+* Saved/Profiling/CSV, and `-trace=cpu` records the scopes for Insights.
+*/
+DECLARE_STATS_GROUP(TEXT("Drops"), STATGROUP_Drops, STATCAT_Advanced);
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(CPPTEST_API, Drops);
+
+// Times the rest of the block as cycle stat `STAT_<Name>` and as Insights event `<Name>`
+#define DROP_SCOPE(Name) \
+    SCOPE_CYCLE_COUNTER(STAT_##Name); \
+    TRACE_CPUPROFILER_EVENT_SCOPE(Name)
+
+// Sets a counter that holds a current amount, e.g. drops alive
+#define SET_DROP_STAT(Name, Value) \
+    SET_DWORD_STAT(STAT_##Name, Value); \
+    CSV_CUSTOM_STAT(Drops, Name, (int32)(Value), ECsvCustomStatOp::Set)
+
+// Adds to a counter of events this frame, e.g. drops killed, also over several ticks
+#define INC_DROP_STAT(Name, Amount) \
+    INC_DWORD_STAT_BY(STAT_##Name, Amount); \
+    CSV_CUSTOM_STAT(Drops, Name, (int32)(Amount), ECsvCustomStatOp::Accumulate)
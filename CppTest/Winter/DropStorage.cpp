@@ -0,0 +1,268 @@
+#include "DropStorage.h"
+#include "Common.h"
+
+
+static int MakeID(int Slot, int Generation)
+{
+    return (Generation << kDropSlotBits) | Slot;
+}
+
+// Like assigning, but only reallocates when the column grows.
+template<class ElementType>
+static void CopyColumn(TArray<ElementType>& To, const TArray<ElementType>& From)
+{
+    To.SetNumUninitialized(From.Num(), false);
+    FMemory::Memcpy(To.GetData(), From.GetData(), From.Num() * sizeof(ElementType));
+}
+
+
+int DropStorage::Add(const Drop& NewDrop)
+{
+    if (Num() == IDs.Max()) {
+        Reserve(Num() + FMath::Max(kDropSlabSize, Num() / 2));
+        m_NumGrowths++;
+    }
+
+    int Slot;
+    if (m_FreeSlots.Num()) {
+        m_FreeSlots.HeapPop(Slot, false);
+        m_NumRecycled++;
+    }
+    else {
+        Slot = m_SlotIndices.Add(INDEX_NONE);
+        m_SlotGenerations.Add(0);
+        check(Slot <= kDropSlotMask);
+    }
+
+    int ID = MakeID(Slot, m_SlotGenerations[Slot]);
+    m_SlotIndices[Slot] = IDs.Add(ID);
+
+    PositionX.Add(NewDrop.Position.X);
+    PositionY.Add(NewDrop.Position.Y);
+    PrevPositionX.Add(NewDrop.Position.X);
+    PrevPositionY.Add(NewDrop.Position.Y);
+    VelocityX.Add(NewDrop.Velocity.X);
+    VelocityY.Add(NewDrop.Velocity.Y);
+    Stretch.Add(NewDrop.Stretch);
+    Radius.Add(NewDrop.Radius);
+    BirthTimeSeconds.Add(NewDrop.BirthTimeSeconds);
+    DistanceNoTrail.Add(NewDrop.DistanceNoTrail);
+    NextTrailDistance.Add(NewDrop.NextTrailDistance);
+    Flags.Add(0);
+
+    Wake(Num() - 1);
+    m_NumPeak = FMath::Max(m_NumPeak, Num());
+    return ID;
+}
+
+void DropStorage::Remove(int ID)
+{
+    int Index = IndexOf(ID);
+    check(Index != INDEX_NONE);
+    RemoveAt(Index);
+}
+
+void DropStorage::RemoveAt(int Index)
+{
+    int Slot = GetDropSlot(IDs[Index]);
+    m_SlotIndices[Slot] = INDEX_NONE;
+    m_SlotGenerations[Slot] = (m_SlotGenerations[Slot] + 1) & kDropGenerationMask;
+    m_FreeSlots.HeapPush(Slot);
+
+    // Keep the awake rows in front: the last awake row fills the hole, the last row its place
+    if (Index < m_NumAwake) {
+        m_NumAwake--;
+        if (Index != m_NumAwake) {
+            CopyRow(m_NumAwake, Index);
+            m_SlotIndices[GetDropSlot(IDs[Index])] = Index;
+        }
+        Index = m_NumAwake;
+    }
+
+    int Last = Num() - 1;
+    if (Index != Last) {
+        CopyRow(Last, Index);
+        m_SlotIndices[GetDropSlot(IDs[Index])] = Index;
+    }
+    PopRow();
+}
+
+void DropStorage::Empty()
+{
+    IDs.Empty();
+    PositionX.Empty();
+    PositionY.Empty();
+    PrevPositionX.Empty();
+    PrevPositionY.Empty();
+    VelocityX.Empty();
+    VelocityY.Empty();
+    Stretch.Empty();
+    Radius.Empty();
+    BirthTimeSeconds.Empty();
+    DistanceNoTrail.Empty();
+    NextTrailDistance.Empty();
+    Flags.Empty();
+
+    m_SlotIndices.Empty();
+    m_SlotGenerations.Empty();
+    m_FreeSlots.Empty();
+    m_NumAwake = 0;
+}
+
+/*
+* Makes this an exact copy of `Other`, IDs included. Meant for snapshots taken every
+* frame, which reuse their columns instead of reallocating them.
+*/
+void DropStorage::CopyFrom(const DropStorage& Other)
+{
+    CopyColumn(IDs, Other.IDs);
+    CopyColumn(PositionX, Other.PositionX);
+    CopyColumn(PositionY, Other.PositionY);
+    CopyColumn(PrevPositionX, Other.PrevPositionX);
+    CopyColumn(PrevPositionY, Other.PrevPositionY);
+    CopyColumn(VelocityX, Other.VelocityX);
+    CopyColumn(VelocityY, Other.VelocityY);
+    CopyColumn(Stretch, Other.Stretch);
+    CopyColumn(Radius, Other.Radius);
+    CopyColumn(BirthTimeSeconds, Other.BirthTimeSeconds);
+    CopyColumn(DistanceNoTrail, Other.DistanceNoTrail);
+    CopyColumn(NextTrailDistance, Other.NextTrailDistance);
+    CopyColumn(Flags, Other.Flags);
+
+    CopyColumn(m_SlotIndices, Other.m_SlotIndices);
+    CopyColumn(m_SlotGenerations, Other.m_SlotGenerations);
+    CopyColumn(m_FreeSlots, Other.m_FreeSlots);
+    m_NumAwake = Other.m_NumAwake;
+    m_NumPeak = Other.m_NumPeak;
+    m_NumRecycled = Other.m_NumRecycled;
+    m_NumGrowths = Other.m_NumGrowths;
+}
+
+void DropStorage::Reserve(int Capacity)
+{
+    IDs.Reserve(Capacity);
+    PositionX.Reserve(Capacity);
+    PositionY.Reserve(Capacity);
+    PrevPositionX.Reserve(Capacity);
+    PrevPositionY.Reserve(Capacity);
+    VelocityX.Reserve(Capacity);
+    VelocityY.Reserve(Capacity);
+    Stretch.Reserve(Capacity);
+    Radius.Reserve(Capacity);
+    BirthTimeSeconds.Reserve(Capacity);
+    DistanceNoTrail.Reserve(Capacity);
+    NextTrailDistance.Reserve(Capacity);
+    Flags.Reserve(Capacity);
+
+    m_SlotIndices.Reserve(Capacity);
+    m_SlotGenerations.Reserve(Capacity);
+    m_FreeSlots.Reserve(Capacity);
+}
+
+void DropStorage::Wake(int Index)
+{
+    if (Index < m_NumAwake)
+        return;
+    SwapRows(Index, m_NumAwake);
+    m_NumAwake++;
+}
+
+void DropStorage::Sleep(int Index)
+{
+    check(Index < m_NumAwake);
+    m_NumAwake--;
+    SwapRows(Index, m_NumAwake);
+}
+
+void DropStorage::WakeAll()
+{
+    m_NumAwake = Num();
+}
+
+int DropStorage::IndexOf(int ID) const
+{
+    int Slot = GetDropSlot(ID);
+    if (ID < 0 || Slot >= m_SlotIndices.Num())
+        return INDEX_NONE;
+    if (MakeID(Slot, m_SlotGenerations[Slot]) != ID)
+        return INDEX_NONE;
+    return m_SlotIndices[Slot];
+}
+
+Drop DropStorage::Get(int Index) const
+{
+    Drop Result(
+        GetPosition(Index), GetVelocity(Index), Stretch[Index],
+        Radius[Index], BirthTimeSeconds[Index]
+    );
+    Result.DistanceNoTrail = DistanceNoTrail[Index];
+    Result.NextTrailDistance = NextTrailDistance[Index];
+    return Result;
+}
+
+DropPoolStats DropStorage::GetPoolStats() const
+{
+    DropPoolStats Stats;
+    Stats.NumLive = Num();
+    Stats.NumPeak = m_NumPeak;
+    Stats.NumRecycled = m_NumRecycled;
+    Stats.NumGrowths = m_NumGrowths;
+    return Stats;
+}
+
+void DropStorage::CopyRow(int From, int To)
+{
+    IDs[To] = IDs[From];
+    PositionX[To] = PositionX[From];
+    PositionY[To] = PositionY[From];
+    PrevPositionX[To] = PrevPositionX[From];
+    PrevPositionY[To] = PrevPositionY[From];
+    VelocityX[To] = VelocityX[From];
+    VelocityY[To] = VelocityY[From];
+    Stretch[To] = Stretch[From];
+    Radius[To] = Radius[From];
+    BirthTimeSeconds[To] = BirthTimeSeconds[From];
+    DistanceNoTrail[To] = DistanceNoTrail[From];
+    NextTrailDistance[To] = NextTrailDistance[From];
+    Flags[To] = Flags[From];
+}
+
+void DropStorage::SwapRows(int A, int B)
+{
+    if (A == B)
+        return;
+
+    Swap(IDs[A], IDs[B]);
+    Swap(PositionX[A], PositionX[B]);
+    Swap(PositionY[A], PositionY[B]);
+    Swap(PrevPositionX[A], PrevPositionX[B]);
+    Swap(PrevPositionY[A], PrevPositionY[B]);
+    Swap(VelocityX[A], VelocityX[B]);
+    Swap(VelocityY[A], VelocityY[B]);
+    Swap(Stretch[A], Stretch[B]);
+    Swap(Radius[A], Radius[B]);
+    Swap(BirthTimeSeconds[A], BirthTimeSeconds[B]);
+    Swap(DistanceNoTrail[A], DistanceNoTrail[B]);
+    Swap(NextTrailDistance[A], NextTrailDistance[B]);
+    Swap(Flags[A], Flags[B]);
+
+    m_SlotIndices[GetDropSlot(IDs[A])] = A;
+    m_SlotIndices[GetDropSlot(IDs[B])] = B;
+}
+
+void DropStorage::PopRow()
+{
+    IDs.Pop(false);
+    PositionX.Pop(false);
+    PositionY.Pop(false);
+    PrevPositionX.Pop(false);
+    PrevPositionY.Pop(false);
+    VelocityX.Pop(false);
+    VelocityY.Pop(false);
+    Stretch.Pop(false);
+    Radius.Pop(false);
+    BirthTimeSeconds.Pop(false);
+    DistanceNoTrail.Pop(false);
+    NextTrailDistance.Pop(false);
+    Flags.Pop(false);
+}
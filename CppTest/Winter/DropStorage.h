@@ -0,0 +1,138 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include "Drop.h"
+#include "DropRandom.h"
+
+const int kDropSlotBits = 20;       // Up to 1M drops alive at the same time
+const int kDropSlotMask = (1 << kDropSlotBits) - 1;
+const int kDropGenerationMask = (1 << (31 - kDropSlotBits)) - 1;
+const int kDropSlabSize = 1024;     // Columns grow by at least this many drops
+
+// Slot of an ID, stays the same for the drop's life and is reused after it.
+inline int GetDropSlot(int ID)
+{
+    return ID & kDropSlotMask;
+}
+
+// Bits of DropStorage::Flags, they move with their row so they survive removals.
+const uint8 kDropFlagMoved = 1 << 0;        // Moved in the last tick
+const uint8 kDropFlagOverlapped = 1 << 1;   // Overlaps a moved drop, only valid while processing overlaps
+const uint8 kDropFlagUnclipped = 1 << 2;    // Emitted after the last clip, must not sleep before it
+const uint8 kDropFlagTrail = 1 << 3;        // Split off a moving drop, kept for life
+
+
+struct DropPoolStats
+{
+    int NumLive = 0;
+    int NumPeak = 0;        // Most drops alive at the same time
+    int NumRecycled = 0;    // Drops emitted into the slot of a killed one
+    int NumGrowths = 0;     // Times the columns had to be reallocated
+};
+
+
+/*
+* Drops kept as a structure of arrays, so each stage of the simulation is a linear sweep
+* over a few dense columns instead of a pointer chase through a map.
+*
+* Rows are addressed by generational handles, which are the drop IDs handed out to the
+* rest of the game: the low `kDropSlotBits` bits select a slot, the high bits hold the
+* generation of that slot. Killing a drop bumps the generation, so a stale ID never
+* resolves to a drop emitted later into the same slot.
+*
+* Removing a row moves the last row into its place, so dense indices are only valid until
+* the next removal. Iterate backwards when removing during a sweep.
+*
+* The storage is its own pool: killed slots go to a free list and are handed out again,
+* and the columns only grow a slab at a time, so emitting and killing is cheap and does
+* not touch the heap in a steady state. The lowest free slot is handed out first, so the
+* IDs of new drops do not depend on the order drops were killed in.
+*
+* Rows are split into awake ones in [0, NumAwake()) and sleeping ones after them. Drops
+* are emitted awake, sleeping drops are at rest and are skipped by the simulation. Waking
+* or putting a drop to sleep swaps it with the row on the border, so it moves.
+*/
+class DropStorage
+{
+public:
+    int Add(const Drop& NewDrop);
+    void Remove(int ID);
+    void RemoveAt(int Index);
+    void Empty();
+    void Reserve(int Capacity);
+    void CopyFrom(const DropStorage& Other);
+    void Wake(int Index);
+    void Sleep(int Index);
+    void WakeAll();
+
+    int Num() const { return IDs.Num(); }
+    int NumAwake() const { return m_NumAwake; }
+    int NumSlots() const { return m_SlotIndices.Num(); }
+    bool Contains(int ID) const { return IndexOf(ID) != INDEX_NONE; }
+    int IndexOf(int ID) const;
+    Drop Get(int Index) const;
+    DropPoolStats GetPoolStats() const;
+
+    FVector2D GetPosition(int Index) const {
+        return FVector2D(PositionX[Index], PositionY[Index]);
+    }
+
+    FVector2D GetPrevPosition(int Index) const {
+        return FVector2D(PrevPositionX[Index], PrevPositionY[Index]);
+    }
+
+    FVector2D GetVelocity(int Index) const {
+        return FVector2D(VelocityX[Index], VelocityY[Index]);
+    }
+
+    bool IsMoved(int Index) const {
+        return (Flags[Index] & kDropFlagMoved) != 0;
+    }
+
+    bool IsActive(int Index) const {
+        return BirthTimeSeconds[Index] >= 0.0f;
+    }
+
+    float GetMass(int Index) const {
+        return GetDropMass(Radius[Index]);
+    }
+
+    void AdjustArea(int Index, float Delta) {
+        Radius[Index] = FMath::Sqrt(Radius[Index] * Radius[Index] + Delta);
+    }
+
+    void ResetTrailDistance(int Index, uint32 RandomCounter) {
+        DistanceNoTrail[Index] = 0;
+        NextTrailDistance[Index] = DropRandomRange(IDs[Index], RandomCounter, kTrailDistanceMin, kTrailDistanceMax);
+    }
+
+    // Columns, indexed by dense index.
+    TArray<int> IDs;
+    TArray<float> PositionX;
+    TArray<float> PositionY;
+    TArray<float> PrevPositionX;    // Before the last tick, for drawing between ticks
+    TArray<float> PrevPositionY;
+    TArray<float> VelocityX;
+    TArray<float> VelocityY;
+    TArray<FVector2D> Stretch;
+    TArray<float> Radius;
+    TArray<float> BirthTimeSeconds;
+    TArray<float> DistanceNoTrail;
+    TArray<float> NextTrailDistance;
+    TArray<uint8> Flags;
+
+private:
+    friend class DropSnapshot;     // Saves and loads the private state too
+
+    void CopyRow(int From, int To);
+    void SwapRows(int A, int B);
+    void PopRow();
+
+    TArray<int> m_SlotIndices;      // Slot -> dense index, INDEX_NONE when the slot is free
+    TArray<int> m_SlotGenerations;
+    TArray<int> m_FreeSlots;        // Min heap
+    int m_NumAwake = 0;
+    int m_NumPeak = 0;
+    int m_NumRecycled = 0;
+    int m_NumGrowths = 0;
+};
@@ -1,35 +1,113 @@
 #include "DropSystem.h"
 #include "Drop.h"
+#include "DropIntegration.h"
+#include "DropCurve.h"
+#include "DropSplat.h"
+#include "DropStats.h"
 #include "Common.h"
 
 #include <utility>
+#include <algorithm>
 
 #include <Kismet/KismetRenderingLibrary.h>
 #include <Engine/Canvas.h>
+#include <CanvasItem.h>
+#include <Async/ParallelFor.h>
 
 
 PRAGMA_OPTION
 
-const float kRadiusAnimationExp = 10.0f;
+constexpr float kRadiusAnimationExp = 10.0f;
 const float kAreaLossFactor = 0.35f;     // Bigger value causes more area loss when splitting
 const float kAreaGainFactor = 0.5;      // Bigger value make drops grow faster when merging with others
 const float kVelocityLossFactor = 0.85f;
-const float kAreaIncreaseFactorMin = 0.015f;    // Bigger value increase the growing speed of marching drops.
-const float kAreaIncreaseFactorMax = 0.35f;
-const float kAreaIncreaseFactorExp = 6.0f;
 const float kStretchVelocityFactor = 0.1f;
 const float kDropShrinkingSeconds = 1.0f; // Second
+constexpr auto kRadiusAnimationCurve = MakeDropPowCurve(kRadiusAnimationExp);
+const int kSimdWidth = 4;   // Batches start at multiples of this, so every thread count integrates the same lanes
+const float kEvictionSlack = 0.05f;         // Evicts this much below the budget, so it does not evict every tick
+const float kEvictionAgeSeconds = 10.0f;    // A drop this old counts half as visible
+const float kEvictionMovedFactor = 4.0f;    // Moving drops are easier to notice than resting ones
+const float kEvictionTrailFactor = 0.5f;
+const float kTimeBudgetSmoothing = 0.1f;    // How fast the drops follow the measured tick time
+const int kMinDropBudget = 1000;            // The tick time budget never goes below this
 
+CSV_DEFINE_CATEGORY_MODULE(CPPTEST_API, Drops, true);
 
-DropSystem::DropSystem():m_World(nullptr), m_NextID(0)
+DECLARE_CYCLE_STAT(TEXT("Tick"), STAT_DropTick, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Tick - Simulate"), STAT_DropSimulate, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Tick - Clip"), STAT_DropClip, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Tick - Split trails"), STAT_DropSplitTrails, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Tick - Overlaps"), STAT_DropOverlaps, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Tick - Sleep"), STAT_DropSleep, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Tick - Evict"), STAT_DropEvict, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Kill"), STAT_DropKill, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Mark finger"), STAT_DropMarkFinger, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Draw"), STAT_DropDraw, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Draw - Gather quads"), STAT_DropGatherQuads, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Draw - Canvas"), STAT_DropCanvas, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Draw software"), STAT_DropDrawSoftware, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Draw software - Splat"), STAT_DropSplat, STATGROUP_Drops);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Drops"), STAT_NumDrops, STATGROUP_Drops);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active drops"), STAT_NumActive, STATGROUP_Drops);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Sleeping drops"), STAT_NumSleeping, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Simulated drops"), STAT_NumSimulated, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Moved drops"), STAT_NumMoved, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Overlap pairs tested"), STAT_NumPairsTested, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Overlap pairs found"), STAT_NumPairsFound, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Merged drops"), STAT_NumMerged, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trail splits"), STAT_NumSplits, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Killed drops"), STAT_NumKilled, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evicted drops"), STAT_NumEvicted, STATGROUP_Drops);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Drop budget"), STAT_DropBudget, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Canvas draw items"), STAT_NumDrawItems, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dirty tiles"), STAT_NumDirtyTiles, STATGROUP_Drops);
+
+
+DropSystem::DropSystem():m_World(nullptr)
 {
 }
 
 DropSystem::~DropSystem()
 {
-    for (auto& CurrentDrop : m_Drops) {
-        delete CurrentDrop.Value;
-    }
+}
+
+/*
+* Splits [0, Num) into at most one batch per worker thread and runs `Body` on them in
+* parallel. The split only decides who computes what, so bodies that only write their own
+* rows give the same result for any number of threads.
+*/
+void DropSystem::ParallelForBatches(int Num, TFunctionRef<void(int Begin, int End)> Body) const
+{
+    int NumThreads = m_NumWorkerThreads > 0 ?
+        m_NumWorkerThreads : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+    int NumBatches = FMath::Clamp(Num / FMath::Max(m_MinBatchSize, 1), 1, NumThreads);
+    int BatchSize = Align(FMath::DivideAndRoundUp(Num, NumBatches), kSimdWidth);
+
+    ParallelFor(NumBatches, [&](int Batch) {
+        int Begin = Batch * BatchSize;
+        int End = FMath::Min(Begin + BatchSize, Num);
+        if (Begin < End)
+            Body(Begin, End);
+    }, NumBatches == 1);
+}
+
+int DropSystem::AddDrop(const Drop& NewDrop)
+{
+    int ID = m_Drops.Add(NewDrop);
+    int Index = m_Drops.IndexOf(ID);
+    m_Drops.Flags[Index] = kDropFlagUnclipped;     // Cleared by the next Simulate, right before Clip
+    m_Drops.ResetTrailDistance(Index, GetDropRandomCounter(m_RandomSeed, m_RandomCounter, EDropRandomStream::EmitDistance));
+    m_Grid.Insert(m_Drops, Index);
+    return ID;
+}
+
+const DropGrid& DropSystem::GetGrid()
+{
+    if (!m_Grid.IsValid())
+        m_Grid.Build(m_Drops);
+    return m_Grid;
 }
 
 void DropSystem::Kill(int ID)
@@ -40,316 +118,1002 @@ void DropSystem::Kill(int ID)
         );
         return;
     }
-    delete m_Drops[ID];
     m_Drops.Remove(ID);
 }
 
-TSet<int> DropSystem::Simulate(float TimeDeltaSeconds)
+void DropSystem::Simulate(float TimeDeltaSeconds)
 {
-    Drop* CurrentDropPtr;
-    float ForceDownward;
-    float Friction;
-    float AreaGrowed;
-    float MarchedDistance;
-    TSet<int> MovedIDs;
-    FVector2D MoveVector;
-    for (auto& Iter : m_Drops)
-    {
-        CurrentDropPtr = Iter.Value;
 
-        // Calc Force
-        Friction = CurrentDropPtr->Velocity.Y > 0 ? m_DynamicFriction : m_StaticFriction;
-        ForceDownward = CurrentDropPtr->GetMass() * m_Gravity - Friction;
+    DropIntegrationParams Params;
+    Params.DeltaSeconds = TimeDeltaSeconds;
+    Params.Gravity = m_Gravity;
+    Params.StaticFriction = m_StaticFriction;
+    Params.DynamicFriction = m_DynamicFriction;
+    Params.VelocityScale = m_VelocityScale;
+    Params.RandomCounter = GetDropRandomCounter(m_RandomSeed, m_RandomCounter, EDropRandomStream::Growth);
+    ParallelForBatches(m_Drops.NumAwake(), [&](int Begin, int End) {
+        for (int i = Begin; i < End; ++i) {
+            m_Drops.PrevPositionX[i] = m_Drops.PositionX[i];
+            m_Drops.PrevPositionY[i] = m_Drops.PositionY[i];
+        }
 
-        // Calc Velocity
-        CurrentDropPtr->Velocity.Y += ForceDownward * TimeDeltaSeconds;
-        CurrentDropPtr->Velocity.Y = FMath::Max(CurrentDropPtr->Velocity.Y, 0.0f);
+        if (m_UseSimdIntegration)
+            IntegrateDropsSimd(m_Drops, Begin, End, Params);
+        else
+            IntegrateDropsScalar(m_Drops, Begin, End, Params);
 
-        // Calc Position
-        MoveVector = CurrentDropPtr->Velocity * TimeDeltaSeconds * m_VelocityScale;
-        CurrentDropPtr->Position += MoveVector;
-        CurrentDropPtr->DistanceNoTrail += (MarchedDistance = MoveVector.Size());
+        // Moved and trail are the only flags kept between ticks, moved is rebuilt from scratch
+        for (int i = Begin; i < End; ++i)
+            m_Drops.Flags[i] = (m_Drops.Flags[i] & kDropFlagTrail) | (m_Drops.VelocityY[i] > 0 ? kDropFlagMoved : 0);
+    });
 
-        // Increase Radius while marching downward
-        AreaGrowed = MarchedDistance * FMath::GetMappedRangeValueUnclamped(
-            FVector2D(0.0f, 1.0f), FVector2D(kAreaIncreaseFactorMin, kAreaIncreaseFactorMax),
-            FMath::Pow(FMath::RandRange(0.0f, 1.0f), kAreaIncreaseFactorExp)
-        );
-        CurrentDropPtr->AdjustArea(AreaGrowed);
+    // Drops without velocity kept their position and radius, so the grid still holds
+    for (int i = 0; i < m_Drops.NumAwake(); ++i) {
+        if (m_Drops.VelocityX[i] != 0 || m_Drops.VelocityY[i] != 0) {
+            m_Grid.Invalidate();
+            break;
+        }
+    }
+}
 
-        // Collect Moved
-        if (CurrentDropPtr->Velocity.Y > 0)
-            MovedIDs.Add(Iter.Key);
+/*
+* Moved drops are all awake. They are sorted by ID, so the trail drops are emitted in an
+* order that does not depend on where sleeping and waking moved the rows.
+*/
+void DropSystem::CollectMovedIndices()
+{
+    m_MovedIndices.Reset();
+    for (int i = 0; i < m_Drops.NumAwake(); ++i) {
+        if (m_Drops.IsMoved(i))
+            m_MovedIndices.Add(i);
     }
-    return MoveTemp(MovedIDs);
+    m_MovedIndices.Sort([this](int A, int B) {
+        return m_Drops.IDs[A] < m_Drops.IDs[B];
+    });
 }
 
 void DropSystem::Kill(const FVector2D& Center, float Radius)
 {
-    // Store keys before hands to avoid removal during iteration
-    TArray<int> IDs;
-    m_Drops.GetKeys(IDs);
+    Kill(Center, Center, Radius, Radius);
+}
 
-    Drop* CurrentDrop;
-    float Distance, Threshold;
-    for (auto& ID : IDs)
-    {
-        CurrentDrop = m_Drops[ID];
-        if (!CurrentDrop->IsActive())
-            continue;
+/*
+* Kills the active drops a finger moving from Start to End touches. With NumSteps it kills only
+* what NumSteps + 1 circles evenly spaced from Start to End touch, the stamps of a brush, as if
+* each was killed on its own, still with a single query.
+*/
+void DropSystem::Kill(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius, int NumSteps)
+{
+    DROP_SCOPE(DropKill);
+    FVector2D Segment = End - Start;
+    float LengthSquared = Segment.SizeSquared();
+    float InvLengthSquared = LengthSquared > SMALL_NUMBER ? 1.0f / LengthSquared : 0.0f;
 
-        Distance = (Center - CurrentDrop->Position).Size();
-        Threshold = Radius + CurrentDrop->Radius;
-        if (Distance > Threshold)
-            continue;
-        Kill(ID);
-    }
+    // Collect first, the grid must not change while visiting it
+    m_KilledIDs.Reset();
+    ForEachInCapsule(Start, End, StartRadius, EndRadius, [&](int i, float Distance, float Threshold) {
+        if (!m_Drops.IsActive(i) || Distance > Threshold)
+            return;
+        if (NumSteps <= 0) {
+            m_KilledIDs.Add(m_Drops.IDs[i]);
+            return;
+        }
+
+        // The stamps around the closest point on the segment are the closest ones
+        FVector2D Position = m_Drops.GetPosition(i);
+        float T = FVector2D::DotProduct(Position - Start, Segment) * InvLengthSquared;
+        int Nearest = FMath::Clamp(FMath::RoundToInt(T * NumSteps), 0, NumSteps);
+        for (int Step = FMath::Max(Nearest - 1, 0); Step <= FMath::Min(Nearest + 1, NumSteps); ++Step) {
+            float Alpha = (float)Step / NumSteps;
+            float StampRadius = FMath::Lerp(StartRadius, EndRadius, Alpha);
+            if ((FMath::Lerp(Start, End, Alpha) - Position).Size() <= StampRadius + m_Drops.Radius[i]) {
+                m_KilledIDs.Add(m_Drops.IDs[i]);
+                return;
+            }
+        }
+    });
+
+    for (auto ID : m_KilledIDs)
+        m_Drops.Remove(ID);
+    m_NumKilled += m_KilledIDs.Num();
 }
 
-void DropSystem::SplitTrailDrops(float DeltaSeconds, const TSet<int>& MovedIDs)
+void DropSystem::SplitTrailDrops(float DeltaSeconds)
 {
-    Drop* CurrentDropPtr;
-    float Speed;
-    FVector2D Position;
-    for (auto ID : MovedIDs) {
-        CurrentDropPtr = m_Drops[ID];
-        Speed = CurrentDropPtr->Velocity.Size() * m_VelocityScale;
-        if (Speed < m_SplitTrailVelocityThreshold)
-            continue;
-        if (!CurrentDropPtr->IsActive())
-            continue;
+    CollectMovedIndices();
+    m_TrailSplits.SetNumUninitialized(m_MovedIndices.Num(), false);
 
-        if (CurrentDropPtr->DistanceNoTrail < CurrentDropPtr->NextTrailDistance)
-            continue;
+    // Each moved drop only changes itself, the new trail drops are emitted afterwards in order
+    uint32 DistanceCounter = GetDropRandomCounter(m_RandomSeed, m_RandomCounter, EDropRandomStream::TrailDistance);
+    uint32 RadiusCounter = GetDropRandomCounter(m_RandomSeed, m_RandomCounter, EDropRandomStream::TrailRadius);
+    uint32 OffsetCounter = GetDropRandomCounter(m_RandomSeed, m_RandomCounter, EDropRandomStream::TrailOffset);
+    ParallelForBatches(m_MovedIndices.Num(), [&](int Begin, int End) {
+        int Index;
+        float Speed;
+        for (int k = Begin; k < End; ++k) {
+            TrailSplit& Split = m_TrailSplits[k];
+            Split.IsSplit = false;
+
+            Index = m_MovedIndices[k];
+            Speed = m_Drops.GetVelocity(Index).Size() * m_VelocityScale;
+            if (Speed < m_SplitTrailVelocityThreshold)
+                continue;
+            if (!m_Drops.IsActive(Index))
+                continue;
+
+            if (m_Drops.DistanceNoTrail[Index] < m_Drops.NextTrailDistance[Index])
+                continue;
+
+            m_Drops.ResetTrailDistance(Index, DistanceCounter);
 
-        CurrentDropPtr->ResetTrailDistance();
+            int ID = m_Drops.IDs[Index];
+            Split.IsSplit = true;
+            Split.Radius = m_Drops.Radius[Index] * DropRandomRange(ID, RadiusCounter, 0.3f, 0.5f);
+            Split.Position = m_Drops.GetPosition(Index) + FVector2D(
+                DropRandomRange(ID, OffsetCounter, -0.2f, 0.2f), -0.4
+            ) * m_Drops.Radius[Index];
+            Split.Stretch = FVector2D::UnitVector + FVector2D(0.2, m_Drops.VelocityY[Index] * kStretchVelocityFactor);
 
-        float Radius = CurrentDropPtr->Radius * FMath::RandRange(0.3f, 0.5f);
-        Position = CurrentDropPtr->Position + FVector2D(
-            FMath::RandRange(-0.2f, 0.2f), -0.4 
-        ) * CurrentDropPtr->Radius;
-        Emit(
-            Position,
+            // Make area conservative
+            m_Drops.AdjustArea(Index, - Split.Radius * Split.Radius * kAreaLossFactor);
+            m_Drops.VelocityX[Index] *= kVelocityLossFactor;
+            m_Drops.VelocityY[Index] *= kVelocityLossFactor;
+        }
+    });
+
+    m_TickStats.NumSplits = 0;
+    for (const TrailSplit& Split : m_TrailSplits) {
+        if (!Split.IsSplit)
+            continue;
+        m_TickStats.NumSplits++;
+        int ID = Emit(
+            Split.Position,
             FVector2D(0.0, 0.0),
-            FVector2D::UnitVector + FVector2D(0.2, CurrentDropPtr->Velocity.Y * kStretchVelocityFactor),
-            Radius,
+            Split.Stretch,
+            Split.Radius,
             kBirthTimeOutsideOfFinger
         );
+        int Index = m_Drops.IndexOf(ID);
+        m_Drops.ResetTrailDistance(Index, DistanceCounter);
+        m_Drops.Flags[Index] |= kDropFlagTrail;
+    }
+}
 
-        // Make area conservative
-        CurrentDropPtr->AdjustArea(- Radius * Radius * kAreaLossFactor);
-        CurrentDropPtr->Velocity *= kVelocityLossFactor;
+/*
+* Advances the simulation by a frame of `DeltaSeconds`. With a fixed step, runs as many
+* whole steps as the accumulated time holds, at most `m_MaxSubSteps`, and Draw shows the
+* remainder by interpolating between the last two steps.
+* @return - Ticks run.
+*/
+int DropSystem::Advance(float DeltaSeconds, const FVector2D& ClipSize)
+{
+    if (m_FixedStepSeconds <= 0.0f) {
+        m_StepAccumulatorSeconds = 0.0f;
+        m_InterpolationAlpha = 1.0f;
+        Tick(DeltaSeconds, ClipSize);
+        return 1;
     }
+
+    m_StepAccumulatorSeconds += DeltaSeconds;
+    int NumSteps = 0;
+    while (m_StepAccumulatorSeconds >= m_FixedStepSeconds && NumSteps < m_MaxSubSteps) {
+        Tick(m_FixedStepSeconds, ClipSize);
+        m_StepAccumulatorSeconds -= m_FixedStepSeconds;
+        NumSteps++;
+    }
+
+    // Give up on the steps the cap left behind, catching up would only make the next frame longer
+    if (m_StepAccumulatorSeconds >= m_FixedStepSeconds)
+        m_StepAccumulatorSeconds = FMath::Fmod(m_StepAccumulatorSeconds, m_FixedStepSeconds);
+    m_InterpolationAlpha = m_StepAccumulatorSeconds / m_FixedStepSeconds;
+    return NumSteps;
 }
 
-TSet<int> DropSystem::Tick(float DeltaSeconds, const FVector2D& ClipSize)
+void DropSystem::Tick(float DeltaSeconds, const FVector2D& ClipSize)
 {
-    TSet<int> MovedIDs = Simulate(DeltaSeconds);
-    MovedIDs = Clip(ClipSize, MovedIDs);
-    SplitTrailDrops(DeltaSeconds, MovedIDs);
-    ProcessOverlaps(MovedIDs);
-    return MovedIDs;
+    DROP_SCOPE(DropTick);
+    m_TimeSeconds += DeltaSeconds;
+    m_LastDeltaSeconds = DeltaSeconds;
+    m_TickStats.NumDrops = m_Drops.Num();
+    m_TickStats.NumKilled = m_NumKilled;
+    m_NumKilled = 0;
+
+    // Sleeping drops were found at rest and inside with these, they may not be any more
+    if (!m_UseSleeping ||
+        m_Gravity != m_SleepGravity || m_StaticFriction != m_SleepStaticFriction || ClipSize != m_SleepClipSize) {
+        m_Drops.WakeAll();
+        m_SleepGravity = m_Gravity;
+        m_SleepStaticFriction = m_StaticFriction;
+        m_SleepClipSize = ClipSize;
+    }
+
+    // Before simulating, so the drops emitted since the last tick do not cost anything first
+    double EvictStartSeconds = FPlatformTime::Seconds();
+    m_TickStats.DropBudget = GetDropBudget();
+    m_TickStats.NumEvicted = 0;
+    if (m_TickStats.DropBudget > 0 && m_Drops.Num() > m_TickStats.DropBudget) {
+        DROP_SCOPE(DropEvict);
+        EvictDrops(m_TickStats.DropBudget);
+    }
+    m_TickStats.NumSimulated = m_Drops.NumAwake();
+
+    double StartSeconds = FPlatformTime::Seconds();
+    {
+        DROP_SCOPE(DropSimulate);
+        Simulate(DeltaSeconds);
+    }
+    double SimulatedSeconds = FPlatformTime::Seconds();
+    {
+        DROP_SCOPE(DropClip);
+        Clip(ClipSize);
+    }
+    double ClippedSeconds = FPlatformTime::Seconds();
+    {
+        DROP_SCOPE(DropSplitTrails);
+        SplitTrailDrops(DeltaSeconds);
+    }
+    double SplitSeconds = FPlatformTime::Seconds();
+    m_TickStats.NumMoved = m_MovedIndices.Num();
+    {
+        DROP_SCOPE(DropOverlaps);
+        ProcessOverlaps();
+    }
+    if (m_UseSleeping) {
+        DROP_SCOPE(DropSleep);
+        SleepRestingDrops();
+    }
+    double EndSeconds = FPlatformTime::Seconds();
+
+    UpdateTimeBudget(m_TickStats.NumDrops - m_TickStats.NumEvicted, EndSeconds - EvictStartSeconds);
+
+    m_TickStats.SimulateSeconds = SimulatedSeconds - StartSeconds;
+    m_TickStats.ClipSeconds = ClippedSeconds - SimulatedSeconds;
+    m_TickStats.SplitTrailSeconds = SplitSeconds - ClippedSeconds;
+    m_TickStats.OverlapSeconds = EndSeconds - SplitSeconds;
+    m_TickStats.EvictSeconds = StartSeconds - EvictStartSeconds;
+    m_TickStats.NumSleeping = m_Drops.Num() - m_Drops.NumAwake();
+    PublishTickStats();
+
+    m_RandomCounter++;
 }
 
-/* 
-* @param OutMovedIDs - Will be iterated and changed.
+// Several ticks of a frame add up their events, the amounts are the ones after the last.
+void DropSystem::PublishTickStats() const
+{
+    SET_DROP_STAT(NumDrops, m_Drops.Num());
+    SET_DROP_STAT(NumActive, m_TickStats.NumActive);
+    SET_DROP_STAT(NumSleeping, m_TickStats.NumSleeping);
+    INC_DROP_STAT(NumSimulated, m_TickStats.NumSimulated);
+    INC_DROP_STAT(NumMoved, m_TickStats.NumMoved);
+    INC_DROP_STAT(NumPairsTested, m_TickStats.NumPairsTested);
+    INC_DROP_STAT(NumPairsFound, m_TickStats.NumPairsFound);
+    INC_DROP_STAT(NumMerged, m_TickStats.NumMerged);
+    INC_DROP_STAT(NumSplits, m_TickStats.NumSplits);
+    INC_DROP_STAT(NumKilled, m_TickStats.NumKilled);
+    INC_DROP_STAT(NumEvicted, m_TickStats.NumEvicted);
+    SET_DROP_STAT(DropBudget, m_TickStats.DropBudget);
+}
+
+/*
+* Drops allowed in this tick: `m_MaxDrops`, and as many as `m_TargetTickMilliseconds`
+* affords at the cost per drop the last ticks measured.
+* @return - The smaller of both, 0 when neither is set.
 */
-TSet<int> DropSystem::Clip(const FVector2D& Size, const TSet<int>& MovedIDs)
+int DropSystem::GetDropBudget() const
 {
-    TArray<int> IDs;
-    m_Drops.GetKeys(IDs);
+    int TimeBudget = FMath::RoundToInt(m_TimeBudgetDrops);
+    if (m_TargetTickMilliseconds <= 0.0f || TimeBudget <= 0)
+        return m_MaxDrops;
+    return m_MaxDrops > 0 ? FMath::Min(m_MaxDrops, TimeBudget) : TimeBudget;
+}
 
-    TSet<int> RemainingIDs;
-    FVector2D Position;
-    float Radius;
+// Follows the measured time slowly, one slow tick does not throw away drops.
+void DropSystem::UpdateTimeBudget(int NumTicked, double TickSeconds)
+{
+    if (m_TargetTickMilliseconds <= 0.0f) {
+        m_TimeBudgetDrops = 0.0f;
+        return;
+    }
+
+    double TickMilliseconds = FMath::Max(TickSeconds * 1000.0, 1e-3);
+    float Affordable = FMath::Max(NumTicked, kMinDropBudget) * (float)(m_TargetTickMilliseconds / TickMilliseconds);
+    m_TimeBudgetDrops = m_TimeBudgetDrops > 0.0f ?
+        FMath::Lerp(m_TimeBudgetDrops, Affordable, kTimeBudgetSmoothing) : Affordable;
+    m_TimeBudgetDrops = FMath::Clamp(m_TimeBudgetDrops, (float)kMinDropBudget, (float)kDropSlotMask);
+}
 
-    for (auto& ID : IDs)
+/*
+* Removes the least visible drops until `kEvictionSlack` below `DropBudget`. Visibility is
+* the area, weighted down for resting drops, trail drops and age. Drops under the finger
+* are not evicted, they are still being painted.
+*/
+void DropSystem::EvictDrops(int DropBudget)
+{
+    m_EvictionCandidates.Reset();
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        if (m_Drops.BirthTimeSeconds[i] == kBirthTimeNotInitialized)
+            continue;
+
+        float Visibility = m_Drops.Radius[i] * m_Drops.Radius[i];
+        if (m_Drops.IsMoved(i))
+            Visibility *= kEvictionMovedFactor;
+        if (m_Drops.Flags[i] & kDropFlagTrail)
+            Visibility *= kEvictionTrailFactor;
+        if (m_Drops.IsActive(i))
+            Visibility /= 1.0f + (m_TimeSeconds - m_Drops.BirthTimeSeconds[i]) / kEvictionAgeSeconds;
+        m_EvictionCandidates.Add(std::make_pair(Visibility, m_Drops.IDs[i]));
+    }
+
+    int NumEvicted = FMath::Min(
+        m_Drops.Num() - FMath::FloorToInt(DropBudget * (1.0f - kEvictionSlack)), m_EvictionCandidates.Num()
+    );
+    if (NumEvicted <= 0)
+        return;
+
+    // Only the least visible ones need to be in front, in no particular order. The ID breaks
+    // ties, so the same drops go whatever order the rows are in.
+    std::pair<float, int>* Candidates = m_EvictionCandidates.GetData();
+    std::nth_element(Candidates, Candidates + NumEvicted - 1, Candidates + m_EvictionCandidates.Num());
+    for (int k = 0; k < NumEvicted; ++k)
+        m_Drops.Remove(Candidates[k].second);
+    m_TickStats.NumEvicted = NumEvicted;
+}
+
+// Sleeping drops have not moved since they were clipped, only the awake ones are tested.
+void DropSystem::Clip(const FVector2D& Size)
+{
+    m_ClipFlags.SetNumUninitialized(m_Drops.NumAwake(), false);
+    ParallelForBatches(m_Drops.NumAwake(), [&](int Begin, int End) {
+        float X, Y, Radius;
+        for (int i = Begin; i < End; ++i) {
+            X = m_Drops.PositionX[i];
+            Y = m_Drops.PositionY[i];
+            Radius = m_Drops.Radius[i];
+            m_ClipFlags[i] = X + Radius < 0 || Y + Radius < 0 ||
+                X - Radius > Size.X ||
+                Y - Radius > Size.Y;
+        }
+    });
+
+    for (int i = m_Drops.NumAwake() - 1; i >= 0; --i)
     {
-        Position = m_Drops[ID]->Position;
-        Radius = m_Drops[ID]->Radius;
-        if (Position.X + Radius < 0 || Position.Y + Radius <0 ||
-            Position.X - Radius > Size.X ||
-            Position.Y - Radius > Size.Y
-            )
+        if (m_ClipFlags[i])
         {
-            Kill(ID);
-        }
-        else if (MovedIDs.Contains(ID)) {
-            RemainingIDs.Add(ID);
+            m_Drops.RemoveAt(i);
         }
     }
-    return RemainingIDs;
 }
 
-void DropSystem::ProcessOverlaps(const TSet<int>& MovedIDs)
+/*
+* Puts drops to sleep that will not move in the next tick: no velocity, and too light to
+* overcome the static friction. They stay asleep until they grow in a merge, or until the
+* gravity, friction or clip size change.
+*/
+void DropSystem::SleepRestingDrops()
 {
-    TArray<IDPair> IDPairs;
-    TArray<int> IDs;
-    m_Drops.GetKeys(IDs);
+    for (int i = m_Drops.NumAwake() - 1; i >= 0; --i) {
+        if (m_Drops.VelocityX[i] != 0 || m_Drops.VelocityY[i] != 0)
+            continue;
+        if (m_Drops.Flags[i] & kDropFlagUnclipped)
+            continue;
+        if (GetDropDownwardForce(m_Drops.Radius[i], m_Gravity, m_StaticFriction) > 0)
+            continue;
+        m_Drops.Sleep(i);
+    }
+}
+
+void DropSystem::ProcessOverlaps()
+{
+    m_OverlappedPairs.Reset();
+    FindOverlappedPairs(m_OverlappedPairs);
+    m_OverlappedPairs.Sort();   // Merged in ID order, whatever order the grid found them in
+    m_TickStats.NumPairsTested = m_NumPairsTested;
+    m_TickStats.NumPairsFound = m_OverlappedPairs.Num();
+
+    ActiveTrailDrops(m_OverlappedPairs);
+    MergeDrops(m_OverlappedPairs);
+}
+
+/*
+* Finds every overlapped pair with at least one drop flagged as moved in it.
+* Pairs of two moved drops are only reported once, with the smaller ID first.
+*/
+void DropSystem::FindOverlappedPairs(TArray<IDPair>& OutPairs)
+{
+    CollectMovedIndices();
+    m_NumPairsTested = 0;
+    if (!m_UseOverlapGrid) {
+        FindOverlappedPairsBruteForce(OutPairs);
+        return;
+    }
+
+    const DropGrid& Grid = GetGrid();
+    int i;
+    FVector2D Position, Reach;
+    float Radius;
+
+    for (auto Index : m_MovedIndices) {
+        i = m_Drops.IDs[Index];
+        Position = m_Drops.GetPosition(Index);
+        Radius = m_Drops.Radius[Index];
+        Reach = FVector2D((Radius + Grid.GetMaxRadius()) * kOverlapFactor);
+        Grid.ForEachInBox(m_Drops, Position - Reach, Position + Reach, [&](int Other) {
+            int j = m_Drops.IDs[Other];
+            if (i == j) return;
+            if (m_Drops.IsMoved(Other) && i > j) return;
+
+            m_NumPairsTested++;
+            if (AreDropsOverlapped(Position, Radius, m_Drops.GetPosition(Other), m_Drops.Radius[Other])) {
+                OutPairs.Add(std::make_pair(i, j));
+            }
+        });
+    }
+}
+
+void DropSystem::FindOverlappedPairsBruteForce(TArray<IDPair>& OutPairs)
+{
+    int i;
+    FVector2D Position;
+    float Radius;
 
-    for (auto i : MovedIDs) {
-        for (auto j : IDs) {
+    for (auto Index : m_MovedIndices) {
+        i = m_Drops.IDs[Index];
+        Position = m_Drops.GetPosition(Index);
+        Radius = m_Drops.Radius[Index];
+        for (int Other = 0; Other < m_Drops.Num(); ++Other) {
+            int j = m_Drops.IDs[Other];
             if (i == j) continue;
-            if (MovedIDs.Contains(j) && i > j) continue;
+            if (m_Drops.IsMoved(Other) && i > j) continue;
 
-            if (m_Drops[i]->AreOverlapped(m_Drops[j])) {
-                IDPairs.Add(std::make_pair(i, j));
+            m_NumPairsTested++;
+            if (AreDropsOverlapped(Position, Radius, m_Drops.GetPosition(Other), m_Drops.Radius[Other])) {
+                OutPairs.Add(std::make_pair(i, j));
             }
         }
     }
-
-    ActiveTrailDrops(IDPairs);
-    MergeDrops(IDPairs);
 }
 
 void DropSystem::ActiveTrailDrops(const TArray<IDPair>& OverlappedPairs)
 {
+    // Nothing is removed yet, so the IDs of the pairs all resolve
+    for (auto CurrentPair : OverlappedPairs) {
+        m_Drops.Flags[m_Drops.IndexOf(CurrentPair.first)] |= kDropFlagOverlapped;
+        m_Drops.Flags[m_Drops.IndexOf(CurrentPair.second)] |= kDropFlagOverlapped;
+    }
 
-    TSet<int> SeparateDrops;
-    m_Drops.GetKeys(SeparateDrops);
+    m_TickStats.NumActive = 0;
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        if (m_Drops.Flags[i] & kDropFlagOverlapped)
+            m_Drops.Flags[i] &= ~kDropFlagOverlapped;
+        else if (m_Drops.BirthTimeSeconds[i] == kBirthTimeOutsideOfFinger)
+            m_Drops.BirthTimeSeconds[i] = m_TimeSeconds;
 
-    for (auto CurrentPair : OverlappedPairs) {
-        SeparateDrops.Remove(CurrentPair.first);
-        SeparateDrops.Remove(CurrentPair.second);
+        if (m_Drops.IsActive(i))
+            m_TickStats.NumActive++;
     }
+}
 
-    for (auto ID : SeparateDrops) {
-        if (m_Drops[ID]->BirthTimeSeconds == kBirthTimeOutsideOfFinger)
-            m_Drops[ID]->BirthTimeSeconds = m_World->GetTimeSeconds();
+int DropSystem::FindMergeRoot(int Index)
+{
+    // Path halving
+    while (m_MergeNodes[Index].Parent != Index) {
+        m_MergeNodes[Index].Parent = m_MergeNodes[m_MergeNodes[Index].Parent].Parent;
+        Index = m_MergeNodes[Index].Parent;
     }
+    return Index;
 }
 
+/*
+* Collapses every cluster of overlapped active drops into its biggest drop in one pass.
+* Clusters are the connected components of the pairs, found with union-find. The survivor
+* gains `kAreaGainFactor` of the area of every other member, and the gained mass brings
+* its momentum along. Does not depend on the order of the pairs.
+*/
 void DropSystem::MergeDrops(const TArray<IDPair>& OverlappedPairs)
 {
-    for (auto CurrentPair : OverlappedPairs)
-        MergeDrop(CurrentPair.first, CurrentPair.second);
-}
+    // Nodes live at the dense index of their drop, only members are initialized
+    m_MergeNodes.SetNumUninitialized(m_Drops.Num(), false);
+    m_MergeMembers.Reset();
+    m_MergePairs.Reset();
+    for (auto CurrentPair : OverlappedPairs) {
+        int Index1 = m_Drops.IndexOf(CurrentPair.first);
+        int Index2 = m_Drops.IndexOf(CurrentPair.second);
+        if (!m_Drops.IsActive(Index1) || !m_Drops.IsActive(Index2))
+            continue;
+        m_MergePairs.Add(std::make_pair(Index1, Index2));
 
+        for (int Index : {Index1, Index2}) {
+            if (m_Drops.Flags[Index] & kDropFlagOverlapped)
+                continue;
+            m_Drops.Flags[Index] |= kDropFlagOverlapped;    // Marks it a member
+            MergeNode& Node = m_MergeNodes[Index];
+            Node.Parent = Index;
+            Node.Size = 1;
+            Node.Survivor = Index;
+            Node.AreaGain = 0.0f;
+            Node.Momentum = FVector2D::ZeroVector;
+            m_MergeMembers.Add(Index);
+        }
+    }
 
-void DropSystem::MergeDrop(int ID1, int ID2)
-{
-    if (!m_Drops.Find(ID1) || !m_Drops.Find(ID2))
-        return;
-    if (!m_Drops[ID1]->IsActive() || !m_Drops[ID2]->IsActive())
-        return;
-    if (m_Drops[ID2]->Radius > m_Drops[ID1]->Radius)
-        std::swap(ID1, ID2);
-    
-    float MassOld = m_Drops[ID1]->GetMass();
-    m_Drops[ID1]->AdjustArea(m_Drops[ID2]->Radius * m_Drops[ID2]->Radius * kAreaGainFactor);
-    m_Drops[ID1]->Velocity *= MassOld / m_Drops[ID1]->GetMass();
+    // Union by size
+    for (auto CurrentPair : m_MergePairs) {
+        int Root1 = FindMergeRoot(CurrentPair.first);
+        int Root2 = FindMergeRoot(CurrentPair.second);
+        if (Root1 == Root2)
+            continue;
+        if (m_MergeNodes[Root1].Size < m_MergeNodes[Root2].Size)
+            std::swap(Root1, Root2);
+        m_MergeNodes[Root2].Parent = Root1;
+        m_MergeNodes[Root1].Size += m_MergeNodes[Root2].Size;
+    }
+
+    // The biggest member survives, the smaller ID on a tie
+    for (int Index : m_MergeMembers) {
+        MergeNode& Root = m_MergeNodes[FindMergeRoot(Index)];
+        float Radius = m_Drops.Radius[Index];
+        float SurvivorRadius = m_Drops.Radius[Root.Survivor];
+        if (Radius > SurvivorRadius || (Radius == SurvivorRadius && m_Drops.IDs[Index] < m_Drops.IDs[Root.Survivor]))
+            Root.Survivor = Index;
+    }
+
+    m_MergeAbsorbed.Reset();
+    for (int Index : m_MergeMembers) {
+        int Survivor = m_MergeNodes[FindMergeRoot(Index)].Survivor;
+        if (Index == Survivor)
+            continue;
+        float AreaGain = m_Drops.Radius[Index] * m_Drops.Radius[Index] * kAreaGainFactor;
+        m_MergeNodes[Survivor].AreaGain += AreaGain;
+        m_MergeNodes[Survivor].Momentum += m_Drops.GetVelocity(Index) * (AreaGain * kDensity);
+        m_MergeAbsorbed.Add(Index);
+    }
+
+    m_MergeSurvivorIDs.Reset();
+    for (int Index : m_MergeMembers) {
+        m_Drops.Flags[Index] &= ~kDropFlagOverlapped;
+        const MergeNode& Node = m_MergeNodes[Index];
+        if (Node.AreaGain == 0.0f)
+            continue;
+
+        float MassOld = m_Drops.GetMass(Index);
+        m_Drops.AdjustArea(Index, Node.AreaGain);
+        if (m_Drops.Radius[Index] > m_Grid.GetMaxRadius())
+            m_Grid.Invalidate();
+        FVector2D Velocity = (m_Drops.GetVelocity(Index) * MassOld + Node.Momentum) / m_Drops.GetMass(Index);
+        m_Drops.VelocityX[Index] = Velocity.X;
+        m_Drops.VelocityY[Index] = Velocity.Y;
+        m_MergeSurvivorIDs.Add(m_Drops.IDs[Index]);
+    }
+
+    // Backwards, so the rows still to be removed do not move
+    m_MergeAbsorbed.Sort([](int A, int B) { return A > B; });
+    m_TickStats.NumMerged = m_MergeAbsorbed.Num();
+    for (int Index : m_MergeAbsorbed)
+        m_Drops.RemoveAt(Index);
 
-    Kill(ID2);
+    // Heavier now, they may overcome the friction
+    for (int ID : m_MergeSurvivorIDs)
+        m_Drops.Wake(m_Drops.IndexOf(ID));
 }
 
 void DropSystem::Draw(
     UTextureRenderTarget2D* RT_Drops,
     UTextureRenderTarget2D* RT_MovedDrops, UTexture* T_Raindrop,
-    float ViewPortRatio, const TSet<int>& IDs
+    float ViewPortRatio
     )
 {
+    DROP_SCOPE(DropDraw);
     check(m_World);
-    float CurrentTime = m_World->GetTimeSeconds();
+    float DrawTime = GetDrawTime();
+    bool UseDirtyTiles = m_UseDirtyTiles && m_UseBatchedDraw;
+    {
+        DROP_SCOPE(DropGatherQuads);
+        if (UseDirtyTiles) {
+            FVector2D TargetSize((float)RT_Drops->SizeX, (float)RT_Drops->SizeY);
+            GatherDirtyQuads(DrawTime, ViewPortRatio, TargetSize, m_ClearQuads, m_DropQuads);
+        }
+        else
+            GatherDropQuads(DrawTime, ViewPortRatio, m_DropQuads);
+        GatherTrailQuads(DrawTime, ViewPortRatio, m_TrailQuads);
+    }
+
+    DROP_SCOPE(DropCanvas);
+    m_DrawStats.NumQuads = m_DropQuads.Num() + m_TrailQuads.Num();
+    if (UseDirtyTiles) {
+        m_DrawStats.NumDirtyTiles = m_ClearQuads.Num();
+        m_DrawStats.NumDrawItems = DrawDirtyTiles(RT_Drops, T_Raindrop);
+    }
+    else {
+        // The next dirty draw does not know what this one drew
+        InvalidateDrawnDrops();
+        UKismetRenderingLibrary::ClearRenderTarget2D(m_World, RT_Drops, FLinearColor(0.0f, 0.0f, 0.0f, 0.0f));
+        m_DrawStats.NumDirtyTiles = FMath::DivideAndRoundUp(RT_Drops->SizeX, (int32)m_DirtyTileSize) *
+            FMath::DivideAndRoundUp(RT_Drops->SizeY, (int32)m_DirtyTileSize);
+        m_DrawStats.NumDrawItems = DrawQuads(RT_Drops, T_Raindrop, m_DropQuads);
+    }
+    m_DrawStats.NumDrawItems += DrawQuads(RT_MovedDrops, T_Raindrop, m_TrailQuads);
+    INC_DROP_STAT(NumDrawItems, m_DrawStats.NumDrawItems);
+    SET_DROP_STAT(NumDirtyTiles, m_DrawStats.NumDirtyTiles);
+}
+
+/*
+* Draw without a GPU: the same quads splatted into images on the CPU, see DropSplat.h.
+* `Drops` is cleared first, `MovedDrops` keeps accumulating trails like RT_MovedDrops.
+*/
+void DropSystem::DrawSoftware(DropImage& Drops, DropImage& MovedDrops, const DropImage& Sprite, float ViewPortRatio)
+{
+    DROP_SCOPE(DropDrawSoftware);
+    float DrawTime = GetDrawTime();
+    {
+        DROP_SCOPE(DropGatherQuads);
+        GatherDropQuads(DrawTime, ViewPortRatio, m_DropQuads);
+        GatherTrailQuads(DrawTime, ViewPortRatio, m_TrailQuads);
+    }
+
+    DROP_SCOPE(DropSplat);
+    m_DrawStats.NumQuads = m_DropQuads.Num() + m_TrailQuads.Num();
+    m_DrawStats.NumDrawItems = 0;
+    m_DrawStats.NumDirtyTiles = 0;
+    Drops.Clear(FLinearColor(0.0f, 0.0f, 0.0f, 0.0f));
+    SplatDropQuads(m_DropQuads, Sprite, Drops, m_SplatColumns);
+    SplatDropQuads(m_TrailQuads, Sprite, MovedDrops, m_SplatColumns);
+}
+
+/*
+* Copies the drops and everything Draw reads from `Other`, so this one can be drawn while
+* `Other` ticks on. What this one has drawn, its dirty tiles, stays its own.
+*/
+void DropSystem::CopyDrawState(const DropSystem& Other)
+{
+    m_Drops.CopyFrom(Other.m_Drops);
+    m_World = Other.m_World;
+    m_RadiusRenderFactor = Other.m_RadiusRenderFactor;
+    m_UseBatchedDraw = Other.m_UseBatchedDraw;
+    m_UseDirtyTiles = Other.m_UseDirtyTiles;
+    m_DirtyTileSize = Other.m_DirtyTileSize;
+    m_TimeSeconds = Other.m_TimeSeconds;
+    m_LastDeltaSeconds = Other.m_LastDeltaSeconds;
+    m_InterpolationAlpha = Other.m_InterpolationAlpha;
+}
+
+// Time of the interpolated drops, one frame behind the simulation at most.
+float DropSystem::GetDrawTime() const
+{
+    return m_TimeSeconds - (1.0f - m_InterpolationAlpha) * m_LastDeltaSeconds;
+}
+
+/*
+* What RT_Drops needs to catch up with the drops: every drop whose quad changed since the
+* last call, appeared or went away marks the tiles under its old and new quad dirty.
+* `OutClears` are the dirty tiles, to be cleared, and `OutQuads` the quads of all drops
+* touching them, clipped to them, to be drawn after. Comparing the quads is linear in the
+* drops, the drawing only grows with what changed.
+*/
+void DropSystem::GatherDirtyQuads(
+    float CurrentTime, float ViewPortRatio, const FVector2D& TargetSize,
+    TArray<DropQuad>& OutClears, TArray<DropQuad>& OutQuads
+)
+{
+    if (m_DirtyTiles.GetSize() != TargetSize || m_DirtyTiles.GetTileSize() != FMath::Max(m_DirtyTileSize, 1.0f)) {
+        m_DirtyTiles.Reset(TargetSize, m_DirtyTileSize);
+        m_DrawnIDs.Reset();
+    }
+    m_DrawnQuads.SetNum(m_Drops.NumSlots(), false);
+    while (m_DrawnIDs.Num() < m_Drops.NumSlots())
+        m_DrawnIDs.Add(INDEX_NONE);
+
+    DropQuad Quad;
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        int ID = m_Drops.IDs[i];
+        int Slot = GetDropSlot(ID);
+        bool IsDrawn = m_Drops.IsActive(i) && GetDropQuad(i, CurrentTime, ViewPortRatio, Quad);
+        if (m_DrawnIDs[Slot] == ID && IsDrawn && m_DrawnQuads[Slot] == Quad)
+            continue;
+
+        // The slot may still show a drop killed since, or this one somewhere else
+        MarkDrawnQuad(Slot);
+        m_DrawnIDs[Slot] = INDEX_NONE;
+        if (IsDrawn) {
+            m_DrawnIDs[Slot] = ID;
+            m_DrawnQuads[Slot] = Quad;
+            MarkDrawnQuad(Slot);
+        }
+    }
+
+    // Drops gone without their slot being reused yet
+    for (int Slot = 0; Slot < m_DrawnIDs.Num(); ++Slot) {
+        if (m_DrawnIDs[Slot] != INDEX_NONE && !m_Drops.Contains(m_DrawnIDs[Slot])) {
+            MarkDrawnQuad(Slot);
+            m_DrawnIDs[Slot] = INDEX_NONE;
+        }
+    }
+
+    OutClears.Reset();
+    OutQuads.Reset();
+    for (int Tile : m_DirtyTiles.GetDirtyTiles()) {
+        DropQuad& Clear = OutClears.AddDefaulted_GetRef();
+        FVector2D Max;
+        m_DirtyTiles.GetTileRect(Tile, Clear.Position, Max);
+        Clear.Size = Max - Clear.Position;
+    }
+
+    // In row order, as the full draw does
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        int Slot = GetDropSlot(m_Drops.IDs[i]);
+        if (m_DrawnIDs[Slot] != m_Drops.IDs[i])
+            continue;
+
+        const DropQuad& Drawn = m_DrawnQuads[Slot];
+        FVector2D DrawnMax = Drawn.Position + Drawn.Size;
+        m_DirtyTiles.ForEachDirtyInRect(Drawn.Position, DrawnMax, [&](int Tile) {
+            FVector2D TileMin, TileMax;
+            m_DirtyTiles.GetTileRect(Tile, TileMin, TileMax);
+            FVector2D Min(FMath::Max(Drawn.Position.X, TileMin.X), FMath::Max(Drawn.Position.Y, TileMin.Y));
+            FVector2D Max(FMath::Min(DrawnMax.X, TileMax.X), FMath::Min(DrawnMax.Y, TileMax.Y));
+            if (Min.X >= Max.X || Min.Y >= Max.Y)
+                return;
+
+            DropQuad& Clipped = OutQuads.AddDefaulted_GetRef();
+            Clipped.Position = Min;
+            Clipped.Size = Max - Min;
+            Clipped.UVMin = (Min - Drawn.Position) / Drawn.Size;
+            Clipped.UVMax = (Max - Drawn.Position) / Drawn.Size;
+        });
+    }
+    m_DirtyTiles.Clean();
+}
+
+// Marks the tiles under what the slot shows dirty.
+void DropSystem::MarkDrawnQuad(int Slot)
+{
+    if (m_DrawnIDs[Slot] == INDEX_NONE)
+        return;
+    const DropQuad& Drawn = m_DrawnQuads[Slot];
+    m_DirtyTiles.Mark(Drawn.Position, Drawn.Position + Drawn.Size);
+}
+
+/*
+* Clears the dirty tiles and draws the clipped quads over them, in one canvas pass.
+* @return - Canvas items it took, 0 when nothing changed.
+*/
+int DropSystem::DrawDirtyTiles(UTextureRenderTarget2D* RenderTarget, UTexture* Texture)
+{
+    if (m_ClearQuads.Num() == 0 || !Texture || !Texture->Resource)
+        return 0;
 
     UCanvas* Canvas;
     FVector2D CanvasSize;
-    FVector2D StretchFactor;
     FDrawToRenderTargetContext Context;
-    TMap<int, FVector2D> RadiusCached;
-    TMap<int, FVector2D> PositionCached;
-
-    // Draw Drops
     UKismetRenderingLibrary::BeginDrawCanvasToRenderTarget(
-        m_World, RT_Drops, Canvas, CanvasSize, Context
+        m_World, RenderTarget, Canvas, CanvasSize, Context
     );
 
-    Drop* CurrentDrop;
-    float NormalLife, Radius, MappedLife;
-    FVector2D Size2D, Position;
-    for (auto& Iter : m_Drops) {
-        CurrentDrop = Iter.Value;
-        if (!CurrentDrop->IsActive())
-            continue;
-        NormalLife = FMath::Clamp(
-            CurrentTime - CurrentDrop->BirthTimeSeconds,
-            0.0f, kDropShrinkingSeconds
-        ); // From 0 to 1
-
-        // From 1 to 0
-        MappedLife = FMath::Pow(1 - NormalLife, kRadiusAnimationExp);
-
-        StretchFactor = FMath::Lerp(FVector2D::UnitVector, CurrentDrop->Stretch, MappedLife);
-        Radius = (MappedLife * 0.7 + 1.0) * CurrentDrop->Radius;
-        Radius *= m_RadiusRenderFactor;
-        Size2D = FVector2D(Radius, Radius * ViewPortRatio) * 2 * StretchFactor;
-        Position = CurrentDrop->Position - Size2D * 0.5;
-        Canvas->K2_DrawTexture(
-            T_Raindrop,
-            Position,
-            Size2D,
-            FVector2D::ZeroVector,  // CoordinatePosition
-            FVector2D::UnitVector,  // CoordinateSize
-            FLinearColor::White,    // RenderColor
-            BLEND_AlphaComposite   //BlendMode;
-        );
-        PositionCached.Add(Iter.Key, Position);
-        RadiusCached.Add(Iter.Key, Size2D);
+    // Transparent black, written over whatever was there
+    BuildTriangles(m_ClearQuads, m_ClearTriangles, FLinearColor(0.0f, 0.0f, 0.0f, 0.0f));
+    FCanvasTriangleItem ClearItem(
+        FVector2D::ZeroVector, FVector2D::ZeroVector, FVector2D::ZeroVector, Texture->Resource
+    );
+    ClearItem.TriangleList = MoveTemp(m_ClearTriangles);
+    ClearItem.BlendMode = SE_BLEND_Opaque;
+    Canvas->DrawItem(ClearItem);
+    m_ClearTriangles = MoveTemp(ClearItem.TriangleList);
+    int NumDrawItems = 1;
 
+    if (m_DropQuads.Num()) {
+        BuildTriangles(m_DropQuads, m_Triangles);
+        FCanvasTriangleItem Item(
+            FVector2D::ZeroVector, FVector2D::ZeroVector, FVector2D::ZeroVector, Texture->Resource
+        );
+        Item.TriangleList = MoveTemp(m_Triangles);
+        Item.BlendMode = SE_BLEND_AlphaComposite;
+        Canvas->DrawItem(Item);
+        m_Triangles = MoveTemp(Item.TriangleList);
+        NumDrawItems++;
     }
+
     UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(m_World, Context);
+    return NumDrawItems;
+}
 
-    // Draw Trails
-    UKismetRenderingLibrary::BeginDrawCanvasToRenderTarget(
-        m_World, RT_MovedDrops, Canvas, CanvasSize, Context
-    );
+/*
+* Same rectangles `K2_DrawTexture` was called with per drop: active drops shrink from
+* their stretched size to round in `kDropShrinkingSeconds`.
+*/
+void DropSystem::GatherDropQuads(float CurrentTime, float ViewPortRatio, TArray<DropQuad>& OutQuads) const
+{
+    OutQuads.Reset();
+
+    DropQuad Quad;
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        if (m_Drops.IsActive(i) && GetDropQuad(i, CurrentTime, ViewPortRatio, Quad))
+            OutQuads.Add(Quad);
+    }
+}
+
+// Quad of an active drop, false when it has no area to draw.
+bool DropSystem::GetDropQuad(int Index, float CurrentTime, float ViewPortRatio, DropQuad& OutQuad) const
+{
+    float NormalLife = FMath::Clamp(
+        CurrentTime - m_Drops.BirthTimeSeconds[Index],
+        0.0f, kDropShrinkingSeconds
+    ); // From 0 to 1
+
+    // From 1 to 0
+    float MappedLife = kRadiusAnimationCurve.Evaluate(1 - NormalLife);
+
+    FVector2D StretchFactor = FMath::Lerp(FVector2D::UnitVector, m_Drops.Stretch[Index], MappedLife);
+    float Radius = (MappedLife * 0.7 + 1.0) * m_Drops.Radius[Index];
+    Radius *= m_RadiusRenderFactor;
+    FVector2D Size2D = FVector2D(Radius, Radius * ViewPortRatio) * 2 * StretchFactor;
 
-    for (auto ID : IDs) {
-        if (!m_Drops[ID]->IsActive())
+    // K2_DrawTexture draws nothing for these, e.g. a drop emitted without stretch at birth
+    if (Size2D.X <= 0.0f || Size2D.Y <= 0.0f)
+        return false;
+    OutQuad.Position = GetDrawPosition(Index) - Size2D * 0.5;
+    OutQuad.Size = Size2D;
+    return true;
+}
+
+// Drops that moved in the last tick or are still shrinking leave a trail.
+void DropSystem::GatherTrailQuads(float CurrentTime, float ViewPortRatio, TArray<DropQuad>& OutQuads) const
+{
+    OutQuads.Reset();
+
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        if (!m_Drops.IsActive(i))
+            continue;
+        bool IsShrinking = CurrentTime - m_Drops.BirthTimeSeconds[i] < kDropShrinkingSeconds;
+        if (!m_Drops.IsMoved(i) && !IsShrinking)
             continue;
 
-        Size2D = FVector2D(m_Drops[ID]->Radius, m_Drops[ID]->Radius * ViewPortRatio) * 2;
-        Position = m_Drops[ID]->Position - Size2D * 0.5;
+        FVector2D Size2D = FVector2D(m_Drops.Radius[i], m_Drops.Radius[i] * ViewPortRatio) * 2;
+        AddQuad(GetDrawPosition(i), Size2D, OutQuads);
+    }
+}
 
-        Canvas->K2_DrawTexture(
-            T_Raindrop,
-            Position, Size2D,
-            FVector2D::ZeroVector,  // CoordinatePosition
-            FVector2D::UnitVector,  // CoordinateSize
-            FLinearColor::White,    // RenderColor
-            BLEND_AlphaComposite   //BlendMode;
-        );
+// Between the last two ticks, as far as the accumulated time of the fixed step reaches.
+FVector2D DropSystem::GetDrawPosition(int Index) const
+{
+    if (m_InterpolationAlpha >= 1.0f)
+        return m_Drops.GetPosition(Index);
+    return FMath::Lerp(m_Drops.GetPrevPosition(Index), m_Drops.GetPosition(Index), m_InterpolationAlpha);
+}
+
+void DropSystem::AddQuad(const FVector2D& Center, const FVector2D& Size, TArray<DropQuad>& OutQuads)
+{
+    // K2_DrawTexture draws nothing for these, e.g. a drop emitted without stretch at birth
+    if (Size.X <= 0.0f || Size.Y <= 0.0f)
+        return;
+
+    DropQuad& Quad = OutQuads.AddDefaulted_GetRef();
+    Quad.Position = Center - Size * 0.5;
+    Quad.Size = Size;
+}
 
+/*
+* Draws all quads into the render target, returns the number of canvas items it took.
+* The batched path puts every quad into one triangle list, so the canvas builds a single
+* batch for the whole frame instead of one per drop.
+*/
+int DropSystem::DrawQuads(UTextureRenderTarget2D* RenderTarget, UTexture* Texture, const TArray<DropQuad>& Quads)
+{
+    UCanvas* Canvas;
+    FVector2D CanvasSize;
+    FDrawToRenderTargetContext Context;
+    UKismetRenderingLibrary::BeginDrawCanvasToRenderTarget(
+        m_World, RenderTarget, Canvas, CanvasSize, Context
+    );
+
+    int NumDrawItems = 0;
+    if (!m_UseBatchedDraw) {
+        for (const DropQuad& Quad : Quads) {
+            Canvas->K2_DrawTexture(
+                Texture,
+                Quad.Position, Quad.Size,
+                FVector2D::ZeroVector,  // CoordinatePosition
+                FVector2D::UnitVector,  // CoordinateSize
+                FLinearColor::White,    // RenderColor
+                BLEND_AlphaComposite   //BlendMode;
+            );
+        }
+        NumDrawItems = Quads.Num();
     }
+    else if (Quads.Num() && Texture && Texture->Resource) {
+        BuildTriangles(Quads, m_Triangles);
+
+        FCanvasTriangleItem Item(
+            FVector2D::ZeroVector, FVector2D::ZeroVector, FVector2D::ZeroVector, Texture->Resource
+        );
+        Item.TriangleList = MoveTemp(m_Triangles);
+        Item.BlendMode = SE_BLEND_AlphaComposite;
+        Canvas->DrawItem(Item);
+        m_Triangles = MoveTemp(Item.TriangleList);  // Keep the allocation for the next frame
+        NumDrawItems = 1;
+    }
+
     UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(m_World, Context);
+    return NumDrawItems;
 }
 
-TSet<int> DropSystem::GetShrinkingIDs() const
+// Two triangles per quad, with its part of the texture mapped on it like K2_DrawTexture does.
+void DropSystem::BuildTriangles(const TArray<DropQuad>& Quads, TArray<FCanvasUVTri>& OutTriangles, const FLinearColor& Color)
 {
-    TSet<int> Result;
-    float GameTime = m_World->GetTimeSeconds();
-    float Age;
-    for (auto Iter : m_Drops) {
-        Age = GameTime - Iter.Value->BirthTimeSeconds;
-        if (Age >= 0 && Age < kDropShrinkingSeconds)
-            Result.Add(Iter.Key);
+    OutTriangles.SetNumUninitialized(Quads.Num() * 2, false);
+    for (int i = 0; i < Quads.Num(); ++i) {
+        const FVector2D& Min = Quads[i].Position;
+        FVector2D Max = Min + Quads[i].Size;
+
+        const FVector2D& UVMin = Quads[i].UVMin;
+        const FVector2D& UVMax = Quads[i].UVMax;
+
+        FCanvasUVTri& Upper = OutTriangles[i * 2];
+        Upper.V0_Pos = Min;
+        Upper.V0_UV = UVMin;
+        Upper.V1_Pos = FVector2D(Max.X, Min.Y);
+        Upper.V1_UV = FVector2D(UVMax.X, UVMin.Y);
+        Upper.V2_Pos = Max;
+        Upper.V2_UV = UVMax;
+
+        FCanvasUVTri& Lower = OutTriangles[i * 2 + 1];
+        Lower.V0_Pos = Min;
+        Lower.V0_UV = UVMin;
+        Lower.V1_Pos = Max;
+        Lower.V1_UV = UVMax;
+        Lower.V2_Pos = FVector2D(Min.X, Max.Y);
+        Lower.V2_UV = FVector2D(UVMin.X, UVMax.Y);
+
+        Upper.V0_Color = Upper.V1_Color = Upper.V2_Color = Color;
+        Lower.V0_Color = Lower.V1_Color = Lower.V2_Color = Color;
     }
-    return MoveTemp(Result);
 }
 
 void DropSystem::MarkDropsOutsideFinger(const FVector2D& Center, float Radius)
 {
-    Drop* CurrentDrop;
-    float Distance, Threshold;
-    for (auto Iter : m_Drops)
-    {
-        CurrentDrop = Iter.Value;
-        if (CurrentDrop->IsActive())
-            continue;
+    MarkDropsOutsideFinger(Center, Center, Radius, Radius);
+}
 
-        Distance = (Center - CurrentDrop->Position).Size();
-        Threshold = Radius + CurrentDrop->Radius;
-        if (Distance < Threshold)
-            continue;
-        CurrentDrop->BirthTimeSeconds = kBirthTimeOutsideOfFinger;
+void DropSystem::MarkDropsOutsideFinger(
+    const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius
+)
+{
+    DROP_SCOPE(DropMarkFinger);
+    m_UnderFinger.Reset();
+    CollectUnderFinger(Start, End, StartRadius, EndRadius);
+    MarkOutsideUnderFinger();
+}
+
+/*
+* Marks the drops outside the union of the capsules along Path, as the finger swept all of it.
+* Marking segment by segment would leave only the drops under the last segment unmarked.
+*/
+void DropSystem::MarkDropsOutsideFinger(TArrayView<const FVector2D> Path, float Radius)
+{
+    DROP_SCOPE(DropMarkFinger);
+    m_UnderFinger.Reset();
+    if (Path.Num() == 1)
+        CollectUnderFinger(Path[0], Path[0], Radius, Radius);
+    for (int Point = 1; Point < Path.Num(); ++Point)
+        CollectUnderFinger(Path[Point - 1], Path[Point], Radius, Radius);
+    MarkOutsideUnderFinger();
+}
+
+// Only unmarked drops under the finger stay unmarked, the grid finds them
+void DropSystem::CollectUnderFinger(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius)
+{
+    ForEachInCapsule(Start, End, StartRadius, EndRadius, [&](int i, float Distance, float Threshold) {
+        if (m_Drops.BirthTimeSeconds[i] == kBirthTimeNotInitialized && Distance < Threshold)
+            m_UnderFinger.Add(i);
+    });
+}
+
+// A drop under two capsules is in m_UnderFinger twice, which doesn't matter here
+void DropSystem::MarkOutsideUnderFinger()
+{
+    for (int i = 0; i < m_Drops.Num(); ++i) {
+        if (!m_Drops.IsActive(i))
+            m_Drops.BirthTimeSeconds[i] = kBirthTimeOutsideOfFinger;
     }
+
+    for (auto i : m_UnderFinger)
+        m_Drops.BirthTimeSeconds[i] = kBirthTimeNotInitialized;
 }
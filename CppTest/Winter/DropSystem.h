@@ -2,27 +2,104 @@
 #include <CoreMinimal.h>
 
 #include "Drop.h"
+#include "DropStorage.h"
+#include "DropGrid.h"
+#include "DropTiles.h"
+
+#include <Engine/Canvas.h>
 
 typedef std::pair<int, int> IDPair;
 
+// Screen rectangle a drop texture is drawn into.
+struct DropQuad
+{
+    FVector2D Position;     // Top left corner
+    FVector2D Size;
+    FVector2D UVMin = FVector2D(0.0f, 0.0f);   // Part of the texture on it, all of it unless clipped
+    FVector2D UVMax = FVector2D(1.0f, 1.0f);
+
+    bool operator==(const DropQuad& Other) const {
+        return Position == Other.Position && Size == Other.Size;
+    }
+};
+
+// Where the time of the last DropSystem::Tick went.
+struct DropTickStats
+{
+    int NumDrops = 0;           // Before the tick
+    int NumSimulated = 0;       // Awake drops, the sleeping ones are skipped
+    int NumSleeping = 0;
+    int NumActive = 0;          // After the tick, drops no longer under the finger
+    int NumMoved = 0;
+    int NumPairsTested = 0;     // Candidates the overlap search measured
+    int NumPairsFound = 0;
+    int NumMerged = 0;          // Drops absorbed into a bigger one
+    int NumSplits = 0;          // Trail drops split off
+    int NumKilled = 0;          // By the finger since the previous tick
+    int NumEvicted = 0;         // To stay within the budget
+    int DropBudget = 0;         // Drops allowed in the tick, 0 without a budget
+    double SimulateSeconds = 0.0;
+    double ClipSeconds = 0.0;
+    double SplitTrailSeconds = 0.0;
+    double OverlapSeconds = 0.0;
+    double EvictSeconds = 0.0;
+};
+
+struct DropDrawStats
+{
+    int NumQuads = 0;       // Drops drawn into both render targets last frame
+    int NumDrawItems = 0;   // Canvas items submitted for them
+    int NumDirtyTiles = 0;  // Tiles of RT_Drops cleared and drawn again, all of them without dirty tiles
+};
+
+// Sprite columns of the pixel columns of a quad, the same on every row, see DropSplat.h.
+struct DropSplatColumn
+{
+    int Column;
+    int NextColumn;
+    float Fraction;
+};
+
+struct DropImage;
+
 class DropSystem
 {
 public:
     DropSystem();
     ~DropSystem();
 
-    template<class... Types> Drop* Emit(Types... Args);
+    template<class... Types> int Emit(Types... Args);
     void Kill(int ID);
     void Draw(UTextureRenderTarget2D* RT_Drops,
         UTextureRenderTarget2D* RT_MovedDrops, UTexture* T_Raindrop,
-        float ViewPortRatio, const TSet<int>& IDs
+        float ViewPortRatio
     );
+    void DrawSoftware(DropImage& Drops, DropImage& MovedDrops, const DropImage& Sprite, float ViewPortRatio);
     void MarkDropsOutsideFinger(const FVector2D& Center, float Radius);
+    void MarkDropsOutsideFinger(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius);
+    void MarkDropsOutsideFinger(TArrayView<const FVector2D> Path, float Radius);
     void Kill(const FVector2D& Center, float Radius);
-    TSet<int> Tick(float TimeDeltaSeconds, const FVector2D& ClipSize);
-    TSet<int> GetShrinkingIDs() const;
+    void Kill(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius, int NumSteps = 0);
+    int Advance(float DeltaSeconds, const FVector2D& ClipSize);
+    void Tick(float TimeDeltaSeconds, const FVector2D& ClipSize);
+    void FindOverlappedPairs(TArray<IDPair>& OutPairs);
+    DropPoolStats GetPoolStats() const { return m_Drops.GetPoolStats(); }
+    DropDrawStats GetDrawStats() const { return m_DrawStats; }
+    DropTickStats GetTickStats() const { return m_TickStats; }
+    float GetTimeSeconds() const { return m_TimeSeconds; }    // Sum of the ticked deltas, birth times are in it
+    void GatherDropQuads(float CurrentTime, float ViewPortRatio, TArray<DropQuad>& OutQuads) const;
+    void GatherTrailQuads(float CurrentTime, float ViewPortRatio, TArray<DropQuad>& OutQuads) const;
+    void GatherDirtyQuads(
+        float CurrentTime, float ViewPortRatio, const FVector2D& TargetSize,
+        TArray<DropQuad>& OutClears, TArray<DropQuad>& OutQuads
+    );
+    void InvalidateDrawnDrops() { m_DirtyTiles.Reset(FVector2D::ZeroVector, 1.0f); }
+    void CopyDrawState(const DropSystem& Other);
+    static void BuildTriangles(
+        const TArray<DropQuad>& Quads, TArray<FCanvasUVTri>& OutTriangles, const FLinearColor& Color = FLinearColor::White
+    );
 
-    TMap<int, Drop*> m_Drops;
+    DropStorage m_Drops;
     float m_RadiusRenderFactor = 1.0f;  // For compensating the texture alpha margin
     UWorld* m_World;
     float m_Gravity = 10.0;
@@ -30,17 +107,108 @@ public:
     float m_DynamicFriction = 430.0;
     float m_VelocityScale = 20.0;
     float m_SplitTrailVelocityThreshold = 50.0f;
+    bool m_UseOverlapGrid = true;       // False tests every moved drop against every drop
+    bool m_UseSimdIntegration = true;   // False integrates with the scalar reference path
+    int m_NumWorkerThreads = 0;         // 0 uses every task graph worker, 1 keeps the game thread only
+    int m_MinBatchSize = 4096;          // Fewer drops than this per batch are not worth a thread
+    bool m_UseBatchedDraw = true;       // False draws every drop as its own canvas tile
+    bool m_UseDirtyTiles = true;        // False clears and draws all of RT_Drops every frame, needs batched draw
+    float m_DirtyTileSize = 32.0f;      // Pixels of RT_Drops
+    bool m_UseSleeping = true;          // False simulates drops at rest every tick too
+    float m_FixedStepSeconds = 0.0f;    // 0 ticks once per frame with the frame time
+    int m_MaxSubSteps = 4;              // Fixed steps per frame at most
+    int m_MaxDrops = 0;                 // 0 lets the drops grow without bound
+    uint32 m_RandomSeed = kDropRandomDefaultSeed;   // Same seed and inputs, same drops
+    float m_TargetTickMilliseconds = 0.0f;  // 0 does not limit the drops by the tick time
 
 private:
-    void SplitTrailDrops(float DeltaSeconds, const TSet<int>& MovedIDs);
-    TSet<int> Clip(const FVector2D& Size, const TSet<int>& MovedIDs);
-    TSet<int> Simulate(float TimeDeltaSeconds);
-    void ProcessOverlaps(const TSet<int>& MovedIDs);
+    friend class DropSnapshot;     // Saves and loads the private state too
+
+    struct TrailSplit
+    {
+        bool IsSplit;
+        FVector2D Position;
+        FVector2D Stretch;
+        float Radius;
+    };
+
+    // Union-find node of a drop in a cluster of overlapped drops.
+    struct MergeNode
+    {
+        int Parent;
+        int Size;
+        int Survivor;           // Only valid at the root
+        float AreaGain;         // Only valid at the survivor
+        FVector2D Momentum;
+    };
+
+    float GetDrawTime() const;
+    FVector2D GetDrawPosition(int Index) const;
+    bool GetDropQuad(int Index, float CurrentTime, float ViewPortRatio, DropQuad& OutQuad) const;
+    void MarkDrawnQuad(int Slot);
+    int DrawDirtyTiles(UTextureRenderTarget2D* RenderTarget, UTexture* Texture);
+    static void AddQuad(const FVector2D& Center, const FVector2D& Size, TArray<DropQuad>& OutQuads);
+    int DrawQuads(UTextureRenderTarget2D* RenderTarget, UTexture* Texture, const TArray<DropQuad>& Quads);
+    void ParallelForBatches(int Num, TFunctionRef<void(int Begin, int End)> Body) const;
+    int AddDrop(const Drop& NewDrop);
+    const DropGrid& GetGrid();
+    template<class FuncType> void ForEachInCapsule(
+        const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius, FuncType Visitor
+    );
+    void CollectUnderFinger(const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius);
+    void MarkOutsideUnderFinger();
+    void CollectMovedIndices();
+    void FindOverlappedPairsBruteForce(TArray<IDPair>& OutPairs);
+    void SplitTrailDrops(float DeltaSeconds);
+    void Clip(const FVector2D& Size);
+    void Simulate(float TimeDeltaSeconds);
+    void ProcessOverlaps();
+    void SleepRestingDrops();
+    void PublishTickStats() const;
+    int GetDropBudget() const;
+    void UpdateTimeBudget(int NumTicked, double TickSeconds);
+    void EvictDrops(int DropBudget);
     void ActiveTrailDrops(const TArray<IDPair>& OverlappedPairs);
+    int FindMergeRoot(int Index);
     void MergeDrops(const TArray<IDPair>& OverlappedPairs);
-    void MergeDrop(int ID1, int ID2);
 
-    int m_NextID = 0;
+    DropGrid m_Grid;
+    float m_TimeSeconds = 0.0f;
+    float m_LastDeltaSeconds = 0.0f;
+    float m_StepAccumulatorSeconds = 0.0f;  // Frame time not ticked yet
+    float m_InterpolationAlpha = 1.0f;      // How far Draw is from the previous tick to the last one
+    int m_NumPairsTested = 0;       // By the last FindOverlappedPairs
+    int m_NumKilled = 0;            // Since the last tick
+    float m_TimeBudgetDrops = 0.0f; // Drops m_TargetTickMilliseconds affords, 0 before measuring
+    uint32 m_RandomCounter = 0;     // Ticks so far, keys every random number of a tick
+    float m_SleepGravity = 0.0f;    // Parameters the sleeping drops were put to sleep with
+    float m_SleepStaticFriction = 0.0f;
+    FVector2D m_SleepClipSize = FVector2D::ZeroVector;
+
+    // Scratch buffers, reset instead of freed so a steady tick does not allocate
+    TArray<uint8> m_ClipFlags;
+    TArray<int> m_MovedIndices;
+    TArray<IDPair> m_OverlappedPairs;
+    TArray<int> m_KilledIDs;
+    TArray<int> m_UnderFinger;
+    TArray<MergeNode> m_MergeNodes;
+    TArray<IDPair> m_MergePairs;            // Dense indices
+    TArray<int> m_MergeMembers;
+    TArray<int> m_MergeAbsorbed;
+    TArray<int> m_MergeSurvivorIDs;
+    TArray<std::pair<float, int>> m_EvictionCandidates;    // Visibility, drop ID
+    TArray<TrailSplit> m_TrailSplits;
+    TArray<DropQuad> m_DropQuads;
+    TArray<DropQuad> m_TrailQuads;
+    TArray<DropSplatColumn> m_SplatColumns;
+    TArray<FCanvasUVTri> m_Triangles;
+    TArray<FCanvasUVTri> m_ClearTriangles;
+    TArray<DropQuad> m_ClearQuads;
+    DropDirtyTiles m_DirtyTiles;
+    TArray<DropQuad> m_DrawnQuads;          // Slot -> what RT_Drops shows of the drop in it
+    TArray<int> m_DrawnIDs;                 // Slot -> ID of that drop, INDEX_NONE when nothing is drawn
+    DropDrawStats m_DrawStats;
+    DropTickStats m_TickStats;
 };
 
 
@@ -48,10 +216,48 @@ private:
 *  https://stackoverflow.com/questions/495021/why-can-templates-only-be-implemented-in-the-header-file
 */
 template<class... Types>
-Drop* DropSystem::Emit(Types... Args)
+int DropSystem::Emit(Types... Args)
+{
+    return AddDrop(Drop(Args...));
+}
+
+/*
+* Visits the drops touching the capsule from `Start` to `End`, whose radius goes linearly
+* from `StartRadius` to `EndRadius`, as Visitor(Index, Distance, Threshold).
+* The segment is cut into pieces about as long as the reach and each piece only
+* visits the drops whose closest point on the segment is in it, so a long diagonal
+* stroke neither scans its whole bounding box nor visits a drop twice.
+*/
+template<class FuncType>
+void DropSystem::ForEachInCapsule(
+    const FVector2D& Start, const FVector2D& End, float StartRadius, float EndRadius, FuncType Visitor
+)
 {
-    Drop* NewDrop = new Drop(Args...);
-    m_Drops.Add(m_NextID, NewDrop);
-    m_NextID++;
-    return NewDrop;
-}
\ No newline at end of file
+    const DropGrid& Grid = GetGrid();
+    float MaxReach = FMath::Max(StartRadius, EndRadius) + Grid.GetMaxRadius();
+    FVector2D Segment = End - Start;
+    float LengthSquared = Segment.SizeSquared();
+    int NumPieces = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt(LengthSquared) / FMath::Max(2.0f * MaxReach, 1.0f)));
+    float InvLengthSquared = LengthSquared > SMALL_NUMBER ? 1.0f / LengthSquared : 0.0f;
+
+    for (int Piece = 0; Piece < NumPieces; ++Piece) {
+        float PieceBegin = (float)Piece / NumPieces;
+        float PieceEnd = (float)(Piece + 1) / NumPieces;
+        FVector2D PieceStart = Start + Segment * PieceBegin;
+        FVector2D PieceStop = Start + Segment * PieceEnd;
+        FVector2D Min(FMath::Min(PieceStart.X, PieceStop.X) - MaxReach, FMath::Min(PieceStart.Y, PieceStop.Y) - MaxReach);
+        FVector2D Max(FMath::Max(PieceStart.X, PieceStop.X) + MaxReach, FMath::Max(PieceStart.Y, PieceStop.Y) + MaxReach);
+
+        Grid.ForEachInBox(m_Drops, Min, Max, [&](int i) {
+            FVector2D Position = m_Drops.GetPosition(i);
+            float T = FMath::Clamp(FVector2D::DotProduct(Position - Start, Segment) * InvLengthSquared, 0.0f, 1.0f);
+            bool InPiece = T >= PieceBegin && (T < PieceEnd || Piece == NumPieces - 1);
+            if (!InPiece)
+                return;
+
+            float Distance = (Start + Segment * T - Position).Size();
+            float Threshold = FMath::Lerp(StartRadius, EndRadius, T) + m_Drops.Radius[i];
+            Visitor(i, Distance, Threshold);
+        });
+    }
+}
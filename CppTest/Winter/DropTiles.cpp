@@ -0,0 +1,72 @@
+#include "DropTiles.h"
+#include "Common.h"
+
+
+void DropDirtyTiles::Reset(const FVector2D& Size, float TileSize)
+{
+    m_Size = Size;
+    m_TileSize = FMath::Max(TileSize, 1.0f);
+    m_InvTileSize = 1.0f / m_TileSize;
+    m_NumX = FMath::Max(FMath::CeilToInt(Size.X * m_InvTileSize), 1);
+    m_NumY = FMath::Max(FMath::CeilToInt(Size.Y * m_InvTileSize), 1);
+
+    m_IsDirty.SetNumZeroed(m_NumX * m_NumY);
+    m_DirtyTiles.Reset();
+    MarkAll();
+}
+
+void DropDirtyTiles::MarkAll()
+{
+    m_DirtyTiles.Reset();
+    for (int Tile = 0; Tile < m_IsDirty.Num(); ++Tile) {
+        m_IsDirty[Tile] = 1;
+        m_DirtyTiles.Add(Tile);
+    }
+}
+
+void DropDirtyTiles::Mark(const FVector2D& Min, const FVector2D& Max)
+{
+    int X0, Y0, X1, Y1;
+    if (!GetTileRange(Min, Max, X0, Y0, X1, Y1))
+        return;
+
+    for (int Y = Y0; Y <= Y1; ++Y) {
+        for (int X = X0; X <= X1; ++X) {
+            int Tile = Y * m_NumX + X;
+            if (m_IsDirty[Tile])
+                continue;
+            m_IsDirty[Tile] = 1;
+            m_DirtyTiles.Add(Tile);
+        }
+    }
+}
+
+void DropDirtyTiles::Clean()
+{
+    for (int Tile : m_DirtyTiles)
+        m_IsDirty[Tile] = 0;
+    m_DirtyTiles.Reset();
+}
+
+void DropDirtyTiles::GetTileRect(int Tile, FVector2D& OutMin, FVector2D& OutMax) const
+{
+    int X = Tile % m_NumX;
+    int Y = Tile / m_NumX;
+    OutMin = FVector2D(X * m_TileSize, Y * m_TileSize);
+    OutMax = FVector2D(FMath::Min(OutMin.X + m_TileSize, m_Size.X), FMath::Min(OutMin.Y + m_TileSize, m_Size.Y));
+}
+
+// Tiles touched by the rectangle, false when it is outside of the render target.
+bool DropDirtyTiles::GetTileRange(
+    const FVector2D& Min, const FVector2D& Max, int& OutX0, int& OutY0, int& OutX1, int& OutY1
+) const
+{
+    if (Max.X <= 0.0f || Max.Y <= 0.0f || Min.X >= m_Size.X || Min.Y >= m_Size.Y)
+        return false;
+
+    OutX0 = FMath::Clamp(FMath::FloorToInt(Min.X * m_InvTileSize), 0, m_NumX - 1);
+    OutY0 = FMath::Clamp(FMath::FloorToInt(Min.Y * m_InvTileSize), 0, m_NumY - 1);
+    OutX1 = FMath::Clamp(FMath::FloorToInt(Max.X * m_InvTileSize), 0, m_NumX - 1);
+    OutY1 = FMath::Clamp(FMath::FloorToInt(Max.Y * m_InvTileSize), 0, m_NumY - 1);
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <CoreMinimal.h>
+
+
+/*
+* Dirty flags of the square tiles of a render target, for redrawing only what changed.
+*
+* Whatever changed since the last draw marks the tiles under its old and new rectangle.
+* The draw clears the dirty tiles, draws everything touching them clipped to them, and
+* `Clean`s them. Dirty tiles are also kept in a list, so a quiet frame costs nothing.
+*/
+class DropDirtyTiles
+{
+public:
+    void Reset(const FVector2D& Size, float TileSize);
+    void MarkAll();
+    void Mark(const FVector2D& Min, const FVector2D& Max);
+    void Clean();
+
+    const FVector2D& GetSize() const { return m_Size; }
+    float GetTileSize() const { return m_TileSize; }
+    int NumDirty() const { return m_DirtyTiles.Num(); }
+    const TArray<int>& GetDirtyTiles() const { return m_DirtyTiles; }
+
+    // Rectangle of a tile from GetDirtyTiles, clipped to the render target.
+    void GetTileRect(int Tile, FVector2D& OutMin, FVector2D& OutMax) const;
+
+    // Calls `Visitor(Tile)` for every dirty tile the rectangle touches.
+    template<class FuncType>
+    void ForEachDirtyInRect(const FVector2D& Min, const FVector2D& Max, FuncType Visitor) const;
+
+private:
+    bool GetTileRange(const FVector2D& Min, const FVector2D& Max, int& OutX0, int& OutY0, int& OutX1, int& OutY1) const;
+
+    TArray<uint8> m_IsDirty;    // Tile -> 1 when dirty, tiles are row major
+    TArray<int> m_DirtyTiles;
+    FVector2D m_Size = FVector2D::ZeroVector;
+    float m_TileSize = 1.0f;
+    float m_InvTileSize = 1.0f;
+    int m_NumX = 0;
+    int m_NumY = 0;
+};
+
+
+template<class FuncType>
+void DropDirtyTiles::ForEachDirtyInRect(const FVector2D& Min, const FVector2D& Max, FuncType Visitor) const
+{
+    int X0, Y0, X1, Y1;
+    if (m_DirtyTiles.Num() == 0 || !GetTileRange(Min, Max, X0, Y0, X1, Y1))
+        return;
+
+    for (int Y = Y0; Y <= Y1; ++Y) {
+        for (int X = X0; X <= X1; ++X) {
+            int Tile = Y * m_NumX + X;
+            if (m_IsDirty[Tile])
+                Visitor(Tile);
+        }
+    }
+}
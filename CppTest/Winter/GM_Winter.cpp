@@ -6,7 +6,13 @@
 #include "Kismet/KismetMaterialLibrary.h"
 #include "Kismet/KismetRenderingLibrary.h"
 #include "Blueprint/WidgetLayoutLibrary.h"
+#include "Kismet/KismetSystemLibrary.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Engine/GameViewportClient.h"
+#include "Widgets/SWindow.h"
 
+#include "DropStats.h"
 #include "Common.h"
 
 
@@ -17,8 +23,14 @@ const FVector kPawnPos(-110, 0.0, 33.0);
 const float kFingerSizeRT = 20;
 const int kBrushSpace = 5; // px
 const float kDefaultPressure = 0.3;
+constexpr auto kPressureCurve = MakeDropPowCurve(0.7);
+constexpr auto kEmitRadiusCurveDefault = MakeDropPowCurve(kDropEmitRadiusExpDefault);
+constexpr auto kEmitRadiusCurveStrokeEnd = MakeDropPowCurve(kDropEmitRadiusExpStrokeEnd);
 
-TSharedPtr<FWindowsStylusInputInterface> CreateStylusInputInterface();
+DECLARE_CYCLE_STAT(TEXT("Stylus input"), STAT_DropStylusInput, STATGROUP_Drops);
+DECLARE_CYCLE_STAT(TEXT("Stroke"), STAT_DropStroke, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stroke stamps"), STAT_NumStrokeStamps, STATGROUP_Drops);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stroke draws"), STAT_NumStrokeDraws, STATGROUP_Drops);
 
 AGM_Winter::AGM_Winter()
     :RT_Drops(nullptr),
@@ -56,12 +68,24 @@ void AGM_Winter::StartPlay()
     m_World = GetWorld();
     m_RenderTargetSize = FVector2D(static_cast<float>(RT_Drops->SizeX));
 
-    m_DropSystem.m_RadiusRenderFactor = DropRadiusRenderFactor;
-    m_DropSystem.m_World = m_World;
-    PlayerController = UGameplayStatics::GetPlayerController(m_World, 0);
     m_ViewportScale = UWidgetLayoutLibrary::GetViewportScale(m_World);
+    StartInputLog();
+
+    DropSystem& Simulation = m_DropPipeline.m_Simulation;
+    Simulation.m_RadiusRenderFactor = DropRadiusRenderFactor;
+    Simulation.m_NumWorkerThreads = SimulationWorkerThreads;
+    Simulation.m_MinBatchSize = SimulationMinBatchSize;
+    Simulation.m_FixedStepSeconds = SimulationFixedStepHz > 0.0f ? 1.0f / SimulationFixedStepHz : 0.0f;
+    Simulation.m_MaxSubSteps = SimulationMaxSubSteps;
+    Simulation.m_MaxDrops = SimulationMaxDrops;
+    Simulation.m_TargetTickMilliseconds = SimulationTargetTickMs;
+    Simulation.m_RandomSeed = (uint32)RandomSeed;
+    m_EmitRandom = DropRandomSequence((uint32)RandomSeed);
+    Simulation.m_World = m_World;
+    m_DropPipeline.SetPipelined(SimulationPipelined);
+    PlayerController = UGameplayStatics::GetPlayerController(m_World, 0);
 
-    // Inputs
+    // Inputs, ignored while they come from a log
     UInputComponent* ControllerComponent = m_World->GetFirstPlayerController()->InputComponent;
     ControllerComponent->BindKey(
         EKeys::LeftMouseButton, IE_Pressed, this, &AGM_Winter::FingerPressed
@@ -70,7 +94,7 @@ void AGM_Winter::StartPlay()
         EKeys::LeftMouseButton, IE_Released, this, &AGM_Winter::FingerReleased
     );
     ControllerComponent->BindKey(
-        EKeys::RightMouseButton, IE_Pressed, this, &AGM_Winter::PutBigDrop
+        EKeys::RightMouseButton, IE_Pressed, this, &AGM_Winter::BigDropPressed
     );
     PlayerController->bShowMouseCursor = true;
 
@@ -99,24 +123,64 @@ void AGM_Winter::StartPlay()
 
 
 
-    UE_LOG(LogTemp, Log, TEXT("m_StylusInputInterface->NumInputDevices(): %d"), m_StylusInputInterface->NumInputDevices());
+    if (m_StylusInputInterface.IsValid())
+        UE_LOG(LogTemp, Log, TEXT("m_StylusInputInterface->NumInputDevices(): %d"), m_StylusInputInterface->NumInputDevices());
 
 }
 
 
+/**
+* Opens the input log to replay, taking its seed and viewport scale, or the one to record.
+* `-inputreplay=<path>` and `-inputrecord=<path>` on the command line override the properties.
+*/
+void AGM_Winter::StartInputLog()
+{
+    FParse::Value(FCommandLine::Get(), TEXT("inputreplay="), InputReplayPath);
+    FParse::Value(FCommandLine::Get(), TEXT("inputrecord="), InputRecordPath);
+
+    InputLogHeader Header;
+    if (!InputReplayPath.IsEmpty()) {
+        if (m_InputReplay.Open(InputReplayPath, Header)) {
+            RandomSeed = Header.RandomSeed;
+            m_ViewportScale = Header.ViewportScale;
+            m_ReplayStartSeconds = FPlatformTime::Seconds();
+            UE_LOG(LogTemp, Log, TEXT("Replaying input from %s."), *InputReplayPath);
+        }
+        else {
+            UE_LOG(LogTemp, Error, TEXT("Could not read the input log %s."), *InputReplayPath);
+        }
+    }
+
+    if (!InputRecordPath.IsEmpty()) {
+        Header.RandomSeed = RandomSeed;
+        Header.ViewportScale = m_ViewportScale;
+        if (m_InputRecorder.Open(InputRecordPath, Header))
+            UE_LOG(LogTemp, Log, TEXT("Recording input to %s."), *InputRecordPath);
+        else
+            UE_LOG(LogTemp, Error, TEXT("Could not write the input log %s."), *InputRecordPath);
+    }
+}
+
+
 void AGM_Winter::Tick(float DeltaSeconds)
 {
+    if (m_InputReplay.IsOpen()) {
+        if (!ReplayInputFrame())
+            return;
+    }
+    else {
+        ReadInputFrame(DeltaSeconds);
+        if (m_InputRecorder.IsOpen())
+            m_InputRecorder.RecordFrame(m_InputFrame);
+    }
+
     TickStylusInputs();
 
-    int SizeX, SizeY;
-    PlayerController->GetViewportSize(SizeX, SizeY);
-    m_ViewportRatio = static_cast<float>(SizeX) / SizeY;    
+    const FIntPoint& ViewportSize = m_InputFrame.ViewportSize;
+    m_ViewportRatio = static_cast<float>(ViewportSize.X) / ViewportSize.Y;
     m_ViewFactor = FVector2D(m_ViewportScale, m_ViewportScale) \
-        / FVector2D((float)SizeX, (float)SizeY);
-    UKismetRenderingLibrary::ClearRenderTarget2D
-        (m_World, RT_Drops, FLinearColor(0.0f, 0.0f, 0.0f, 0.0f)
-    );
-    FVector2D CurrentFingerPos = UWidgetLayoutLibrary::GetMousePositionOnViewport(m_World);
+        / FVector2D((float)ViewportSize.X, (float)ViewportSize.Y);
+    FVector2D CurrentFingerPos = m_InputFrame.MousePosition;
 
     if (m_FingerPressed) {
         bool MovedFarEnough = FVector2D::Distance(CurrentFingerPos, m_LastPosition) > kMoveThreshold;
@@ -128,12 +192,62 @@ void AGM_Winter::Tick(float DeltaSeconds)
 
     m_JustPressed = false;
 
-    TSet<int> MovedIDs = SimDrops(DeltaSeconds);
-    DrawDrops(MovedIDs);
+    SimDrops(m_InputFrame.DeltaSeconds);
+    DrawDrops();
 }
 
-void AGM_Winter::TickStylusInputs()
+void AGM_Winter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (m_InputRecorder.IsOpen()) {
+        UE_LOG(LogTemp, Log, TEXT("Recorded %d frames of input."), m_InputRecorder.GetNumFrames());
+        m_InputRecorder.Close();
+    }
+    m_InputReplay.Close();
+    Super::EndPlay(EndPlayReason);
+}
+
+/**
+* Reads what this frame gets from the window and the input devices into m_InputFrame.
+*/
+void AGM_Winter::ReadInputFrame(float DeltaSeconds)
 {
+    m_InputFrame.DeltaSeconds = DeltaSeconds;
+    ReadStylusInputs();
+    PlayerController->GetViewportSize(m_InputFrame.ViewportSize.X, m_InputFrame.ViewportSize.Y);
+    m_InputFrame.MousePosition = UWidgetLayoutLibrary::GetMousePositionOnViewport(m_World);
+}
+
+/**
+* Handles the key events of the next frame of the input log and reads the frame into
+* m_InputFrame. At the end of the log the live input takes over, or the game quits.
+* @return False at the end of the log.
+*/
+bool AGM_Winter::ReplayInputFrame()
+{
+    m_ReplayEvents.Reset();
+    if (!m_InputReplay.ReadFrame(m_ReplayEvents, m_InputFrame)) {
+        UE_LOG(LogTemp, Log, TEXT("Replayed %d frames of input in %.3f s."),
+            m_InputReplay.GetNumFrames(), FPlatformTime::Seconds() - m_ReplayStartSeconds);
+        m_InputReplay.Close();
+        if (QuitAfterReplay)
+            UKismetSystemLibrary::QuitGame(m_World, PlayerController, EQuitPreference::Quit, false);
+
+        // The live mouse button isn't down, whatever the log ended with
+        if (m_FingerPressed)
+            HandleInputEvent({EInputLogEvent::FingerReleased, m_InputFrame.MousePosition});
+        return false;
+    }
+
+    for (const InputEvent& Event : m_ReplayEvents)
+        HandleInputEvent(Event);
+    return true;
+}
+
+void AGM_Winter::ReadStylusInputs()
+{
+    DROP_SCOPE(DropStylusInput);
+    m_InputFrame.HasStylusPressure = false;
+    m_InputFrame.StylusSamples.Reset();
     if (m_StylusInputInterface.IsValid())
     {
         m_StylusInputInterface->Tick();
@@ -149,64 +263,134 @@ void AGM_Winter::TickStylusInputs()
                 // In most case there's only one or no stylus.
                 if (InputDevice->GetCurrentState().IsStylusDown() && 
                     InputDevice->GetCurrentState().GetPressure() > 0) {
-                    m_LastStylusPressure = m_StylusPressure;
-                    m_StylusPressure = InputDevice->GetCurrentState().GetPressure();
+                    m_InputFrame.HasStylusPressure = true;
+                    m_InputFrame.StylusPressure = InputDevice->GetCurrentState().GetPressure();
                 }
             }
+
+            // Every packet since the last frame, not only the latest state
+            InputDevice->PopSamples(m_InputFrame.StylusSamples);
         }
     }
+
+    // A pen in the air doesn't draw
+    m_InputFrame.StylusSamples.RemoveAll([](const FStylusSample& Sample) {
+        return !Sample.IsDown || Sample.Pressure <= 0;
+    });
+
+    // Samples come in device independent pixels, the finger in viewport local space, which is
+    // pixels over the viewport scale. Only their scale matters, the stroke is moved onto the finger.
+    float DPIScale = 1.0f;
+    UGameViewportClient* GameViewport = m_World->GetGameViewport();
+    TSharedPtr<SWindow> Window = GameViewport ? GameViewport->GetWindow() : nullptr;
+    if (Window.IsValid())
+        DPIScale = Window->GetDPIScaleFactor();
+    const float ToViewportSpace = DPIScale / m_ViewportScale;
+    for (FStylusSample& Sample : m_InputFrame.StylusSamples)
+        Sample.Position *= ToViewportSpace;
+}
+
+void AGM_Winter::TickStylusInputs()
+{
+    if (m_InputFrame.HasStylusPressure)
+        m_StylusPressure = m_InputFrame.StylusPressure;
+    if (m_InputFrame.StylusSamples.Num() > 0) {
+        m_StylusSamples.Append(m_InputFrame.StylusSamples);
+        m_StylusPressure = m_StylusSamples.Last().Pressure;
+    }
+    // Kept until the finger moves far enough to draw them
+    if (!m_FingerPressed)
+        m_StylusSamples.Reset();
 }
 
 
 void AGM_Winter::FingerPressed()
 {
-    m_FingerPressed = true;
-    m_JustPressed = true;
-    m_LastPosition = UWidgetLayoutLibrary::GetMousePositionOnViewport(m_World);
+    OnInputEvent(EInputLogEvent::FingerPressed);
 }
 
 void AGM_Winter::FingerReleased()
 {
-    m_FingerPressed = false;
+    OnInputEvent(EInputLogEvent::FingerReleased);
+}
+
+void AGM_Winter::BigDropPressed()
+{
+    OnInputEvent(EInputLogEvent::BigDrop);
+}
+
+/**
+* A key event from the input devices: records it, then handles it like a replayed one.
+* Ignored while a log is replaying, the log has the keys of its own.
+*/
+void AGM_Winter::OnInputEvent(EInputLogEvent Type)
+{
+    if (m_InputReplay.IsOpen())
+        return;
 
-    ActivateDrops(FVector2D(-100.0f, 0.0f), 0.0f);
+    InputEvent Event;
+    Event.Type = Type;
+    Event.MousePosition = UWidgetLayoutLibrary::GetMousePositionOnViewport(m_World);
+    if (m_InputRecorder.IsOpen())
+        m_InputRecorder.RecordEvent(Event);
+    HandleInputEvent(Event);
 }
 
-void AGM_Winter::PutBigDrop()
+void AGM_Winter::HandleInputEvent(const InputEvent& Event)
+{
+    switch (Event.Type) {
+    case EInputLogEvent::FingerPressed:
+        m_FingerPressed = true;
+        m_JustPressed = true;
+        m_LastPosition = Event.MousePosition;
+        m_LastStylusPressure = m_StylusPressure;
+        m_StylusSamples.Reset();
+        break;
+    case EInputLogEvent::FingerReleased:
+        m_FingerPressed = false;
+        ActivateDrops(FVector2D(-100.0f, 0.0f), 0.0f);
+        break;
+    case EInputLogEvent::BigDrop:
+        PutBigDrop(Event.MousePosition);
+        break;
+    default:
+        break;
+    }
+}
+
+void AGM_Winter::PutBigDrop(const FVector2D& Pos)
 {
-    FVector2D Pos = UWidgetLayoutLibrary::GetMousePositionOnViewport(m_World);
     FVector2D Pos_RT = Pos * m_RenderTargetSize * m_ViewFactor;
     EmitDrop(
         Pos_RT, kDropEmitChanceStrokeEnd,
         kDropEmitRadiusMinStrokeEnd, kDropEmitRadiusMaxStrokeEnd,
-        kDropEmitRadiusExpStrokeEnd,
-        m_World->GetTimeSeconds()
+        kEmitRadiusCurveStrokeEnd,
+        m_DropPipeline.GetTimeSeconds()
     );
 }
 
 
-TSet<int> AGM_Winter::SimDrops(float DeltaSeconds)
+void AGM_Winter::SimDrops(float DeltaSeconds)
 {
-    return m_DropSystem.Tick(DeltaSeconds, m_RenderTargetSize);
+    m_DropPipeline.Advance(DeltaSeconds, m_RenderTargetSize);
 }
 
 
-void AGM_Winter::DrawDrops(const TSet<int>& MovedIDs)
+void AGM_Winter::DrawDrops()
 {
-    TSet<int> ShrinkingIDs = m_DropSystem.GetShrinkingIDs();
-    m_DropSystem.Draw(
-        RT_Drops, RT_MovedDrops, T_Raindrop, m_ViewportRatio,
-        MovedIDs.Union(ShrinkingIDs)
-    );
+    m_DropPipeline.Draw(RT_Drops, RT_MovedDrops, T_Raindrop, m_ViewportRatio);
 }
 
 
 /**
 * Get called when finger pressed and moved on screen.
+* Stamps the brush along the stroke path, evenly spaced, with the pressure of the path where
+* each stamp lands. Without stylus samples the path is the straight move of the finger.
 * @param FingerPos - Position of finger in viewport local space.
 */
 void AGM_Winter::OnMouseMove(const FVector2D& FingerPos)
 {
+    DROP_SCOPE(DropStroke);
     UCanvas* Canvas;
     FVector2D CanvasSize;
     FDrawToRenderTargetContext Context;
@@ -214,46 +398,129 @@ void AGM_Winter::OnMouseMove(const FVector2D& FingerPos)
     UKismetRenderingLibrary::BeginDrawCanvasToRenderTarget(
         m_World, RT_Strokes, Canvas, CanvasSize, Context
     );
-    FVector2D ActiveLocation_RTSpace = CanvasSize * m_ViewFactor * FingerPos;
-    ActivateDrops(ActiveLocation_RTSpace, kFingerSizeRT * 0.5);
-
-    FVector2D Diff = FingerPos - m_LastPosition;
-    float MovedLength = Diff.Size();
+    BuildStrokePath(FingerPos);
+    const FVector2D ToRTSpace = CanvasSize * m_ViewFactor;
+    m_StrokePathRT.Reset();
+    for (const FVector2D& Point : m_StrokePath)
+        m_StrokePathRT.Add(ToRTSpace * Point);
+    m_DropPipeline.MarkDropsOutsideFinger(m_StrokePathRT, kFingerSizeRT * 0.5);
+
+    float MovedLength = m_StrokeDistances.Last();
     int NSteps = FMath::RoundToInt(MovedLength / kBrushSpace);
     NSteps = FMath::Max(1, NSteps);
     
     FVector2D DrawPos_RTSpace;
     FVector2D DrawPos_ViewportSpace;
-    FVector2D ScreenPos;
     FVector2D Size2D_RT;
     float StepDistance = MovedLength / NSteps;
     float Pressure, SizePressureFactor;
-    FVector2D StepVec = Diff.GetSafeNormal() * StepDistance;
+    int Segment = 0;
+
+    // The stamps on one path segment are evenly spaced on a line, so one stepped capsule
+    // kills what they cover. Drops just emitted are not initialized yet and survive it like
+    // they survived the kills of later steps.
+    const float ContactFactor = 0.55;
+    const float ContactRadius = kFingerSizeRT * 0.5 * ContactFactor;
+    int RunSegment = 0;
+    int RunSteps = -1;
+    FVector2D RunFirst_RTSpace;
     for (int i = 1; i <= NSteps + 1; ++i) {
-        DrawPos_ViewportSpace = i * StepVec + m_LastPosition;
-        DrawPos_RTSpace = CanvasSize * m_ViewFactor * DrawPos_ViewportSpace;
+        // The last stamp is a step past the finger, on along the last segment
+        float Distance = i * StepDistance;
+        while (Segment + 2 < m_StrokePath.Num() && Distance > m_StrokeDistances[Segment + 1])
+            ++Segment;
+        float SegmentLength = m_StrokeDistances[Segment + 1] - m_StrokeDistances[Segment];
+        float Alpha = SegmentLength > 0 ? (Distance - m_StrokeDistances[Segment]) / SegmentLength : 1.0f;
+
+        DrawPos_ViewportSpace = FMath::Lerp(m_StrokePath[Segment], m_StrokePath[Segment + 1], Alpha);
+        if (RunSteps >= 0 && Segment != RunSegment) {
+            m_DropPipeline.Kill(RunFirst_RTSpace, DrawPos_RTSpace, ContactRadius, ContactRadius, RunSteps);
+            RunSteps = -1;
+        }
+        DrawPos_RTSpace = ToRTSpace * DrawPos_ViewportSpace;
+        if (RunSteps < 0) {
+            RunSegment = Segment;
+            RunFirst_RTSpace = DrawPos_RTSpace;
+        }
+        ++RunSteps;
         EmitDrop(
             DrawPos_RTSpace, kDropEmitChanceDefault, kDropEmitRadiusMinDefault,
-            kDropEmitRadiusMaxDefault, kDropEmitRadiusExpDefault
+            kDropEmitRadiusMaxDefault, kEmitRadiusCurveDefault
         );
-        Pressure = FMath::Lerp(m_LastStylusPressure, m_StylusPressure, (float)(i) / NSteps);
-        SizePressureFactor = 0.3 + FMath::Pow(Pressure, 0.7) * 1.5;
+        Pressure = FMath::Lerp(m_StrokePressures[Segment], m_StrokePressures[Segment + 1], Alpha);
+        SizePressureFactor = 0.3 + kPressureCurve.Evaluate(Pressure) * 1.5;
 
         Size2D_RT = FVector2D(
             kFingerSizeRT * SizePressureFactor,
             kFingerSizeRT * m_ViewportRatio * SizePressureFactor
         );
-        ScreenPos = DrawPos_RTSpace - Size2D_RT * 0.5;
+        DropQuad& Stamp = m_StrokeStamps.AddDefaulted_GetRef();
+        Stamp.Position = DrawPos_RTSpace - Size2D_RT * 0.5;
+        Stamp.Size = Size2D_RT;
+    }
+    m_DropPipeline.Kill(RunFirst_RTSpace, DrawPos_RTSpace, ContactRadius, ContactRadius, RunSteps);
+    DrawStrokeStamps(Canvas);
+    m_LastStylusPressure = m_StylusPressure;
+
+    UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(m_World, Context);
+}
 
-        Canvas->K2_DrawMaterial(
-            M_Brush, ScreenPos, Size2D_RT, FVector2D(0.0, 0.0)
-        );
 
-        const float ContactFactor = 0.55;
-        m_DropSystem.Kill(DrawPos_RTSpace, kFingerSizeRT * 0.5 * ContactFactor);
+/**
+* The path of a stroke update, from where the last one ended through the stylus samples
+* since to the finger. The samples, scaled to viewport local space as they were read, are
+* placed relative to the newest one, which is where the finger is now, so only their shape
+* counts and not where the tablet thinks the window is.
+* @param FingerPos - Position of finger in viewport local space.
+*/
+void AGM_Winter::BuildStrokePath(const FVector2D& FingerPos)
+{
+    m_StrokePath.Reset();
+    m_StrokePressures.Reset();
+    m_StrokePath.Add(m_LastPosition);
+    m_StrokePressures.Add(m_LastStylusPressure);
+    if (m_StylusSamples.Num() > 0) {
+        FVector2D Offset = FingerPos - m_StylusSamples.Last().Position;
+        for (int i = 0; i + 1 < m_StylusSamples.Num(); ++i) {
+            m_StrokePath.Add(m_StylusSamples[i].Position + Offset);
+            m_StrokePressures.Add(m_StylusSamples[i].Pressure);
+        }
+        m_StylusSamples.Reset();
+    }
+    m_StrokePath.Add(FingerPos);
+    m_StrokePressures.Add(m_StylusPressure);
+
+    m_StrokeDistances.Reset();
+    m_StrokeDistances.Add(0.0f);
+    for (int Point = 1; Point < m_StrokePath.Num(); ++Point) {
+        m_StrokeDistances.Add(
+            m_StrokeDistances.Last() + FVector2D::Distance(m_StrokePath[Point - 1], m_StrokePath[Point])
+        );
     }
+}
 
-    UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(m_World, Context);
+
+/**
+* Draws the brush stamps of a stroke update in their order, as one material triangle list
+* or, without BatchedStrokes, as one material draw each.
+*/
+void AGM_Winter::DrawStrokeStamps(UCanvas* Canvas)
+{
+    if (BatchedStrokes) {
+        DropSystem::BuildTriangles(m_StrokeStamps, m_StrokeTriangles);
+        Canvas->K2_DrawMaterialTriangle(M_Brush, m_StrokeTriangles);
+        INC_DROP_STAT(NumStrokeDraws, 1);
+    }
+    else {
+        for (const DropQuad& Stamp : m_StrokeStamps) {
+            Canvas->K2_DrawMaterial(
+                M_Brush, Stamp.Position, Stamp.Size, FVector2D(0.0, 0.0)
+            );
+        }
+        INC_DROP_STAT(NumStrokeDraws, m_StrokeStamps.Num());
+    }
+    INC_DROP_STAT(NumStrokeStamps, m_StrokeStamps.Num());
+    m_StrokeStamps.Reset();
 }
 
 
@@ -264,24 +531,21 @@ void AGM_Winter::OnMouseMove(const FVector2D& FingerPos)
 */
 void AGM_Winter::ActivateDrops(const FVector2D& Center, float Radius)
 {
-    m_DropSystem.MarkDropsOutsideFinger(Center, Radius);
+    m_DropPipeline.MarkDropsOutsideFinger(Center, Radius);
 }
 
 void AGM_Winter::EmitDrop(
-    const FVector2D& Pos_RT, float Chance, float RadiusMin, float RadiusMax, float RadiusExp,
+    const FVector2D& Pos_RT, float Chance, float RadiusMin, float RadiusMax, const DropCurve<>& RadiusCurve,
     float BirthTime
 )
 {
-    float Dice = FMath::RandRange(0.0f, 1.0f);
+    float Dice = m_EmitRandom.GetUnit();
     if (Dice >= Chance)
         return;
 
-    float Radius = FMath::GetMappedRangeValueUnclamped(
-        FVector2D(0.0f, 1.0f), FVector2D(RadiusMin, RadiusMax),
-        FMath::Pow(FMath::RandRange(0.0f, 1.0f), RadiusExp)
-    );
+    float Radius = RadiusCurve.Sample(m_EmitRandom.GetUnit(), RadiusMin, RadiusMax);
 
-    m_DropSystem.Emit(
+    m_DropPipeline.Emit(
         Pos_RT, FVector2D(0.0, 0.0), FVector2D(0.0, 0.0), Radius, BirthTime
     );
 }
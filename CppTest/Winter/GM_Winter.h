@@ -6,7 +6,10 @@
 #include "GameFramework/GameModeBase.h"
 
 #include "DropSystem.h"
-#include "StylusInput/WindowsStylusInputInterface.h"
+#include "DropPipeline.h"
+#include "DropCurve.h"
+#include "InputLog.h"
+#include "StylusInput/IStylusState.h"
 
 
 #include "GM_Winter.generated.h"
@@ -31,28 +34,62 @@ class CPPTEST_API AGM_Winter : public AGameModeBase
         UTexture* T_Raindrop;
     UPROPERTY(EditAnywhere)
         float DropRadiusRenderFactor = 10;
+    UPROPERTY(EditAnywhere)
+        int SimulationWorkerThreads = 0;        // 0 uses all workers, 1 simulates on the game thread
+    UPROPERTY(EditAnywhere)
+        int SimulationMinBatchSize = 4096;      // Drops per worker batch at least
+    UPROPERTY(EditAnywhere)
+        float SimulationFixedStepHz = 0.0f;     // 0 ticks the drops once per frame
+    UPROPERTY(EditAnywhere)
+        int SimulationMaxSubSteps = 4;          // Fixed steps per frame at most, the rest is dropped
+    UPROPERTY(EditAnywhere)
+        int SimulationMaxDrops = 0;             // 0 keeps every drop, else the least visible ones go first
+    UPROPERTY(EditAnywhere)
+        float SimulationTargetTickMs = 0.0f;    // 0 keeps every drop, else evicts to stay within it
+    UPROPERTY(EditAnywhere)
+        int RandomSeed = 0;                     // Same seed and input, same drops
+    UPROPERTY(EditAnywhere)
+        bool SimulationPipelined = false;       // Simulates the next frame on a worker while this one draws, a frame late
+    UPROPERTY(EditAnywhere)
+        bool BatchedStrokes = true;             // False draws every brush stamp as its own material draw
+    UPROPERTY(EditAnywhere)
+        FString InputRecordPath;                // Records the input of the session there, "-inputrecord=<path>" too
+    UPROPERTY(EditAnywhere)
+        FString InputReplayPath;                // Plays the input from there instead of the devices, "-inputreplay=<path>" too
+    UPROPERTY(EditAnywhere)
+        bool QuitAfterReplay = true;
 
 public:
     AGM_Winter();
 
     void StartPlay() override;
     void Tick(float DeltaSeconds) override;
+    void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     void TickStylusInputs();
     void FingerPressed();
     void FingerReleased();
+    void BigDropPressed();
 
     APlayerController* PlayerController;
 
 private:
-    void PutBigDrop();
-    TSet<int> SimDrops(float DeltaSeconds);
-    void DrawDrops(const TSet<int>& MovedIDs);
+    void StartInputLog();
+    void ReadInputFrame(float DeltaSeconds);
+    bool ReplayInputFrame();
+    void ReadStylusInputs();
+    void OnInputEvent(EInputLogEvent Type);
+    void HandleInputEvent(const InputEvent& Event);
+    void PutBigDrop(const FVector2D& Pos);
+    void SimDrops(float DeltaSeconds);
+    void DrawDrops();
     void OnMouseMove(const FVector2D& FingerPos);
+    void BuildStrokePath(const FVector2D& FingerPos);
+    void DrawStrokeStamps(UCanvas* Canvas);
     void ActivateDrops(const FVector2D& Center, float Radius);
 
     void EmitDrop(
         const FVector2D& Pos_RT, float Chance,
-        float RadiusMin, float RadiusMax, float RadiusExp,
+        float RadiusMin, float RadiusMax, const DropCurve<>& RadiusCurve,
         float BirthTime = kBirthTimeNotInitialized
     );
     void CleanDropsAtPos(const FVector2D& Pos_RT, float Size);
@@ -62,11 +99,24 @@ private:
     float m_ViewportRatio;
     float m_StylusPressure;
     FVector2D m_ViewFactor;  // ViewportScale / ViewportSize, updated every tick.
-    float m_LastStylusPressure;
+    float m_LastStylusPressure;  // Where the last stroke update ended
     bool m_FingerPressed;
     bool m_JustPressed;
     FVector2D m_LastPosition;  //in viewport local space
-    DropSystem m_DropSystem;
+    DropPipeline m_DropPipeline;
+    DropRandomSequence m_EmitRandom;
     FVector2D m_RenderTargetSize;
-    TSharedPtr<FWindowsStylusInputInterface> m_StylusInputInterface;
+    TArray<FStylusSample> m_StylusSamples;  // Pen down since the last stroke update, oldest first
+    TArray<FVector2D> m_StrokePath;         // Viewport space, from m_LastPosition through the samples to the finger
+    TArray<FVector2D> m_StrokePathRT;       // m_StrokePath in RenderTarget space
+    TArray<float> m_StrokePressures;        // At the points of m_StrokePath
+    TArray<float> m_StrokeDistances;        // Along m_StrokePath to its points
+    TArray<DropQuad> m_StrokeStamps;        // Brush stamps of the stroke update being drawn
+    TArray<FCanvasUVTri> m_StrokeTriangles;
+    TSharedPtr<IStylusInputInterface> m_StylusInputInterface;
+    InputFrame m_InputFrame;                // What this frame read from the devices or the log
+    InputRecorder m_InputRecorder;
+    InputReplay m_InputReplay;
+    TArray<InputEvent> m_ReplayEvents;
+    double m_ReplayStartSeconds = 0.0;
 };
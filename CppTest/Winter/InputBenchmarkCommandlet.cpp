@@ -0,0 +1,736 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "Winter/InputBenchmarkCommandlet.h"
+
+#include "DropRandom.h"
+#include "InputLog.h"
+#include "StylusInput/EvdevStylusInputDevice.h"
+#include "StylusInput/StylusPacketDecoder.h"
+#include "StylusInput/StylusSampleQueue.h"
+#include "Common.h"
+
+#include <Async/Async.h>
+#include <HAL/FileManager.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogInputBenchmark, Log, All);
+
+const double kBenchmarkStylusHz = 200.0;
+const int kBenchmarkStylusOverflow = 10;         // Samples pushed into a full queue
+const int kBenchmarkStylusMaxBatch = 8;          // Packets per RealTimeStylus callback at most
+const int kBenchmarkStylusDecodeRuns = 5;
+const float kBenchmarkStylusTolerance = 1e-6f;  // Relative
+const int kBenchmarkInputLogSeed = 77;
+const int kBenchmarkInputLogCut = 3;             // Bytes cut off the end of a log
+const int kBenchmarkEvdevStrokeReports = 400;   // Pen down this long, then up a fifth of it
+const int kBenchmarkEvdevDropEvery = 1000;      // Reports, the kernel drops one of them
+const FVector2D kBenchmarkEvdevScreenExtent(1920.0f, 1080.0f);  // Not the aspect of the tablet
+
+
+UInputBenchmarkCommandlet::UInputBenchmarkCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 UInputBenchmarkCommandlet::Main(const FString& Params)
+{
+    bool Succeeded = true;
+    Succeeded &= CheckStylusSampleQueue(1000000);
+    Succeeded &= CheckStylusPacketDecoder(1 << 20);
+    Succeeded &= CheckEvdevStylus(1 << 18);
+    Succeeded &= CheckEvdevResync(100);
+    Succeeded &= CheckInputLog(36000);
+    return Succeeded ? 0 : 1;
+}
+
+
+static FStylusSample MakeSyntheticSample(int Index)
+{
+    FStylusSample Sample;
+    Sample.TimeSeconds = Index / kBenchmarkStylusHz;
+    Sample.Position = FVector2D(Index * 0.5f, Index % 1000 * 0.25f);
+    Sample.Pressure = Index % 1000 / 1000.0f;
+    Sample.Tilt = FVector2D(Index % 90, -(Index % 45));
+    Sample.IsDown = true;
+    return Sample;
+}
+
+/*
+* Pushes synthetic samples through the stylus sample queue from a producer thread, as the
+* stylus thread does, while this thread pops them like the game thread. Fails if a sample is
+* lost, duplicated or reordered other than the ones Push reported dropped.
+*/
+bool UInputBenchmarkCommandlet::CheckStylusSampleQueue(int NumSamples)
+{
+    FStylusSampleQueue Queue;
+
+    // Without a consumer the queue fills up and drops the rest
+    for (int i = 0; i < (int)Queue.GetCapacity() + kBenchmarkStylusOverflow; ++i)
+        Queue.Push(MakeSyntheticSample(i));
+    TArray<FStylusSample> Samples;
+    if (Queue.PopAll(Samples) != (int)Queue.GetCapacity() || Queue.GetNumDropped() != kBenchmarkStylusOverflow
+        || Samples.Last().TimeSeconds != MakeSyntheticSample(Queue.GetCapacity() - 1).TimeSeconds) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Full stylus sample queue kept %d samples and dropped %u."),
+            Samples.Num(), Queue.GetNumDropped());
+        return false;
+    }
+    uint32 NumDroppedBefore = Queue.GetNumDropped();
+
+    // The producer retries what the queue drops, so every sample has to come through
+    double StartSeconds = FPlatformTime::Seconds();
+    TFuture<int> Producer = Async(EAsyncExecution::Thread, [&Queue, NumSamples]() {
+        int NumRetries = 0;
+        for (int i = 0; i < NumSamples; ++i) {
+            while (!Queue.Push(MakeSyntheticSample(i))) {
+                ++NumRetries;
+                FPlatformProcess::Yield();
+            }
+        }
+        return NumRetries;
+    });
+
+    int NumPopped = 0, NumPops = 0;
+    while (NumPopped < NumSamples) {
+        Samples.Reset();
+        if (Queue.PopAll(Samples) == 0) {
+            FPlatformProcess::Yield();
+            continue;
+        }
+        ++NumPops;
+        for (const FStylusSample& Sample : Samples) {
+            FStylusSample Expected = MakeSyntheticSample(NumPopped);
+            if (Sample.TimeSeconds != Expected.TimeSeconds || Sample.Position != Expected.Position
+                || Sample.Pressure != Expected.Pressure || Sample.Tilt != Expected.Tilt) {
+                UE_LOG(LogInputBenchmark, Error, TEXT("Stylus sample %d came out of the queue as sample %d."),
+                    FMath::RoundToInt(Sample.TimeSeconds * kBenchmarkStylusHz), NumPopped);
+                Producer.Wait();
+                return false;
+            }
+            ++NumPopped;
+        }
+    }
+    int NumRetries = Producer.Get();
+    double Seconds = FPlatformTime::Seconds() - StartSeconds;
+
+    if (Queue.GetNumDropped() - NumDroppedBefore != (uint32)NumRetries) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Stylus sample queue counted %u dropped samples, the producer %d."),
+            Queue.GetNumDropped() - NumDroppedBefore, NumRetries);
+        return false;
+    }
+    UE_LOG(LogInputBenchmark, Display,
+        TEXT("Stylus sample queue %d samples across threads: %.1f M samples/s, %.1f samples per pop, %d pushes retried"),
+        NumSamples, NumSamples / Seconds / 1e6, (double)NumSamples / NumPops, NumRetries);
+    return true;
+}
+
+// Packet layout of a pen tablet as RealTimeStylus describes it: HIMETRIC position, 8192 pressure
+// levels, tilt and twist in tenths of degrees, and a status it doesn't decode.
+static TArray<FPacketDescription> MakePenPacketDescriptions(bool WithOrientation)
+{
+    TArray<FPacketDescription> Descriptions;
+    auto AddDescription = [&Descriptions](EWindowsPacketType Type, int32 Minimum, int32 Maximum, float Resolution) {
+        FPacketDescription& Description = Descriptions.AddDefaulted_GetRef();
+        Description.Type = Type;
+        Description.Minimum = Minimum;
+        Description.Maximum = Maximum;
+        Description.Resolution = Resolution;
+    };
+    AddDescription(EWindowsPacketType::X, 0, 44704, 1000.0f);
+    AddDescription(EWindowsPacketType::Y, 0, 27940, 1000.0f);
+    AddDescription(EWindowsPacketType::Status, 0, 0, 0.0f);
+    AddDescription(EWindowsPacketType::NormalPressure, 0, 8191, 0.0f);
+    if (WithOrientation) {
+        AddDescription(EWindowsPacketType::XTilt, -900, 900, 10.0f);
+        AddDescription(EWindowsPacketType::YTilt, -900, 900, 10.0f);
+        AddDescription(EWindowsPacketType::Twist, 0, 3599, 10.0f);
+    }
+    return Descriptions;
+}
+
+// A spiral drawn at 200 Hz with the pressure and tilt swinging, as the tablet would send it.
+static void MakePenPackets(const TArray<FPacketDescription>& Descriptions, int NumPackets, TArray<int32>& OutPackets)
+{
+    OutPackets.SetNumUninitialized(NumPackets * Descriptions.Num());
+    for (int i = 0; i < NumPackets; ++i) {
+        float Angle = i / kBenchmarkStylusHz * 2.0f;
+        float Radius = 2000.0f + (i % 4000);
+        for (int Property = 0; Property < Descriptions.Num(); ++Property) {
+            int32 Value = 0;
+            switch (Descriptions[Property].Type) {
+            case EWindowsPacketType::X: Value = 22000 + FMath::RoundToInt(Radius * FMath::Cos(Angle)); break;
+            case EWindowsPacketType::Y: Value = 14000 + FMath::RoundToInt(Radius * FMath::Sin(Angle)); break;
+            case EWindowsPacketType::Status: Value = 1; break;
+            case EWindowsPacketType::NormalPressure: Value = FMath::RoundToInt(4095.0f + 4095.0f * FMath::Sin(Angle * 3.0f)); break;
+            case EWindowsPacketType::XTilt: Value = FMath::RoundToInt(600.0f * FMath::Cos(Angle * 0.5f)); break;
+            case EWindowsPacketType::YTilt: Value = FMath::RoundToInt(-400.0f * FMath::Sin(Angle * 0.5f)); break;
+            case EWindowsPacketType::Twist: Value = i % 3600; break;
+            default: break;
+            }
+            OutPackets[i * Descriptions.Num() + Property] = Value;
+        }
+    }
+}
+
+// One packet the way HandlePacket decoded it before the plan, a switch per property.
+static void DecodePenPacketBySwitch(const TArray<FPacketDescription>& Descriptions, const int32* Packet, FWindowsStylusState& State)
+{
+    for (int Property = 0; Property < Descriptions.Num(); ++Property) {
+        const FPacketDescription& Description = Descriptions[Property];
+        float Normalized = (float)(Packet[Property] - Description.Minimum) / (float)(Description.Maximum - Description.Minimum);
+        switch (Description.Type) {
+        case EWindowsPacketType::X: State.Position.X = Packet[Property]; break;
+        case EWindowsPacketType::Y: State.Position.Y = Packet[Property]; break;
+        case EWindowsPacketType::Z: State.Z = Normalized; break;
+        case EWindowsPacketType::NormalPressure: State.NormalPressure = Normalized; break;
+        case EWindowsPacketType::TangentPressure: State.TangentPressure = Normalized; break;
+        case EWindowsPacketType::Twist: State.Twist = Packet[Property] / Description.Resolution; break;
+        case EWindowsPacketType::XTilt: State.Tilt.X = Packet[Property] / Description.Resolution; break;
+        case EWindowsPacketType::YTilt: State.Tilt.Y = Packet[Property] / Description.Resolution; break;
+        case EWindowsPacketType::Width: State.Size.X = Normalized; break;
+        case EWindowsPacketType::Height: State.Size.Y = Normalized; break;
+        default: break;
+        }
+    }
+}
+
+// The plan multiplies by reciprocals where the switch divides, the last bits may differ.
+static bool PenValuesMatch(float A, float B)
+{
+    return FMath::IsNearlyEqual(A, B, kBenchmarkStylusTolerance * FMath::Max(1.0f, FMath::Abs(B)));
+}
+
+static bool PenStatesMatch(const FWindowsStylusState& A, const FWindowsStylusState& B)
+{
+    return A.Position == B.Position && PenValuesMatch(A.NormalPressure, B.NormalPressure)
+        && PenValuesMatch(A.Tilt.X, B.Tilt.X) && PenValuesMatch(A.Tilt.Y, B.Tilt.Y) && PenValuesMatch(A.Twist, B.Twist);
+}
+
+/*
+* Feeds pen packet buffers, in batches of up to kBenchmarkStylusMaxBatch packets like the
+* callbacks get them, through the stylus packet decoder. Fails unless it reports every packet
+* as the per-property switch decodes it, and keeps the orientation of the packets before
+* when the tablet doesn't send one. Then times both decoders over the same buffers.
+*/
+bool UInputBenchmarkCommandlet::CheckStylusPacketDecoder(int NumPackets)
+{
+    for (bool WithOrientation : {true, false}) {
+        TArray<FPacketDescription> Descriptions = MakePenPacketDescriptions(WithOrientation);
+        TArray<int32> Packets;
+        MakePenPackets(Descriptions, NumPackets, Packets);
+        FStylusPacketDecoder Decoder;
+        Decoder.Setup(Descriptions);
+
+        FWindowsStylusState Start;
+        Start.Tilt = FVector2D(12.5f, -3.0f);
+        Start.Twist = 90.0f;
+        FWindowsStylusState Decoded = Start, Expected = Start;
+        int NumDecoded = 0, NumReported = 0, NumMismatches = 0;
+        for (int First = 0, Batch = 1; First < NumPackets; First += Batch, Batch = Batch % kBenchmarkStylusMaxBatch + 1) {
+            NumDecoded += Decoder.Decode(&Packets[First * Descriptions.Num()], FMath::Min(Batch, NumPackets - First),
+                Descriptions.Num(), Decoded, [&](const FWindowsStylusState& State) {
+                    DecodePenPacketBySwitch(Descriptions, &Packets[NumReported * Descriptions.Num()], Expected);
+                    NumMismatches += PenStatesMatch(State, Expected) ? 0 : 1;
+                    ++NumReported;
+                });
+        }
+        if (NumDecoded != NumPackets || NumReported != NumPackets || NumMismatches > 0) {
+            UE_LOG(LogInputBenchmark, Error, TEXT("Stylus packet decoder reported %d of %d packets, %d of them unlike the switch."),
+                NumReported, NumPackets, NumMismatches);
+            return false;
+        }
+        if (Decoder.Decode(Packets.GetData(), 1, Descriptions.Num() + 1, Decoded, [](const FWindowsStylusState&) {}) != 0) {
+            UE_LOG(LogInputBenchmark, Error, TEXT("Stylus packet decoder took packets of another layout."));
+            return false;
+        }
+
+        double DecoderSeconds = 0.0, SwitchSeconds = 0.0;
+        float Sum = 0.0f;
+        for (int Run = 0; Run < kBenchmarkStylusDecodeRuns; ++Run) {
+            double StartSeconds = FPlatformTime::Seconds();
+            for (int First = 0; First < NumPackets; First += kBenchmarkStylusMaxBatch) {
+                Decoder.Decode(&Packets[First * Descriptions.Num()], FMath::Min(kBenchmarkStylusMaxBatch, NumPackets - First),
+                    Descriptions.Num(), Decoded, [&Sum](const FWindowsStylusState& State) { Sum += State.NormalPressure; });
+            }
+            DecoderSeconds += FPlatformTime::Seconds() - StartSeconds;
+
+            StartSeconds = FPlatformTime::Seconds();
+            for (int i = 0; i < NumPackets; ++i) {
+                DecodePenPacketBySwitch(Descriptions, &Packets[i * Descriptions.Num()], Expected);
+                Sum += Expected.NormalPressure;
+            }
+            SwitchSeconds += FPlatformTime::Seconds() - StartSeconds;
+        }
+        double NanosecondsPerPacket = 1e9 / ((double)NumPackets * kBenchmarkStylusDecodeRuns);
+        UE_LOG(LogInputBenchmark, Display,
+            TEXT("Stylus packets of %d properties: plan %.2f ns, switch %.2f ns per packet (sum %.0f)"),
+            Descriptions.Num(), DecoderSeconds * NanosecondsPerPacket, SwitchSeconds * NanosecondsPerPacket, Sum);
+    }
+    return true;
+}
+
+// Axes of a pen tablet as evdev describes it: 200 units per mm, 8192 pressure levels, tilt in units of a radian / 57.
+struct EvdevPenAxis
+{
+    uint16 Code;
+    FEvdevAxisInfo Info;
+};
+
+static const EvdevPenAxis kBenchmarkEvdevAxes[] = {
+    {EvdevCode::AbsX, {0, 44704, 200}},
+    {EvdevCode::AbsY, {0, 27940, 200}},
+    {EvdevCode::AbsPressure, {0, 8191, 0}},
+    {EvdevCode::AbsTiltX, {-64, 63, 57}},
+    {EvdevCode::AbsTiltY, {-64, 63, 57}},
+};
+
+static void AddEvdevEvent(TArray<FEvdevRawEvent>& Events, double TimeSeconds, uint16 Type, uint16 Code, int32 Value)
+{
+    int64 Microseconds = (int64)(TimeSeconds * 1e6);
+    Events.Add({Microseconds / 1000000, Microseconds % 1000000, Type, Code, Value});
+}
+
+/*
+* The spiral of MakePenPackets as a pen sends it through evdev, an event per axis and a
+* SYN_REPORT per report, lifted between strokes. Tilt only comes with every third report,
+* and every kBenchmarkEvdevDropEvery-th report the kernel drops. `OutExpected` are the
+* reports the decoder should make of it, in pixels of kBenchmarkEvdevScreenExtent, [0, 1] and
+* degrees, computed in double.
+*/
+static void MakeEvdevCapture(int NumReports, TArray<FEvdevRawEvent>& OutEvents, TArray<FStylusSample>& OutExpected)
+{
+    const double PixelsPerUnitX = (double)kBenchmarkEvdevScreenExtent.X / kBenchmarkEvdevAxes[0].Info.Maximum;
+    const double PixelsPerUnitY = (double)kBenchmarkEvdevScreenExtent.Y / kBenchmarkEvdevAxes[1].Info.Maximum;
+    const double DegreesPerUnit = 180.0 / PI / 57.0;
+    FStylusSample Expected;
+    bool IsDown = false;
+    AddEvdevEvent(OutEvents, 0.0, EvdevCode::EvKey, EvdevCode::BtnToolPen, 1);
+    for (int i = 0; i < NumReports; ++i) {
+        double TimeSeconds = i / kBenchmarkStylusHz;
+        bool IsDropped = i % kBenchmarkEvdevDropEvery == kBenchmarkEvdevDropEvery - 1;
+        if (IsDropped)
+            AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvSyn, EvdevCode::SynDropped, 0);
+
+        float Angle = i / kBenchmarkStylusHz * 2.0f;
+        float Radius = 2000.0f + (i % 4000);
+        bool WasDown = IsDown;
+        IsDown = i % (kBenchmarkEvdevStrokeReports * 6 / 5) < kBenchmarkEvdevStrokeReports;
+        int32 X = 22000 + FMath::RoundToInt(Radius * FMath::Cos(Angle));
+        int32 Y = 14000 + FMath::RoundToInt(Radius * FMath::Sin(Angle));
+        int32 Pressure = IsDown ? FMath::RoundToInt(4095.0f + 4095.0f * FMath::Sin(Angle * 3.0f)) : 0;
+        bool HasTilt = i % 3 == 0;
+        int32 TiltX = FMath::RoundToInt(40.0f * FMath::Cos(Angle * 0.5f));
+        int32 TiltY = FMath::RoundToInt(-30.0f * FMath::Sin(Angle * 0.5f));
+
+        if (IsDown != WasDown)
+            AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvKey, EvdevCode::BtnTouch, IsDown ? 1 : 0);
+        AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvAbs, EvdevCode::AbsX, X);
+        AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvAbs, EvdevCode::AbsY, Y);
+        AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvAbs, EvdevCode::AbsPressure, Pressure);
+        if (HasTilt) {
+            AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvAbs, EvdevCode::AbsTiltX, TiltX);
+            AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvAbs, EvdevCode::AbsTiltY, TiltY);
+        }
+        AddEvdevEvent(OutEvents, TimeSeconds, EvdevCode::EvSyn, EvdevCode::SynReport, 0);
+
+        // What the kernel dropped never reaches the state
+        if (IsDropped)
+            continue;
+        if (IsDown != WasDown)
+            Expected.IsDown = IsDown;
+        Expected.Position = FVector2D(X * PixelsPerUnitX, Y * PixelsPerUnitY);
+        Expected.Pressure = Pressure / 8191.0;
+        if (HasTilt)
+            Expected.Tilt = FVector2D(TiltX * DegreesPerUnit, TiltY * DegreesPerUnit);
+        OutExpected.Add(Expected);
+    }
+}
+
+static bool EvdevSamplesMatch(const FStylusSample& A, const FStylusSample& B)
+{
+    return PenValuesMatch(A.Position.X, B.Position.X) && PenValuesMatch(A.Position.Y, B.Position.Y)
+        && PenValuesMatch(A.Pressure, B.Pressure) && PenValuesMatch(A.Tilt.X, B.Tilt.X) && PenValuesMatch(A.Tilt.Y, B.Tilt.Y)
+        && A.IsDown == B.IsDown;
+}
+
+/*
+* Fails unless the corners and the middle of a tablet whose axes don't start at 0 decode to the
+* corners and the middle of the screen. Then decodes a synthetic pen capture with the evdev
+* decoder in reads of BatchSize events, and fails unless every report but the dropped ones
+* comes out as computed in double. Then plays
+* the capture back from a file through FEvdevStylusInputDevice and its reader thread, popping
+* the samples like the game thread, and fails if one is lost other than the ones the sample
+* queue reported dropped, or comes out of order.
+*/
+bool UInputBenchmarkCommandlet::CheckEvdevStylus(int NumReports)
+{
+    TArray<FEvdevRawEvent> Events;
+    TArray<FStylusSample> Expected;
+    FEvdevStylusDecoder Decoder;
+    Decoder.SetScreenExtent(kBenchmarkEvdevScreenExtent);
+    Decoder.SetAxis(EvdevCode::AbsX, {-1000, 9000, 40});
+    Decoder.SetAxis(EvdevCode::AbsY, {500, 6500, 40});
+    const FVector2D Corners[] = {FVector2D(-1000, 500), FVector2D(9000, 6500), FVector2D(4000, 3500)};
+    for (const FVector2D& Corner : Corners) {
+        AddEvdevEvent(Events, 0.0, EvdevCode::EvAbs, EvdevCode::AbsX, (int32)Corner.X);
+        AddEvdevEvent(Events, 0.0, EvdevCode::EvAbs, EvdevCode::AbsY, (int32)Corner.Y);
+        AddEvdevEvent(Events, 0.0, EvdevCode::EvSyn, EvdevCode::SynReport, 0);
+    }
+    const FVector2D ExpectedCorners[] = {FVector2D::ZeroVector, kBenchmarkEvdevScreenExtent, kBenchmarkEvdevScreenExtent * 0.5f};
+    FEvdevStylusState State;
+    int NumDecoded = 0, NumMismatches = 0;
+    Decoder.Decode(Events.GetData(), Events.Num(), State, [&](const FEvdevStylusState& Reported) {
+        const FVector2D& Corner = ExpectedCorners[FMath::Min(NumDecoded++, 2)];
+        NumMismatches += PenValuesMatch(Reported.GetValue(EEvdevStylusField::PositionX), Corner.X)
+            && PenValuesMatch(Reported.GetValue(EEvdevStylusField::PositionY), Corner.Y) ? 0 : 1;
+    });
+    if (NumDecoded != 3 || NumMismatches > 0) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Evdev decoder mapped %d of %d tablet corners to the screen wrong."), NumMismatches, NumDecoded);
+        return false;
+    }
+
+    Events.Reset();
+    MakeEvdevCapture(NumReports, Events, Expected);
+    Decoder.Reset();
+    for (const EvdevPenAxis& Axis : kBenchmarkEvdevAxes)
+        Decoder.SetAxis(Axis.Code, Axis.Info);
+    State = FEvdevStylusState();
+    NumDecoded = 0;
+    const int BatchSize = FEvdevStylusInputDevice::BatchSize;
+    for (int First = 0; First < Events.Num(); First += BatchSize) {
+        Decoder.Decode(&Events[First], FMath::Min(BatchSize, Events.Num() - First), State, [&](const FEvdevStylusState& Reported) {
+            FStylusSample Sample;
+            Sample.Position = FVector2D(Reported.GetValue(EEvdevStylusField::PositionX), Reported.GetValue(EEvdevStylusField::PositionY));
+            Sample.Pressure = Reported.GetValue(EEvdevStylusField::Pressure);
+            Sample.Tilt = FVector2D(Reported.GetValue(EEvdevStylusField::TiltX), Reported.GetValue(EEvdevStylusField::TiltY));
+            Sample.IsDown = Reported.IsTouching;
+            NumMismatches += NumDecoded < Expected.Num() && EvdevSamplesMatch(Sample, Expected[NumDecoded]) ? 0 : 1;
+            ++NumDecoded;
+        });
+    }
+    int NumKernelDrops = NumReports / kBenchmarkEvdevDropEvery;
+    if (NumDecoded != Expected.Num() || NumMismatches > 0 || Decoder.GetNumDropped() != (uint32)NumKernelDrops) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Evdev decoder reported %d of %d reports, %d of them wrong, and %u of %d drops."),
+            NumDecoded, Expected.Num(), NumMismatches, Decoder.GetNumDropped(), NumKernelDrops);
+        return false;
+    }
+
+    double DecoderSeconds = 0.0;
+    float Sum = 0.0f;
+    for (int Run = 0; Run < kBenchmarkStylusDecodeRuns; ++Run) {
+        double StartSeconds = FPlatformTime::Seconds();
+        for (int First = 0; First < Events.Num(); First += BatchSize) {
+            Decoder.Decode(&Events[First], FMath::Min(BatchSize, Events.Num() - First), State,
+                [&Sum](const FEvdevStylusState& Reported) { Sum += Reported.GetValue(EEvdevStylusField::Pressure); });
+        }
+        DecoderSeconds += FPlatformTime::Seconds() - StartSeconds;
+    }
+
+    // The same capture from a file, on the reader thread
+    FString Path = FPaths::CreateTempFilename(*FPaths::ProjectSavedDir(), TEXT("EvdevCapture"), TEXT(".bin"));
+    TArray<uint8> Data;
+    Data.SetNumUninitialized(Events.Num() * sizeof(FEvdevRawEvent));
+    FMemory::Memcpy(Data.GetData(), Events.GetData(), Data.Num());
+    if (!FFileHelper::SaveArrayToFile(Data, *Path)) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Could not write the evdev capture %s."), *Path);
+        return false;
+    }
+    TUniquePtr<FEvdevFileEventSource> Source = MakeUnique<FEvdevFileEventSource>(Path);
+    for (const EvdevPenAxis& Axis : kBenchmarkEvdevAxes)
+        Source->SetAxisInfo(Axis.Code, Axis.Info);
+
+    double StartSeconds = FPlatformTime::Seconds();
+    FEvdevStylusInputDevice Device(MoveTemp(Source), kBenchmarkEvdevScreenExtent, TEXT("EvdevBenchmarkReader"));
+    TArray<FStylusSample> Samples;
+    int NumPopped = 0, NumSkipped = 0, ExpectedIndex = 0;
+    bool IsInOrder = true;
+    for (bool IsFinished = false; !IsFinished; ) {
+        IsFinished = Device.IsFinished();
+        Samples.Reset();
+        if (Device.PopSamples(Samples) == 0) {
+            FPlatformProcess::Yield();
+            continue;
+        }
+        for (const FStylusSample& Sample : Samples) {
+            // The queue drops what doesn't fit, the rest comes in order
+            int First = ExpectedIndex;
+            while (ExpectedIndex < Expected.Num() && !EvdevSamplesMatch(Sample, Expected[ExpectedIndex]))
+                ++ExpectedIndex;
+            IsInOrder &= ExpectedIndex < Expected.Num();
+            NumSkipped += ExpectedIndex - First;
+            ++ExpectedIndex;
+            ++NumPopped;
+        }
+    }
+    double ReaderSeconds = FPlatformTime::Seconds() - StartSeconds;
+    NumSkipped += FMath::Max(Expected.Num() - ExpectedIndex, 0);
+    Device.Tick();
+    FStylusState LastState = Device.GetCurrentState();
+    IFileManager::Get().Delete(*Path);
+
+    if (!IsInOrder || NumPopped + (int)Device.GetNumDropped() != Expected.Num() || NumSkipped != (int)Device.GetNumDropped()
+        || Device.GetNumEvents() != (uint64)Events.Num() || !PenValuesMatch(LastState.GetPressure(), Expected.Last().Pressure)) {
+        UE_LOG(LogInputBenchmark, Error,
+            TEXT("Evdev reader popped %d of %d reports in order: %d, skipping %d where the queue dropped %u, read %llu of %d events."),
+            NumPopped, Expected.Num(), IsInOrder ? 1 : 0, NumSkipped, Device.GetNumDropped(),
+            (unsigned long long)Device.GetNumEvents(), Events.Num());
+        return false;
+    }
+
+    UE_LOG(LogInputBenchmark, Display,
+        TEXT("Evdev pen %d reports of %.1f events: decoder %.2f ns per event, reader thread %.1f M events/s with %u dropped by the queue (sum %.0f)"),
+        NumReports, (double)Events.Num() / NumReports, DecoderSeconds * 1e9 / ((double)Events.Num() * kBenchmarkStylusDecodeRuns),
+        Events.Num() / ReaderSeconds / 1e6, Device.GetNumDropped(), Sum);
+    return true;
+}
+
+/*
+* A pen device as the kernel has it: events marked lost change the state of the device but
+* are never read, and Resync answers with the state as the device left it, like the ioctls.
+*/
+class FEvdevLossyEventSource : public IEvdevEventSource
+{
+public:
+    void Add(uint16 Type, uint16 Code, int32 Value, bool IsLost = false)
+    {
+        m_Events.Add({{0, 0, Type, Code, Value}, IsLost});
+    }
+
+    virtual bool GetAxisInfo(uint16 AbsCode, FEvdevAxisInfo& OutInfo) const override
+    {
+        for (const EvdevPenAxis& Axis : kBenchmarkEvdevAxes) {
+            if (Axis.Code == AbsCode) {
+                OutInfo = Axis.Info;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    virtual int32 Read(FEvdevRawEvent* OutEvents, int32 MaxEvents) override
+    {
+        int32 NumRead = 0;
+        for (; m_Next < m_Events.Num() && NumRead < MaxEvents; ++m_Next) {
+            const FEvdevRawEvent& Event = m_Events[m_Next].Event;
+            if (Event.Type == EvdevCode::EvKey && Event.Code == EvdevCode::BtnTouch)
+                m_IsTouching = Event.Value != 0;
+            else if (Event.Type == EvdevCode::EvAbs && Event.Code < EvdevCode::AbsCount)
+                m_AbsValues[Event.Code] = Event.Value;
+            if (!m_Events[m_Next].IsLost)
+                OutEvents[NumRead++] = Event;
+        }
+        return NumRead > 0 ? NumRead : INDEX_NONE;
+    }
+
+    virtual int32 Resync(FEvdevRawEvent* OutEvents, int32 MaxEvents) override
+    {
+        int32 NumEvents = 0;
+        OutEvents[NumEvents++] = {0, 0, EvdevCode::EvKey, EvdevCode::BtnTouch, m_IsTouching ? 1 : 0};
+        for (const EvdevPenAxis& Axis : kBenchmarkEvdevAxes)
+            OutEvents[NumEvents++] = {0, 0, EvdevCode::EvAbs, Axis.Code, m_AbsValues[Axis.Code]};
+        OutEvents[NumEvents++] = {0, 0, EvdevCode::EvSyn, EvdevCode::SynReport, 0};
+        return NumEvents;
+    }
+
+private:
+    struct LossyEvent
+    {
+        FEvdevRawEvent Event;
+        bool IsLost;
+    };
+
+    TArray<LossyEvent> m_Events;
+    int m_Next = 0;
+    bool m_IsTouching = false;
+    int32 m_AbsValues[EvdevCode::AbsCount] = {};
+};
+
+/*
+* A stroke whose BTN_TOUCH release the kernel drops, then the pen hovers. Fails unless the
+* reader resyncs after the drop, so every sample from then on is up without pressure and the
+* device state ends up not touching, where decoding alone would keep the pen down.
+*/
+bool UInputBenchmarkCommandlet::CheckEvdevResync(int NumHoverReports)
+{
+    const int NumDownReports = 3;
+    TUniquePtr<FEvdevLossyEventSource> Source = MakeUnique<FEvdevLossyEventSource>();
+    Source->Add(EvdevCode::EvKey, EvdevCode::BtnToolPen, 1);
+    Source->Add(EvdevCode::EvKey, EvdevCode::BtnTouch, 1);
+    for (int i = 0; i < NumDownReports; ++i) {
+        Source->Add(EvdevCode::EvAbs, EvdevCode::AbsX, 20000 + i * 10);
+        Source->Add(EvdevCode::EvAbs, EvdevCode::AbsY, 14000);
+        Source->Add(EvdevCode::EvAbs, EvdevCode::AbsPressure, 4000);
+        Source->Add(EvdevCode::EvSyn, EvdevCode::SynReport, 0);
+    }
+    // The release is lost, the kernel says so and the rest of that report is cut short
+    Source->Add(EvdevCode::EvKey, EvdevCode::BtnTouch, 0, true);
+    Source->Add(EvdevCode::EvAbs, EvdevCode::AbsPressure, 0, true);
+    Source->Add(EvdevCode::EvSyn, EvdevCode::SynReport, 0, true);
+    Source->Add(EvdevCode::EvSyn, EvdevCode::SynDropped, 0);
+    Source->Add(EvdevCode::EvAbs, EvdevCode::AbsX, 20100);
+    Source->Add(EvdevCode::EvSyn, EvdevCode::SynReport, 0);
+    for (int i = 0; i < NumHoverReports; ++i) {
+        Source->Add(EvdevCode::EvAbs, EvdevCode::AbsX, 20100 + i * 10);
+        Source->Add(EvdevCode::EvSyn, EvdevCode::SynReport, 0);
+    }
+
+    FEvdevStylusInputDevice Device(MoveTemp(Source), kBenchmarkEvdevScreenExtent, TEXT("EvdevResyncReader"));
+    while (!Device.IsFinished())
+        FPlatformProcess::Yield();
+    TArray<FStylusSample> Samples;
+    Device.PopSamples(Samples);
+    Device.Tick();
+
+    int NumDownAfterDrop = 0;
+    for (int i = NumDownReports; i < Samples.Num(); ++i)
+        NumDownAfterDrop += Samples[i].IsDown || Samples[i].Pressure != 0.0f ? 1 : 0;
+    // The down reports, the resync and the hovering
+    int NumExpected = NumDownReports + 1 + NumHoverReports;
+    if (Samples.Num() != NumExpected || NumDownAfterDrop > 0 || Device.GetCurrentState().IsStylusDown()) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Evdev resync made %d of %d samples, %d of them down after the lost release."),
+            Samples.Num(), NumExpected, NumDownAfterDrop);
+        return false;
+    }
+    return true;
+}
+
+// Drawing at 60 fps: strokes with pen samples, a big drop now and then.
+static void MakeInputSession(int NumFrames, DropRandomSequence& Random, TArray<TArray<InputEvent>>& OutEvents, TArray<InputFrame>& OutFrames)
+{
+    OutEvents.SetNum(NumFrames);
+    OutFrames.SetNum(NumFrames);
+    bool Pressed = false;
+    double TimeSeconds = 0.0;
+    for (int Frame = 0; Frame < NumFrames; ++Frame) {
+        InputFrame& Input = OutFrames[Frame];
+        Input.DeltaSeconds = Random.GetRange(0.012f, 0.02f);
+        Input.ViewportSize = FIntPoint(1920, 1080 - Frame / 1000);
+        Input.MousePosition = FVector2D(Random.GetUnit() * 1920.0f, Random.GetUnit() * 1080.0f);
+        Input.HasStylusPressure = Pressed && Random.GetUnit() < 0.5f;
+        Input.StylusPressure = Input.HasStylusPressure ? Random.GetUnit() : 0.0f;
+        Input.StylusSamples.Reset();
+        int NumSamples = Pressed ? (int)Random.GetRange(0.0f, 6.0f) : 0;
+        for (int i = 0; i < NumSamples; ++i) {
+            FStylusSample& Sample = Input.StylusSamples.AddDefaulted_GetRef();
+            TimeSeconds += 1.0 / kBenchmarkStylusHz;
+            Sample.TimeSeconds = TimeSeconds;
+            Sample.Position = Input.MousePosition + FVector2D(i, -i);
+            Sample.Pressure = Random.GetUnit();
+            Sample.Tilt = FVector2D(Random.GetRange(-60.0f, 60.0f), Random.GetRange(-60.0f, 60.0f));
+            Sample.IsDown = true;
+        }
+
+        if (Random.GetUnit() < 0.02f) {
+            Pressed = !Pressed;
+            OutEvents[Frame].Add({Pressed ? EInputLogEvent::FingerPressed : EInputLogEvent::FingerReleased, Input.MousePosition});
+        }
+        if (Random.GetUnit() < 0.005f)
+            OutEvents[Frame].Add({EInputLogEvent::BigDrop, Input.MousePosition});
+    }
+}
+
+static bool InputFramesMatch(const InputFrame& A, const InputFrame& B)
+{
+    if (A.DeltaSeconds != B.DeltaSeconds || A.ViewportSize != B.ViewportSize || A.MousePosition != B.MousePosition
+        || A.HasStylusPressure != B.HasStylusPressure || A.StylusPressure != B.StylusPressure
+        || A.StylusSamples.Num() != B.StylusSamples.Num())
+        return false;
+    for (int i = 0; i < A.StylusSamples.Num(); ++i) {
+        const FStylusSample& SampleA = A.StylusSamples[i];
+        const FStylusSample& SampleB = B.StylusSamples[i];
+        if (SampleA.TimeSeconds != SampleB.TimeSeconds || SampleA.Position != SampleB.Position
+            || SampleA.Pressure != SampleB.Pressure || SampleA.Tilt != SampleB.Tilt || SampleA.IsDown != SampleB.IsDown)
+            return false;
+    }
+    return true;
+}
+
+/*
+* Records a synthetic session to an input log and replays it. Fails unless every frame and
+* key event comes back as it went in, in order, a log cut off mid frame replays up to that
+* frame, and a file that isn't an input log doesn't open.
+*/
+bool UInputBenchmarkCommandlet::CheckInputLog(int NumFrames)
+{
+    DropRandomSequence Random(kBenchmarkInputLogSeed);
+    TArray<TArray<InputEvent>> Events;
+    TArray<InputFrame> Frames;
+    MakeInputSession(NumFrames, Random, Events, Frames);
+
+    FString Path = FPaths::CreateTempFilename(*FPaths::ProjectSavedDir(), TEXT("InputLog"), TEXT(".bin"));
+    InputLogHeader Header;
+    Header.RandomSeed = kBenchmarkInputLogSeed;
+    Header.ViewportScale = 1.25f;
+    InputRecorder Recorder;
+    if (!Recorder.Open(Path, Header)) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Could not write the input log %s."), *Path);
+        return false;
+    }
+    double StartSeconds = FPlatformTime::Seconds();
+    for (int Frame = 0; Frame < NumFrames; ++Frame) {
+        for (const InputEvent& Event : Events[Frame])
+            Recorder.RecordEvent(Event);
+        Recorder.RecordFrame(Frames[Frame]);
+    }
+    Recorder.Close();
+    double RecordSeconds = FPlatformTime::Seconds() - StartSeconds;
+    int64 LogBytes = IFileManager::Get().FileSize(*Path);
+
+    InputReplay Replay;
+    InputLogHeader ReadHeader;
+    StartSeconds = FPlatformTime::Seconds();
+    bool Opened = Replay.Open(Path, ReadHeader);
+    bool Succeeded = Opened && ReadHeader.RandomSeed == Header.RandomSeed && ReadHeader.ViewportScale == Header.ViewportScale;
+    TArray<InputEvent> ReadEvents;
+    InputFrame ReadFrame;
+    for (int Frame = 0; Succeeded && Frame < NumFrames; ++Frame) {
+        ReadEvents.Reset();
+        Succeeded = Replay.ReadFrame(ReadEvents, ReadFrame) && InputFramesMatch(ReadFrame, Frames[Frame])
+            && ReadEvents.Num() == Events[Frame].Num();
+        for (int i = 0; Succeeded && i < ReadEvents.Num(); ++i) {
+            Succeeded = ReadEvents[i].Type == Events[Frame][i].Type
+                && ReadEvents[i].MousePosition == Events[Frame][i].MousePosition;
+        }
+        if (!Succeeded)
+            UE_LOG(LogInputBenchmark, Error, TEXT("Input log replayed frame %d unlike it was recorded."), Frame);
+    }
+    double ReplaySeconds = FPlatformTime::Seconds() - StartSeconds;
+    ReadEvents.Reset();
+    if (Succeeded && Replay.ReadFrame(ReadEvents, ReadFrame)) {
+        UE_LOG(LogInputBenchmark, Error, TEXT("Input log replayed more than the %d frames recorded."), NumFrames);
+        Succeeded = false;
+    }
+
+    // Cut off in the last frame, the rest still replays
+    TArray<uint8> Data;
+    if (Succeeded && FFileHelper::LoadFileToArray(Data, *Path)) {
+        Data.SetNum(Data.Num() - kBenchmarkInputLogCut);
+        FFileHelper::SaveArrayToFile(Data, *Path);
+        Replay.Open(Path, ReadHeader);
+        while (Replay.ReadFrame(ReadEvents, ReadFrame));
+        if (Replay.GetNumFrames() != NumFrames - 1) {
+            UE_LOG(LogInputBenchmark, Error, TEXT("Input log cut off in frame %d replayed %d frames."),
+                NumFrames - 1, Replay.GetNumFrames());
+            Succeeded = false;
+        }
+
+        Data[0] ^= 0xFF;
+        FFileHelper::SaveArrayToFile(Data, *Path);
+        if (Replay.Open(Path, ReadHeader)) {
+            UE_LOG(LogInputBenchmark, Error, TEXT("Input log opened a file that is not one."));
+            Succeeded = false;
+        }
+    }
+    Replay.Close();
+    IFileManager::Get().Delete(*Path);
+
+    if (Succeeded) {
+        UE_LOG(LogInputBenchmark, Display,
+            TEXT("Input log %d frames: %lld bytes, %.1f per frame, recorded in %.3f ms, replayed in %.3f ms"),
+            NumFrames, (long long)LogBytes, (double)LogBytes / NumFrames, RecordSeconds * 1000.0, ReplaySeconds * 1000.0);
+    }
+    return Succeeded;
+}
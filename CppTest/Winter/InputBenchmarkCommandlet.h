@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "InputBenchmarkCommandlet.generated.h"
+
+/**
+ * Checks and benchmarks the input path without a window or devices: the stylus sample
+ * queue, the RealTimeStylus packet decoder, the evdev pen reader and the input log.
+ * Run with `UE4Editor-Cmd CppTest.uproject -run=InputBenchmark -nullrhi`.
+ */
+UCLASS()
+class CPPTEST_API UInputBenchmarkCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    UInputBenchmarkCommandlet();
+
+    int32 Main(const FString& Params) override;
+
+private:
+    bool CheckStylusSampleQueue(int NumSamples);
+    bool CheckStylusPacketDecoder(int NumPackets);
+    bool CheckEvdevStylus(int NumReports);
+    bool CheckEvdevResync(int NumHoverReports);
+    bool CheckInputLog(int NumFrames);
+};
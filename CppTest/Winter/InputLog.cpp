@@ -0,0 +1,139 @@
+#include "InputLog.h"
+#include "Common.h"
+
+#include <HAL/FileManager.h>
+#include <Misc/FileHelper.h>
+#include <Serialization/MemoryReader.h>
+
+
+PRAGMA_OPTION
+
+const uint32 kInputLogMagic = 0x504E4957;   // "WINP"
+const uint32 kInputLogVersion = 2;          // 2: stylus samples in viewport local space
+
+
+static void SerializeHeader(FArchive& Ar, uint32& Magic, uint32& Version, InputLogHeader& Header)
+{
+    Ar << Magic << Version << Header.RandomSeed << Header.ViewportScale;
+}
+
+static void SerializeSample(FArchive& Ar, FStylusSample& Sample)
+{
+    uint8 IsDown = Sample.IsDown ? 1 : 0;
+    Ar << Sample.TimeSeconds << Sample.Position << Sample.Pressure << Sample.Tilt << IsDown;
+    Sample.IsDown = IsDown != 0;
+}
+
+static void SerializeFrame(FArchive& Ar, InputFrame& Frame)
+{
+    uint8 HasStylusPressure = Frame.HasStylusPressure ? 1 : 0;
+    Ar << Frame.DeltaSeconds << Frame.ViewportSize << Frame.MousePosition << HasStylusPressure;
+    Frame.HasStylusPressure = HasStylusPressure != 0;
+    if (Frame.HasStylusPressure)
+        Ar << Frame.StylusPressure;
+    else if (Ar.IsLoading())
+        Frame.StylusPressure = 0.0f;
+
+    int32 NumSamples = Frame.StylusSamples.Num();
+    Ar << NumSamples;
+    if (Ar.IsLoading()) {
+        if (NumSamples < 0 || NumSamples > Ar.TotalSize() - Ar.Tell()) {
+            Ar.SetError();
+            return;
+        }
+        Frame.StylusSamples.SetNum(NumSamples);
+    }
+    for (FStylusSample& Sample : Frame.StylusSamples)
+        SerializeSample(Ar, Sample);
+}
+
+
+InputRecorder::~InputRecorder()
+{
+    Close();
+}
+
+bool InputRecorder::Open(const FString& Path, const InputLogHeader& Header)
+{
+    Close();
+    m_Archive.Reset(IFileManager::Get().CreateFileWriter(*Path));
+    if (!m_Archive.IsValid())
+        return false;
+
+    uint32 Magic = kInputLogMagic, Version = kInputLogVersion;
+    InputLogHeader Written = Header;
+    SerializeHeader(*m_Archive, Magic, Version, Written);
+    m_NumFrames = 0;
+    return true;
+}
+
+void InputRecorder::Close()
+{
+    if (m_Archive.IsValid())
+        m_Archive->Close();
+    m_Archive.Reset();
+}
+
+void InputRecorder::RecordEvent(const InputEvent& Event)
+{
+    uint8 Type = (uint8)Event.Type;
+    FVector2D MousePosition = Event.MousePosition;
+    *m_Archive << Type << MousePosition;
+}
+
+void InputRecorder::RecordFrame(const InputFrame& Frame)
+{
+    uint8 Type = (uint8)EInputLogEvent::Frame;
+    *m_Archive << Type;
+    SerializeFrame(*m_Archive, const_cast<InputFrame&>(Frame));
+    ++m_NumFrames;
+}
+
+
+bool InputReplay::Open(const FString& Path, InputLogHeader& OutHeader)
+{
+    Close();
+    if (!FFileHelper::LoadFileToArray(m_Data, *Path))
+        return false;
+    m_Reader = MakeUnique<FMemoryReader>(m_Data);
+
+    uint32 Magic = 0, Version = 0;
+    InputLogHeader Header;
+    SerializeHeader(*m_Reader, Magic, Version, Header);
+    if (m_Reader->IsError() || Magic != kInputLogMagic || Version != kInputLogVersion) {
+        Close();
+        return false;
+    }
+    OutHeader = Header;
+    m_NumFrames = 0;
+    return true;
+}
+
+void InputReplay::Close()
+{
+    m_Reader.Reset();
+    m_Data.Empty();
+}
+
+// False at the end of the log, or where it was cut off.
+bool InputReplay::ReadFrame(TArray<InputEvent>& OutEvents, InputFrame& OutFrame)
+{
+    while (m_Reader->Tell() < m_Reader->TotalSize()) {
+        uint8 Type;
+        *m_Reader << Type;
+        if ((EInputLogEvent)Type == EInputLogEvent::Frame) {
+            SerializeFrame(*m_Reader, OutFrame);
+            if (m_Reader->IsError())
+                return false;
+            ++m_NumFrames;
+            return true;
+        }
+
+        InputEvent& Event = OutEvents.AddDefaulted_GetRef();
+        Event.Type = (EInputLogEvent)Type;
+        *m_Reader << Event.MousePosition;
+        if (m_Reader->IsError() || Type > (uint8)EInputLogEvent::BigDrop)
+            return false;
+    }
+    return false;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <CoreMinimal.h>
+
+#include "StylusInput/StylusSampleQueue.h"
+
+
+class FArchive;
+
+enum class EInputLogEvent : uint8
+{
+    Frame,
+    FingerPressed,
+    FingerReleased,
+    BigDrop,
+};
+
+// A key event, with the mouse where it was when the key went.
+struct InputEvent
+{
+    EInputLogEvent Type;
+    FVector2D MousePosition;    // Viewport local space
+};
+
+// Everything a frame of AGM_Winter reads from the window and the input devices.
+struct InputFrame
+{
+    float DeltaSeconds = 0.0f;
+    FIntPoint ViewportSize = FIntPoint(0, 0);
+    FVector2D MousePosition = FVector2D::ZeroVector;   // Viewport local space
+    bool HasStylusPressure = false;                     // A stylus is down and pressing
+    float StylusPressure = 0.0f;
+    TArray<FStylusSample> StylusSamples;                // Of a pen that is down, oldest first, viewport local space
+};
+
+// What a session starts from besides its input.
+struct InputLogHeader
+{
+    int32 RandomSeed = 0;
+    float ViewportScale = 1.0f;
+};
+
+/*
+* Writes the input of a session to a binary log, as it happens: the header, then per event
+* its EInputLogEvent byte and payload. Key events carry the mouse position, frames all of
+* InputFrame. Played back with InputReplay and the same seed, a session makes the same drops.
+*/
+class InputRecorder
+{
+public:
+    ~InputRecorder();
+
+    bool Open(const FString& Path, const InputLogHeader& Header);
+    void Close();
+    bool IsOpen() const { return m_Archive.IsValid(); }
+
+    void RecordEvent(const InputEvent& Event);
+    void RecordFrame(const InputFrame& Frame);
+    int GetNumFrames() const { return m_NumFrames; }
+
+private:
+    TUniquePtr<FArchive> m_Archive;
+    int m_NumFrames = 0;
+};
+
+// Reads an input log back, a frame and the key events before it at a time.
+class InputReplay
+{
+public:
+    bool Open(const FString& Path, InputLogHeader& OutHeader);
+    void Close();
+    bool IsOpen() const { return m_Reader.IsValid(); }
+
+    bool ReadFrame(TArray<InputEvent>& OutEvents, InputFrame& OutFrame);
+    int GetNumFrames() const { return m_NumFrames; }
+
+private:
+    TArray<uint8> m_Data;       // The whole log, so replaying doesn't wait for the disk
+    TUniquePtr<FArchive> m_Reader;
+    int m_NumFrames = 0;
+};